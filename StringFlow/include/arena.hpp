@@ -0,0 +1,190 @@
+//
+// Created by ruixuezhao on 25-3-23.
+//
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "format.hpp"
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define STRINGFLOW_HAS_PMR 1
+#endif
+
+/**
+ * @brief 指针递增(bump)式内存池, 用于一次请求内的所有格式化结果
+ *
+ * @note 分配只移动指针, 释放为空操作(最近一次分配除外, 例如先析构的临时容器);
+ *       字符串扩容时先分配新缓冲区再释放旧的, 旧缓冲区不是最近一次分配, 要到 reset 才回收,
+ *       逐次翻倍扩容累计浪费的空间不超过最终容量. 结果较长时可先 reserve.
+ *       reset 只把指针移回第一块, 复杂度 O(1), 已申请的块保留给下一次请求复用.
+ *
+ *       char stack[1024];
+ *       StringFlow::bump_arena arena(stack, sizeof(stack));    // 先用栈上缓冲区, 不够时再向堆申请
+ *       auto line = StringFlow::format(StringFlow::arena_allocator<char>(arena), "{} {}", user, code).unwrap();
+ *       ...
+ *       arena.reset();                                          // 请求结束, 之前的字符串全部失效
+ */
+namespace StringFlow {
+    class bump_arena {
+    public:
+        explicit bump_arena(size_t block_size = 4096) : m_block_size(block_size < 256 ? 256 : block_size) {}
+
+        // 以调用者提供的缓冲区作为第一块, 缓冲区的生命周期需长于 arena
+        bump_arena(void *buffer, size_t size, size_t block_size = 4096) : bump_arena(block_size) {
+            if (size <= sizeof(block)) return;
+            auto *initial = static_cast<block *>(align_pointer(buffer, alignof(block)));
+            const size_t skipped = reinterpret_cast<char *>(initial) - static_cast<char *>(buffer);
+            if (size <= skipped + sizeof(block)) return;
+            initial->next = nullptr;
+            initial->size = size - skipped - sizeof(block);
+            initial->owned = false;
+            m_head = m_current = initial;
+            m_pointer = initial->data();
+            m_end = m_pointer + initial->size;
+        }
+
+        ~bump_arena() {
+            for (block *iter = m_head; iter;) {
+                block *next = iter->next;
+                if (iter->owned) std::free(iter);
+                iter = next;
+            }
+        }
+
+        bump_arena(const bump_arena &) = delete;
+        bump_arena &operator=(const bump_arena &) = delete;
+
+        void *allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+            char *aligned = static_cast<char *>(align_pointer(m_pointer, alignment));
+            if (STRINGFLOW_UNLIKELY(!m_pointer || size > static_cast<size_t>(m_end - aligned))) {
+                next_block(size + alignment);
+                aligned = static_cast<char *>(align_pointer(m_pointer, alignment));
+            }
+            m_pointer = aligned + size;
+            return aligned;
+        }
+
+        // 只有最近一次分配可以收回; 其余内存在 reset 时统一回收
+        void deallocate(void *pointer, size_t size) {
+            if (static_cast<char *>(pointer) + size == m_pointer) m_pointer = static_cast<char *>(pointer);
+        }
+
+        /**
+         * @brief 回到第一块的起点, 之前分配的内存全部失效
+         */
+        void reset() {
+            m_current = m_head;
+            m_pointer = m_head ? m_head->data() : nullptr;
+            m_end = m_head ? m_pointer + m_head->size : nullptr;
+        }
+
+        // 当前块已使用的字节数之外, 之前各块按容量计
+        size_t used() const {
+            size_t total = 0;
+            for (const block *iter = m_head; iter && iter != m_current; iter = iter->next) total += iter->size;
+            return m_current ? total + static_cast<size_t>(m_pointer - m_current->data()) : 0;
+        }
+
+        size_t capacity() const {
+            size_t total = 0;
+            for (const block *iter = m_head; iter; iter = iter->next) total += iter->size;
+            return total;
+        }
+
+    private:
+        struct alignas(std::max_align_t) block {
+            block *next;
+            size_t size;
+            bool owned;
+
+            char *data() { return reinterpret_cast<char *>(this + 1); }
+        };
+
+        static void *align_pointer(void *pointer, size_t alignment) {
+            const auto address = reinterpret_cast<uintptr_t>(pointer);
+            return reinterpret_cast<void *>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+        }
+
+        // 优先复用 reset 之前申请的下一块, 容量不足时在当前块之后插入新块
+        void next_block(size_t required) {
+            block *next = m_current ? m_current->next : m_head;
+            if (!next || next->size < required) {
+                const size_t size = required > m_block_size ? required : m_block_size;
+                auto *created = static_cast<block *>(std::malloc(sizeof(block) + size));
+                if (!created) throw std::bad_alloc();
+                created->next = next;
+                created->size = size;
+                created->owned = true;
+                if (m_current)
+                    m_current->next = created;
+                else
+                    m_head = created;
+                next = created;
+            }
+            m_current = next;
+            m_pointer = next->data();
+            m_end = m_pointer + next->size;
+        }
+
+        size_t m_block_size;
+        block *m_head = nullptr;
+        block *m_current = nullptr;
+        char *m_pointer = nullptr;
+        char *m_end = nullptr;
+    };
+
+    /**
+     * @brief 从 bump_arena 分配的标准分配器, 可用于 std::basic_string、std::vector 等容器
+     */
+    template <typename T>
+    class arena_allocator {
+    public:
+        using value_type = T;
+
+        explicit arena_allocator(bump_arena &arena) noexcept : m_arena(&arena) {}
+        template <typename U>
+        arena_allocator(const arena_allocator<U> &other) noexcept : m_arena(other.arena()) {}
+
+        T *allocate(size_t count) { return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T))); }
+        void deallocate(T *pointer, size_t count) noexcept { m_arena->deallocate(pointer, count * sizeof(T)); }
+
+        bump_arena *arena() const noexcept { return m_arena; }
+
+        template <typename U>
+        bool operator==(const arena_allocator<U> &other) const noexcept { return m_arena == other.arena(); }
+        template <typename U>
+        bool operator!=(const arena_allocator<U> &other) const noexcept { return m_arena != other.arena(); }
+
+    private:
+        bump_arena *m_arena;
+    };
+
+#if defined(STRINGFLOW_HAS_PMR)
+    /**
+     * @brief bump_arena 的 std::pmr::memory_resource 适配
+     */
+    class arena_resource : public std::pmr::memory_resource {
+    public:
+        explicit arena_resource(bump_arena &arena) noexcept : m_arena(arena) {}
+
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override { return m_arena.allocate(bytes, alignment); }
+        void do_deallocate(void *pointer, size_t bytes, size_t) override { m_arena.deallocate(pointer, bytes); }
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        bump_arena &m_arena;
+    };
+
+    /**
+     * @brief 格式化为 std::pmr::string, 内存来自 resource
+     */
+    template <typename... Args>
+    Result<std::pmr::string, format_error_info> format(std::pmr::memory_resource *resource, const char *format, Args &&...args) {
+        return StringFlow::format(std::pmr::polymorphic_allocator<char>(resource), format, std::forward<Args>(args)...);
+    }
+#endif
+}
+#endif //ARENA_HPP
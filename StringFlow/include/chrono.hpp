@@ -0,0 +1,415 @@
+//
+// Created by ruixuezhao on 25-3-19.
+//
+
+#ifndef CHRONO_HPP
+#define CHRONO_HPP
+#include <chrono>
+#include <cstring>
+#include "format.hpp"
+
+/**
+ * @brief std::chrono::system_clock::time_point 与 std::chrono::duration 的格式化
+ *
+ * @note 时间点按 UTC 输出, 格式说明为 strftime 风格的子集:
+ *       %Y 年  %m 月  %d 日  %H 时  %M 分  %S 秒  %f 微秒(6 位), %3f/%6f/%9f 指定小数位数
+ *       %F 等价于 %Y-%m-%d  %T 等价于 %H:%M:%S  %z 输出 +0000  %Z 输出 UTC  %% 输出 %
+ *       缺省为 %F %T, 时间点精度高于秒时附加相应位数的小数秒.
+ *
+ *       StringFlow::println("[{:%Y-%m-%dT%H:%M:%S.%f}] {}", std::chrono::system_clock::now(), msg).unwrap();
+ *
+ *       日志时间戳在同一分钟内只有秒与小数秒会变化: 每个线程缓存最近渲染的结果, 分钟不变时只改写这几位数字.
+ *       纪元日数到年月日的转换使用整数算法(civil_from_days), 不调用 gmtime_r/localtime_r.
+ */
+namespace StringFlow {
+    namespace details {
+        struct civil_date {
+            int64_t year;
+            unsigned month;
+            unsigned day;
+        };
+
+        /**
+         * @brief 1970-01-01 起的天数转换为公历日期(Howard Hinnant 的 days_from_civil 逆算法)
+         */
+        constexpr civil_date civil_from_days(int64_t days) {
+            days += 719468;
+            const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+            const auto doe = static_cast<unsigned>(days - era * 146097);                 // [0, 146096]
+            const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+            const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                // [0, 365]
+            const unsigned mp = (5 * doy + 2) / 153;                                     // [0, 11]
+            const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+            const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+            return {static_cast<int64_t>(yoe) + era * 400 + (month <= 2), month, day};
+        }
+
+        // "00" 到 "99" 的两位数字表
+        struct decimal_pairs {
+            char data[200];
+
+            constexpr decimal_pairs() : data{} {
+                for (size_t i = 0; i < 100; ++i) {
+                    data[i * 2] = static_cast<char>('0' + i / 10);
+                    data[i * 2 + 1] = static_cast<char>('0' + i % 10);
+                }
+            }
+        };
+        static constexpr decimal_pairs two_digits{};
+
+        inline char *write_2digits(char *pos, unsigned value) {
+            memcpy(pos, two_digits.data + (value % 100) * 2, 2);
+            return pos + 2;
+        }
+
+        // 小数秒的前 digits 位
+        inline char *write_fraction(char *pos, uint32_t nanos, unsigned digits) {
+            char buffer[9];
+            for (int i = 8; i >= 0; --i) {
+                buffer[i] = static_cast<char>('0' + nanos % 10);
+                nanos /= 10;
+            }
+            memcpy(pos, buffer, digits);
+            return pos + digits;
+        }
+
+        struct time_fields {
+            bool negative = false;  // 仅用于 duration
+            int64_t year = 0;
+            unsigned month = 0;
+            unsigned day = 0;
+            int64_t hour = 0;       // duration 为总小时数
+            unsigned minute = 0;
+            unsigned second = 0;
+            uint32_t nanos = 0;
+        };
+
+        // 渲染结果中秒(kind 为 'S')与小数秒(kind 为 'f')所在的位置
+        struct time_patch {
+            char kind;
+            uint8_t digits;
+            uint8_t offset;
+        };
+
+        static constexpr size_t time_text_capacity = 128;
+        static constexpr size_t time_pattern_capacity = 64;
+        // 每个补丁至少对应格式中的两个字符("%S"), 可缓存的格式产生的补丁不会超出此容量
+        static constexpr size_t time_patch_capacity = time_pattern_capacity / 2;
+
+        /**
+         * @brief 按 pattern 渲染时间, 结果超过 time_text_capacity 时返回 0
+         *
+         * @note 超出 time_patch_capacity 的补丁被丢弃, 只有长度不超过 time_pattern_capacity 的格式才会缓存
+         */
+        inline size_t render_time(char *out, const char *pattern, size_t size, const time_fields &fields,
+                                  time_patch *patches, size_t &patch_count) {
+            char *pos = out;
+            char *const end = out + time_text_capacity;
+            patch_count = 0;
+            auto patch = [&](char kind, unsigned digits) {
+                if (patch_count < time_patch_capacity)
+                    patches[patch_count++] = {kind, static_cast<uint8_t>(digits), static_cast<uint8_t>(pos - out)};
+            };
+            auto write_year = [&] {
+                char digits[24];
+                int64_t year = fields.year;
+                if (year < 0) {
+                    *pos++ = '-';
+                    year = -year;
+                }
+                const size_t length = itoa(static_cast<uint64_t>(year), digits);
+                for (size_t i = length; i < 4; ++i) *pos++ = '0';
+                memcpy(pos, digits, length);
+                pos += length;
+            };
+            auto write_hour = [&] {
+                if (fields.hour < 100) {
+                    pos = write_2digits(pos, static_cast<unsigned>(fields.hour));
+                } else {
+                    pos += itoa(static_cast<uint64_t>(fields.hour), pos);
+                }
+            };
+            auto write_second = [&] {
+                patch('S', 2);
+                pos = write_2digits(pos, fields.second);
+            };
+
+            if (fields.negative) *pos++ = '-';
+            for (size_t i = 0; i < size; ++i) {
+                // 每个转换最多写入 24 个字符, 预留足够的空间
+                if (end - pos < 32) return 0;
+                if (pattern[i] != '%' || i + 1 == size) {
+                    *pos++ = pattern[i];
+                    continue;
+                }
+
+                char spec = pattern[++i];
+                unsigned digits = 6;
+                if (spec >= '1' && spec <= '9' && i + 1 < size && pattern[i + 1] == 'f') {
+                    digits = static_cast<unsigned>(spec - '0');
+                    spec = pattern[++i];
+                }
+                switch (spec) {
+                    case 'Y': write_year(); break;
+                    case 'm': pos = write_2digits(pos, fields.month); break;
+                    case 'd': pos = write_2digits(pos, fields.day); break;
+                    case 'H': write_hour(); break;
+                    case 'M': pos = write_2digits(pos, fields.minute); break;
+                    case 'S': write_second(); break;
+                    case 'f':
+                        patch('f', digits);
+                        pos = write_fraction(pos, fields.nanos, digits);
+                        break;
+                    case 'F':
+                        write_year();
+                        *pos++ = '-';
+                        pos = write_2digits(pos, fields.month);
+                        *pos++ = '-';
+                        pos = write_2digits(pos, fields.day);
+                        break;
+                    case 'T':
+                        write_hour();
+                        *pos++ = ':';
+                        pos = write_2digits(pos, fields.minute);
+                        *pos++ = ':';
+                        write_second();
+                        break;
+                    case 'z': memcpy(pos, "+0000", 5); pos += 5; break;
+                    case 'Z': memcpy(pos, "UTC", 3); pos += 3; break;
+                    case '%': *pos++ = '%'; break;
+                    default:
+                        // 不支持的转换原样输出
+                        *pos++ = '%';
+                        *pos++ = spec;
+                        break;
+                }
+            }
+            return static_cast<size_t>(pos - out);
+        }
+
+        /**
+         * @brief 每个线程缓存最近几个格式的渲染结果, 以格式内容与分钟为键
+         */
+        struct time_cache_entry {
+            char pattern[time_pattern_capacity];
+            size_t pattern_size = 0;
+            int64_t minute = 0;
+            bool valid = false;
+            char text[time_text_capacity];
+            size_t size = 0;
+            time_patch patches[time_patch_capacity];
+            size_t patch_count = 0;
+        };
+
+        struct time_cache {
+            time_cache_entry entries[4];
+            size_t next = 0;
+
+            static time_cache &thread() {
+                thread_local time_cache cache;
+                return cache;
+            }
+        };
+
+        /**
+         * @brief 渲染时间点, 同一分钟内命中缓存时只改写秒与小数秒
+         *
+         * @return 指向渲染结果的指针(线程局部或 out), 失败时返回 nullptr
+         */
+        inline const char *render_time_point(char *out, size_t &size, const char *pattern, size_t pattern_size,
+                                             int64_t seconds, uint32_t nanos) {
+            const int64_t minute = seconds >= 0 ? seconds / 60 : (seconds - 59) / 60;
+            const auto second = static_cast<unsigned>(seconds - minute * 60);
+
+            time_cache &cache = time_cache::thread();
+            const bool cacheable = pattern_size <= sizeof(time_cache_entry::pattern);
+            if (cacheable) {
+                for (auto &entry : cache.entries) {
+                    if (!entry.valid || entry.minute != minute || entry.pattern_size != pattern_size ||
+                        memcmp(entry.pattern, pattern, pattern_size) != 0)
+                        continue;
+                    for (size_t i = 0; i < entry.patch_count; ++i) {
+                        const time_patch &patch = entry.patches[i];
+                        if (patch.kind == 'S')
+                            write_2digits(entry.text + patch.offset, second);
+                        else
+                            write_fraction(entry.text + patch.offset, nanos, patch.digits);
+                    }
+                    size = entry.size;
+                    return entry.text;
+                }
+            }
+
+            const int64_t days = minute >= 0 ? minute / 1440 : (minute - 1439) / 1440;
+            const auto minute_of_day = static_cast<unsigned>(minute - days * 1440);
+            const civil_date date = civil_from_days(days);
+            time_fields fields;
+            fields.year = date.year;
+            fields.month = date.month;
+            fields.day = date.day;
+            fields.hour = minute_of_day / 60;
+            fields.minute = minute_of_day % 60;
+            fields.second = second;
+            fields.nanos = nanos;
+
+            if (!cacheable) {
+                time_patch patches[time_patch_capacity];
+                size_t patch_count = 0;
+                size = render_time(out, pattern, pattern_size, fields, patches, patch_count);
+                return size ? out : nullptr;
+            }
+
+            time_cache_entry &entry = cache.entries[cache.next++ % 4];
+            entry.size = render_time(entry.text, pattern, pattern_size, fields, entry.patches, entry.patch_count);
+            entry.valid = entry.size != 0;
+            if (!entry.valid) return nullptr;
+            memcpy(entry.pattern, pattern, pattern_size);
+            entry.pattern_size = pattern_size;
+            entry.minute = minute;
+            size = entry.size;
+            return entry.text;
+        }
+
+        // 精度高于秒的时间类型在缺省格式中附加的小数位数
+        template <class Period>
+        constexpr const char *default_time_pattern() {
+            if constexpr (Period::den >= 1000000000 * Period::num)
+                return "%F %T.%9f";
+            else if constexpr (Period::den >= 1000000 * Period::num)
+                return "%F %T.%6f";
+            else if constexpr (Period::den >= 1000 * Period::num)
+                return "%F %T.%3f";
+            else
+                return "%F %T";
+        }
+    }
+
+    /**
+     * @brief 格式说明含 '%' 时按 strftime 风格输出; 否则使用缺省格式, 说明中的填充、对齐与宽度作用于整个时间文本
+     */
+    template <class Duration>
+    struct formatter<std::chrono::time_point<std::chrono::system_clock, Duration>> {
+        const char *pattern = details::default_time_pattern<typename Duration::period>();
+        size_t pattern_size = strlen(pattern);
+        FormatterOption align_option;
+
+        void parse(const Context &context, const FormatterOption &option) {
+            if (!context.colon || context.colon + 1 >= context.end) return;
+            if (!memchr(context.colon + 1, '%', context.end - context.colon - 1)) {
+                // 例如 {:>25}: 与 duration 相同, 使用已解析的填充/对齐/宽度
+                align_option = option;
+                return;
+            }
+            pattern = context.colon + 1;
+            pattern_size = static_cast<size_t>(context.end - pattern);
+        }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const std::chrono::time_point<std::chrono::system_clock, Duration> &time,
+                                         output_str_function_wrap &&out_fct_wrap) const {
+            const auto since_epoch = time.time_since_epoch();
+            const auto seconds = std::chrono::floor<std::chrono::seconds>(since_epoch);
+            const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - seconds);
+
+            char buffer[details::time_text_capacity];
+            size_t size = 0;
+            const char *text = details::render_time_point(buffer, size, pattern, pattern_size, seconds.count(),
+                                                          static_cast<uint32_t>(nanos.count()));
+            if (!text) return Err(format_error::buffer_full);
+            return handle_rev(out_fct_wrap, align_option, text, size);
+        }
+    };
+
+    namespace details {
+        template <class Period>
+        constexpr const char *duration_suffix() {
+            if constexpr (std::is_same_v<Period, std::nano>) return "ns";
+            else if constexpr (std::is_same_v<Period, std::micro>) return "us";
+            else if constexpr (std::is_same_v<Period, std::milli>) return "ms";
+            else if constexpr (std::is_same_v<Period, std::ratio<1>>) return "s";
+            else if constexpr (std::is_same_v<Period, std::ratio<60>>) return "min";
+            else if constexpr (std::is_same_v<Period, std::ratio<3600>>) return "h";
+            else if constexpr (std::is_same_v<Period, std::ratio<86400>>) return "d";
+            else return nullptr;
+        }
+    }
+
+    /**
+     * @brief duration 缺省输出数值与单位(如 15ms); 格式说明含 '%' 时按 %H:%M:%S.%f 输出经过的时间, %H 为总小时数
+     */
+    template <class Rep, class Period>
+    struct formatter<std::chrono::duration<Rep, Period>> {
+        const char *pattern = nullptr;
+        size_t pattern_size = 0;
+        Context count_context;
+        FormatterOption count_option;
+
+        void parse(const Context &context, const FormatterOption &option) {
+            count_context = context;
+            count_option = option;
+            if (context.colon && memchr(context.colon + 1, '%', context.end - context.colon - 1)) {
+                pattern = context.colon + 1;
+                pattern_size = static_cast<size_t>(context.end - pattern);
+            }
+        }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const std::chrono::duration<Rep, Period> &duration,
+                                         output_str_function_wrap &&out_fct_wrap) const {
+            if (!pattern) return format_count(duration, out_fct_wrap);
+
+            const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+            details::time_fields fields;
+            fields.negative = nanos < 0;
+            const uint64_t total = fields.negative ? 0 - static_cast<uint64_t>(nanos) : static_cast<uint64_t>(nanos);
+            const uint64_t seconds = total / 1000000000;
+            fields.nanos = static_cast<uint32_t>(total % 1000000000);
+            fields.second = static_cast<unsigned>(seconds % 60);
+            fields.minute = static_cast<unsigned>(seconds / 60 % 60);
+            fields.hour = static_cast<int64_t>(seconds / 3600);
+
+            char buffer[details::time_text_capacity];
+            details::time_patch patches[details::time_patch_capacity];
+            size_t patch_count = 0;
+            const size_t size = details::render_time(buffer, pattern, pattern_size, fields, patches, patch_count);
+            if (!size) return Err(format_error::buffer_full);
+            details::write_span(out_fct_wrap, buffer, size);
+            return Ok(true);
+        }
+
+    private:
+        // 数值与单位一起参与对齐, 例如 {:>8} 输出 "    15ms"
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format_count(const std::chrono::duration<Rep, Period> &duration,
+                                               output_str_function_wrap &out_fct_wrap) const {
+            char buffer[64];
+            size_t size = 0;
+            auto append = [&](char ch) {
+                if (size < sizeof(buffer)) buffer[size++] = ch;
+            };
+            FormatterOption plain = count_option;
+            plain.width = 0;
+            auto formatted = details::format_value(append, Context{}, plain, duration.count());
+            if (formatted.is_err()) return formatted;
+
+            constexpr const char *suffix = details::duration_suffix<typename Period::type>();
+            if constexpr (suffix != nullptr) {
+                for (const char *iter = suffix; *iter; ++iter) append(*iter);
+            } else {
+                char ratio[48];
+                size_t length = 0;
+                ratio[length++] = '[';
+                length += itoa(static_cast<intmax_t>(Period::num), ratio + length);
+                if (Period::den != 1) {
+                    ratio[length++] = '/';
+                    length += itoa(static_cast<intmax_t>(Period::den), ratio + length);
+                }
+                ratio[length++] = ']';
+                ratio[length++] = 's';
+                for (size_t i = 0; i < length; ++i) append(ratio[i]);
+            }
+            return handle_rev(out_fct_wrap, count_option, buffer, size);
+        }
+    };
+}
+#endif //CHRONO_HPP
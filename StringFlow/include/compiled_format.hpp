@@ -0,0 +1,390 @@
+//
+// Created by ruixuezhao on 25-3-13.
+//
+
+#ifndef COMPILED_FORMAT_HPP
+#define COMPILED_FORMAT_HPP
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "format.hpp"
+
+/**
+ * @brief 预编译的运行期格式模板
+ *
+ * @note 格式字符串来自配置等运行期数据时, 先 compile 一次, 保存文本段与每个字段解析好的
+ *       Context/FormatterOption, 之后每次格式化都跳过花括号扫描与 unpack_to:
+ *
+ *       auto tpl = StringFlow::compiled_format::compile(config_line).unwrap();
+ *       StringFlow::format_to(putchar, tpl, user, count).unwrap();
+ *
+ *       也可以交给全局 LRU 缓存(以格式字符串内容为键):
+ *       StringFlow::format_to(putchar, StringFlow::cached(config_line), user, count).unwrap();
+ *
+ *       参数类型固定时可再绑定类型, 自定义类型的 formatter<T> 只在绑定时 parse 一次:
+ *       auto typed = tpl.bind<order, int>().unwrap();
+ *       StringFlow::format_to(putchar, typed, order, count).unwrap();
+ */
+namespace StringFlow {
+    template <typename... Args>
+    class bound_format;
+
+    class compiled_format {
+    public:
+        /**
+         * @brief 一个文本段以及紧随其后的字段(可能没有字段)
+         */
+        struct segment {
+            const char *text = nullptr;  // 字段之前的文本
+            size_t text_size = 0;
+            bool has_field = false;
+            size_t arg_index = 0;        // 参数下标, 未能在编译时解析的具名字段为 npos_arg
+            const char *name = nullptr;  // 未能在编译时解析的参数名
+            size_t name_size = 0;
+            Context context;
+            FormatterOption option;
+        };
+
+        /**
+         * @brief 解析格式字符串, 内部保存一份拷贝, 原字符串可随后释放
+         *
+         * @param names 可选的名字表, 具名字段在编译时解析为下标; 否则在格式化时于参数包中查找
+         * @return 花括号不匹配时错误中带有出错位置的偏移
+         */
+        static Result<compiled_format, format_error_info> compile(const char *format, const name_table *names = nullptr) {
+            if (!format) return Err(format_error_info(format_error::invalid_alignment));
+
+            compiled_format compiled(format);
+            segment pending;
+            auto scanned = details::scan_format(compiled.m_format.get(),
+                [&](const char *text, size_t size) {
+                    // 转义的花括号会把一段文本拆成相邻的几段, 合并后再保存
+                    if (pending.text && pending.text + pending.text_size == text) {
+                        pending.text_size += size;
+                    } else {
+                        if (pending.text) compiled.m_segments.push_back(pending);
+                        pending = segment{};
+                        pending.text = text;
+                        pending.text_size = size;
+                    }
+                },
+                [&](const Context &context, size_t arg_index, const char *name, size_t name_size) {
+                    pending.has_field = true;
+                    pending.arg_index = arg_index;
+                    pending.context = context;
+                    context.unpack_to(pending.option);
+                    if (name) {
+                        pending.arg_index = names ? names->index_of(name, name_size) : npos_arg;
+                        if (!names) {
+                            pending.name = name;
+                            pending.name_size = name_size;
+                        }
+                    }
+                    compiled.m_segments.push_back(pending);
+                    pending = segment{};
+                });
+            if (scanned.is_err()) return Err(scanned.unwrap_err());
+            if (pending.text) compiled.m_segments.push_back(pending);
+
+            return Ok(std::move(compiled));
+        }
+
+        /**
+         * @brief 绑定参数类型, 为带 formatter<T> 特化的类类型字段构造 formatter 并 parse 一次
+         *
+         * @note 返回的 bound_format 引用本模板, 本模板须比它存活得更久; 字段下标超出参数个数时返回错误
+         */
+        template <typename... Args>
+        Result<bound_format<std::decay_t<Args>...>, format_error_info> bind() const &;
+        template <typename... Args>
+        void bind() && = delete;
+
+        compiled_format(compiled_format &&) noexcept = default;
+        compiled_format &operator=(compiled_format &&) noexcept = default;
+        compiled_format(const compiled_format &) = delete;
+        compiled_format &operator=(const compiled_format &) = delete;
+
+        const std::vector<segment> &segments() const { return m_segments; }
+        const char *c_str() const { return m_format.get(); }
+
+    private:
+        explicit compiled_format(const char *format) {
+            const size_t size = strlen(format);
+            m_format.reset(new char[size + 1]);
+            memcpy(m_format.get(), format, size + 1);
+        }
+
+        // 所有段与 Context 都指向这份拷贝, unique_ptr 在移动时不会改变地址
+        std::unique_ptr<char[]> m_format;
+        std::vector<segment> m_segments;
+    };
+
+    namespace details {
+        template <typename T>
+        struct type_identity {
+            using type = T;
+        };
+        template <typename T>
+        using type_identity_t = typename type_identity<T>::type;
+
+        // 绑定模板只为带 formatter<T> 特化的类类型保留已 parse 的 formatter, 其余类型的格式选项已在编译时解析
+        template <typename T>
+        inline constexpr bool binds_formatter_v = type_check<T>::is_class_v && has_formatter<T>::value;
+
+        template <typename T, bool = binds_formatter_v<T>>
+        struct bound_formatters {
+            std::vector<formatter<T>> parsed;
+        };
+
+        template <typename T>
+        struct bound_formatters<T, false> {};
+    }
+
+    /**
+     * @brief 绑定了参数类型的预编译模板, 由 compiled_format::bind<Args...>() 创建
+     *
+     * @note 自定义类型字段的 formatter 在绑定时构造并 parse, 每次格式化只调用其 format;
+     *       未在编译时解析的具名字段每次在参数包中查找, 其 formatter 仍按次构造
+     */
+    template <typename... Args>
+    class bound_format {
+    public:
+        const compiled_format &compiled() const { return *m_format; }
+
+        // 与 format_to(out, policy, compiled_format, args...) 相同, 只是跳过自定义类型的 parse
+        template <class output_str_function_wrap>
+        Result<size_t, format_error_info> format_to(output_str_function_wrap &&out_fct_wrap, error_policy policy, const Args &...args) const {
+            const auto &segments = m_format->segments();
+            const auto values = std::forward_as_tuple(args...);
+            size_t count = 0;
+            size_t field = 0;
+            format_error_info error;
+            for (size_t i = 0; i < segments.size(); ++i) {
+                const compiled_format::segment &segment = segments[i];
+                details::write_span(out_fct_wrap, segment.text, segment.text_size);
+                if (!segment.has_field) continue;
+
+                const size_t arg_index = segment.name ? details::find_named_arg<0>(segment.name, segment.name_size, args...)
+                                                      : segment.arg_index;
+                auto formatted = format_field<0>(segment, arg_index, m_slots[i], out_fct_wrap, values);
+                const size_t index = field++;
+                if (STRINGFLOW_LIKELY(formatted.is_ok())) {
+                    ++count;
+                    continue;
+                }
+                const format_error_info failed(formatted.unwrap_err(), index, segment.context.begin - m_format->c_str());
+                if (!details::record_field_error(policy, error, failed)) break;
+            }
+            if (STRINGFLOW_UNLIKELY(error.code() != format_error::success) && policy != error_policy::ignore) return Err(error);
+            return Ok(count);
+        }
+
+    private:
+        friend class compiled_format;
+
+        explicit bound_format(const compiled_format &format) : m_format(&format) {}
+
+        static Result<bound_format, format_error_info> bind(const compiled_format &format) {
+            bound_format bound(format);
+            bound.m_slots.reserve(format.segments().size());
+            size_t field = 0;
+            for (const auto &segment : format.segments()) {
+                size_t slot = npos_arg;
+                if (segment.has_field) {
+                    if (!segment.name && segment.arg_index >= sizeof...(Args))
+                        return Err(format_error_info(format_error::argument_index_out_of_range, field,
+                                                     segment.context.begin - format.c_str()));
+                    if (!segment.name) slot = bound.template parse_field<0>(segment);
+                    ++field;
+                }
+                bound.m_slots.push_back(slot);
+            }
+            return Ok(std::move(bound));
+        }
+
+        // 为引用第 Index 个参数的字段构造并 parse formatter, 返回其下标; 不需要缓存时返回 npos_arg
+        template <size_t Index>
+        size_t parse_field(const compiled_format::segment &segment) {
+            if constexpr (Index == sizeof...(Args)) {
+                return npos_arg;
+            } else {
+                if (segment.arg_index != Index) return parse_field<Index + 1>(segment);
+                using T = std::tuple_element_t<Index, std::tuple<Args...>>;
+                if constexpr (details::binds_formatter_v<T>) {
+                    auto &parsed = std::get<Index>(m_formatters).parsed;
+                    parsed.emplace_back();
+                    parsed.back().parse(segment.context, segment.option);
+                    return parsed.size() - 1;
+                } else {
+                    return npos_arg;
+                }
+            }
+        }
+
+        template <size_t Index, class output_str_function_wrap, typename Values>
+        Result<bool, format_error> format_field(const compiled_format::segment &segment, size_t arg_index, size_t slot,
+                                                output_str_function_wrap &out_fct_wrap, const Values &values) const {
+            if constexpr (Index == sizeof...(Args)) {
+                return Err(format_error::argument_index_out_of_range);
+            } else {
+                if (arg_index != Index) return format_field<Index + 1>(segment, arg_index, slot, out_fct_wrap, values);
+                using T = std::tuple_element_t<Index, std::tuple<Args...>>;
+                if constexpr (details::binds_formatter_v<T>) {
+                    if (slot != npos_arg) return std::get<Index>(m_formatters).parsed[slot].format(std::get<Index>(values), out_fct_wrap);
+                }
+                return details::format_value(out_fct_wrap, segment.context, segment.option, std::get<Index>(values));
+            }
+        }
+
+        const compiled_format *m_format;
+        std::vector<size_t> m_slots;  // 每个段在其参数的 formatter 列表中的下标, 没有时为 npos_arg
+        std::tuple<details::bound_formatters<Args>...> m_formatters;
+    };
+
+    template <typename... Args>
+    Result<bound_format<std::decay_t<Args>...>, format_error_info> compiled_format::bind() const & {
+        return bound_format<std::decay_t<Args>...>::bind(*this);
+    }
+
+    /**
+     * @brief 线程安全的 LRU 格式模板缓存, 以格式字符串内容为键
+     *
+     * @note 查找时对内容求哈希并逐字节比较, 调用方的字符串可以随后释放或改写, 同一地址换了内容也不会命中旧模板;
+     *       键指向模板内部保存的拷贝, 与模板一起淘汰
+     */
+    class format_cache {
+    public:
+        using value_type = std::shared_ptr<const compiled_format>;
+
+        explicit format_cache(size_t capacity = 256) : m_capacity(capacity ? capacity : 1) {}
+
+        Result<value_type, format_error_info> get(const char *format) {
+            if (!format) return Err(format_error_info(format_error::invalid_alignment));
+            const std::string_view key(format);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto iter = m_index.find(key);
+                if (iter != m_index.end()) {
+                    m_lru.splice(m_lru.begin(), m_lru, iter->second);
+                    return Ok(iter->second->second);
+                }
+            }
+
+            // 解析放在锁外, 避免阻塞其他线程的命中路径
+            auto compiled = compiled_format::compile(format);
+            if (compiled.is_err()) return Err(compiled.unwrap_err());
+            value_type value = std::make_shared<const compiled_format>(std::move(compiled).unwrap());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_index.find(key);
+            if (iter != m_index.end()) {
+                m_lru.splice(m_lru.begin(), m_lru, iter->second);
+                return Ok(iter->second->second);
+            }
+            m_lru.emplace_front(std::string_view(value->c_str(), key.size()), value);
+            m_index.emplace(m_lru.front().first, m_lru.begin());
+            if (m_lru.size() > m_capacity) {
+                m_index.erase(m_lru.back().first);
+                m_lru.pop_back();
+            }
+            return Ok(std::move(value));
+        }
+
+        void erase(const char *format) {
+            if (!format) return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_index.find(std::string_view(format));
+            if (iter == m_index.end()) return;
+            m_lru.erase(iter->second);
+            m_index.erase(iter);
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_index.clear();
+            m_lru.clear();
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_lru.size();
+        }
+
+        static format_cache &global() {
+            static format_cache cache;
+            return cache;
+        }
+
+    private:
+        // 键指向 value 中保存的格式串拷贝
+        using entry = std::pair<std::string_view, value_type>;
+
+        mutable std::mutex m_mutex;
+        std::list<entry> m_lru;
+        std::unordered_map<std::string_view, std::list<entry>::iterator> m_index;
+        size_t m_capacity;
+    };
+
+    /**
+     * @brief 标记格式字符串走全局缓存, 用法: format_to(out, cached(format), args...)
+     */
+    struct cached_format {
+        const char *format;
+    };
+    inline cached_format cached(const char *format) { return {format}; }
+
+    // 字段出错时的处理与 format_to(out, policy, format, args...) 相同, 偏移为字段在模板中的位置
+    template <class output_str_function_wrap, typename... Args>
+    Result<size_t, format_error_info> format_to(output_str_function_wrap &&out_fct_wrap, error_policy policy, const compiled_format &format, Args &&...args) {
+        size_t count = 0;
+        size_t field = 0;
+        format_error_info error;
+        for (const auto &segment : format.segments()) {
+            details::write_span(out_fct_wrap, segment.text, segment.text_size);
+            if (!segment.has_field) continue;
+
+            const size_t arg_index = segment.name ? details::find_named_arg<0>(segment.name, segment.name_size, args...)
+                                                  : segment.arg_index;
+            auto formatted = formatter_to<0>(arg_index, out_fct_wrap, segment.context, segment.option, args...);
+            const size_t index = field++;
+            if (STRINGFLOW_LIKELY(formatted.is_ok())) {
+                ++count;
+                continue;
+            }
+            const format_error_info failed(formatted.unwrap_err(), index, segment.context.begin - format.c_str());
+            if (!details::record_field_error(policy, error, failed)) break;
+        }
+        if (STRINGFLOW_UNLIKELY(error.code() != format_error::success) && policy != error_policy::ignore) return Err(error);
+        return Ok(count);
+    }
+
+    template <class output_str_function_wrap, typename... Args>
+    Result<size_t, format_error_info> format_to(output_str_function_wrap &&out_fct_wrap, const compiled_format &format, Args &&...args) {
+        return format_to(out_fct_wrap, error_policy::stop, format, std::forward<Args>(args)...);
+    }
+
+    template <class output_str_function_wrap, typename... Args>
+    Result<size_t, format_error_info> format_to(output_str_function_wrap &&out_fct_wrap, cached_format format, Args &&...args) {
+        auto compiled = format_cache::global().get(format.format);
+        if (compiled.is_err()) return Err(compiled.unwrap_err());
+        return format_to(out_fct_wrap, error_policy::stop, *compiled.unwrap(), std::forward<Args>(args)...);
+    }
+
+    template <class output_str_function_wrap, typename... Args>
+    Result<size_t, format_error_info> format_to(output_str_function_wrap &&out_fct_wrap, error_policy policy, const bound_format<Args...> &format,
+                                                const details::type_identity_t<Args> &...args) {
+        return format.format_to(out_fct_wrap, policy, args...);
+    }
+
+    template <class output_str_function_wrap, typename... Args>
+    Result<size_t, format_error_info> format_to(output_str_function_wrap &&out_fct_wrap, const bound_format<Args...> &format,
+                                                const details::type_identity_t<Args> &...args) {
+        return format.format_to(out_fct_wrap, error_policy::stop, args...);
+    }
+}
+#endif //COMPILED_FORMAT_HPP
@@ -0,0 +1,325 @@
+//
+// Created by ruixuezhao on 25-3-25.
+//
+
+#ifndef ERROR_HPP
+#define ERROR_HPP
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include "itoa.hpp"
+#include "utils.hpp"
+#include "result/result.h"
+
+/**
+ * @brief 错误类别与错误码, 以及格式化错误码与错误位置; 单独成文件, 供不需要完整 format.hpp 的头文件(如 vformat.hpp)使用
+ *
+ * @note 与 std::error_code 的思路相同, 但没有虚函数: 每个类别是一张编译期的说明表, error_code 只保存
+ *       错误值与类别编号(共 8 字节), Result<T, error_code> 在 T 不超过 8 字节时仍是两个字.
+ *       各子系统的错误枚举提供一个可由 ADL 找到的 error_category_of(Enum) 即可隐式转换为 error_code:
+ *
+ *       enum class db_error { ok, timeout, deadlock };
+ *       inline constexpr std::string_view db_messages[] = {"Success", "Timeout", "Deadlock"};
+ *       inline const StringFlow::error_category db_category("db", db_messages);
+ *       inline const StringFlow::error_category &error_category_of(db_error) { return db_category; }
+ *
+ *       StringFlow::error_code code = db_error::timeout;    // code.message() == "Timeout", code.category().name() == "db"
+ *       std::error_code ec = code.to_std();                  // 与标准库互通
+ */
+namespace StringFlow {
+    namespace details {
+        template <size_t N>
+        constexpr std::string_view error_message(const std::string_view (&messages)[N], int value) {
+            return value >= 0 && static_cast<size_t>(value) < N ? messages[value] : "Unknown error code";
+        }
+    }
+
+    /**
+     * @brief 错误类别: 名字加按错误值排列的说明表, 第一次用于 error_code 时分配编号
+     *
+     * @note 类别对象需为静态存储期(通常是 inline const 变量), 编号在进程内有效, 不可持久化
+     */
+    class error_category {
+    public:
+        // 进程内最多的类别数(含 generic), 超出时第一次使用新类别会 panic
+        static constexpr uint32_t max_categories = 256;
+
+        template <size_t N>
+        constexpr error_category(std::string_view name, const std::string_view (&messages)[N])
+            : m_name(name), m_messages(messages), m_count(N) {}
+
+        error_category(const error_category &) = delete;
+        error_category &operator=(const error_category &) = delete;
+
+        constexpr std::string_view name() const { return m_name; }
+
+        constexpr std::string_view message(int value) const {
+            return value >= 0 && static_cast<size_t>(value) < m_count ? m_messages[value] : "Unknown error code";
+        }
+
+        uint32_t id() const {
+            const uint32_t id = m_id.load(std::memory_order_acquire);
+            return STRINGFLOW_LIKELY(id) ? id : assign_id();
+        }
+
+        // 按编号查找类别, 未知编号返回 generic_category()
+        static const error_category &from_id(uint32_t id);
+
+    private:
+        uint32_t assign_id() const;
+
+        std::string_view m_name;
+        const std::string_view *m_messages;
+        size_t m_count;
+        mutable std::atomic<uint32_t> m_id{0};
+    };
+
+    namespace details {
+        inline constexpr std::string_view generic_messages[] = {"Success"};
+
+        struct error_category_table {
+            std::mutex mutex;
+            std::atomic<const error_category *> categories[error_category::max_categories] = {};
+            uint32_t count = 1;  // 0 号为 generic_category
+        };
+
+        inline error_category_table &category_table() {
+            static error_category_table table;
+            return table;
+        }
+    }
+
+    // 0 号类别: 默认构造的 error_code 属于它, 值 0 表示成功
+    inline const error_category &generic_category() {
+        static const error_category category("generic", details::generic_messages);
+        return category;
+    }
+
+    inline uint32_t error_category::assign_id() const {
+        auto &table = details::category_table();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        uint32_t id = m_id.load(std::memory_order_relaxed);
+        if (id) return id;
+        // 类别表已满: 静默退回 generic_category 会让错误码丢失类别, 直接终止
+        if (STRINGFLOW_UNLIKELY(table.count == max_categories))
+            result::details::panic("too many error categories", m_name, result::source_location::current());
+        id = table.count++;
+        table.categories[id].store(this, std::memory_order_release);
+        m_id.store(id, std::memory_order_release);
+        return id;
+    }
+
+    inline const error_category &error_category::from_id(uint32_t id) {
+        const error_category *category =
+            id && id < max_categories ? details::category_table().categories[id].load(std::memory_order_acquire) : nullptr;
+        return category ? *category : generic_category();
+    }
+
+    template <typename Enum, typename = void>
+    struct is_error_code_enum : std::false_type {};
+    template <typename Enum>
+    struct is_error_code_enum<Enum, std::enable_if_t<std::is_enum_v<Enum>,
+        std::void_t<decltype(error_category_of(std::declval<Enum>()))>>> : std::true_type {};
+
+    namespace details {
+        // 供 std::error_code 使用的类别适配, 只在转换为标准库类型时才经过虚函数
+        class std_category_adapter : public std::error_category {
+        public:
+            const char *name() const noexcept override { return category().name().data(); }
+            std::string message(int value) const override { return std::string(category().message(value)); }
+
+            const StringFlow::error_category &category() const { return StringFlow::error_category::from_id(id()); }
+            uint32_t id() const;
+        };
+
+        inline std_category_adapter *std_category_adapters() {
+            static std_category_adapter adapters[StringFlow::error_category::max_categories];
+            return adapters;
+        }
+
+        inline uint32_t std_category_adapter::id() const { return static_cast<uint32_t>(this - std_category_adapters()); }
+    }
+
+    /**
+     * @brief 错误值与类别编号, 共 8 字节; 值为 0 表示没有错误
+     */
+    class error_code {
+    public:
+        constexpr error_code() = default;
+        error_code(int value, const error_category &category) : m_value(value), m_category(category.id()) {}
+
+        template <typename Enum, typename = std::enable_if_t<is_error_code_enum<Enum>::value>>
+        error_code(Enum code) : error_code(static_cast<int>(code), error_category_of(code)) {}
+
+        /**
+         * @brief 由 std::error_code 转换: 来自 to_std() 的错误码还原为原类别, 其余的值保留, 类别为 generic
+         */
+        static error_code from_std(const std::error_code &code) {
+            const auto *adapter = dynamic_cast<const details::std_category_adapter *>(&code.category());
+            error_code converted;
+            converted.m_value = code.value();
+            converted.m_category = adapter ? adapter->id() : 0;
+            return converted;
+        }
+
+        constexpr int value() const { return m_value; }
+        const error_category &category() const { return error_category::from_id(m_category); }
+        std::string_view message() const { return category().message(m_value); }
+
+        std::error_code to_std() const { return {m_value, details::std_category_adapters()[m_category]}; }
+
+        constexpr explicit operator bool() const { return m_value != 0; }
+
+        friend constexpr bool operator==(error_code lhs, error_code rhs) {
+            return lhs.m_value == rhs.m_value && lhs.m_category == rhs.m_category;
+        }
+        friend constexpr bool operator!=(error_code lhs, error_code rhs) { return !(lhs == rhs); }
+
+    private:
+        int32_t m_value = 0;
+        uint32_t m_category = 0;
+    };
+
+    enum class format_error {
+        success = 0,
+        // 格式字符串错误
+        unmatched_brace,       // 花括号不匹配
+        invalid_format_spec,  // 无效格式说明符
+        argument_index_out_of_range,
+        // 类型错误
+        unsupported_type,
+        type_mismatch,
+        // 数值错误
+        number_overflow,
+        nan_format_error,
+        inf_format_error,
+        // 缓冲区错误
+        buffer_full,
+        // 对齐错误
+        invalid_alignment
+    };
+    // 按错误码顺序排列的说明, 均为静态字符串
+    inline constexpr std::string_view format_error_messages[] = {
+        "Success",
+        // 格式字符串错误
+        "Unmatched braces in format string",
+        "Invalid format specifier",
+        "Argument index out of range",
+        // 类型错误
+        "Unsupported data type",
+        "Type mismatch between format specifier and argument",
+        // 数值错误
+        "Number exceeds allowable range",
+        "Invalid NaN (Not-a-Number) formatting attempt",
+        "Invalid INF (Infinity) formatting attempt",
+        // 缓冲区错误
+        "Output buffer full",
+        // 对齐错误
+        "Invalid alignment specification",
+    };
+
+    // 查表返回静态字符串, 不分配内存
+    inline constexpr std::string_view format_error_to_string(format_error code) {
+        return details::error_message(format_error_messages, static_cast<int>(code));
+    }
+
+    /**
+     * @brief format_to 的错误: 错误码、出错字段的序号(从 0 开始)与该字段在格式字符串中的字节偏移
+     *
+     * @note 三者打包在一个 64 位字中(错误码 8 位, 字段序号 16 位, 偏移 40 位), Result 不会因此变大.
+     *       可隐式转换为 format_error, 原有的 err == format_error::xxx 与 format_error_to_string(err) 写法不变.
+     *       与具体字段无关的错误(如格式字符串为空)的字段序号为 npos_field.
+     */
+    class format_error_info {
+    public:
+        static constexpr size_t npos_field = 0xFFFF;
+
+        constexpr format_error_info() = default;
+        constexpr format_error_info(format_error code, size_t field = npos_field, size_t offset = 0)
+            : m_bits((static_cast<uint64_t>(code) & 0xFF) |
+                     (static_cast<uint64_t>(field < npos_field ? field : npos_field) << 8) |
+                     (static_cast<uint64_t>(offset < max_offset ? offset : max_offset) << 24)) {}
+
+        constexpr format_error code() const { return static_cast<format_error>(m_bits & 0xFF); }
+        constexpr size_t field() const { return static_cast<size_t>(m_bits >> 8 & 0xFFFF); }
+        constexpr size_t offset() const { return static_cast<size_t>(m_bits >> 24); }
+
+        constexpr operator format_error() const { return code(); }
+
+    private:
+        static constexpr size_t max_offset = (uint64_t(1) << 40) - 1;
+
+        uint64_t m_bits = 0;
+    };
+
+    /**
+     * @brief 字段格式化失败时 format_to 的处理方式
+     */
+    enum class error_policy : uint8_t {
+        stop,    // 在第一个出错的字段处停止输出, 返回该错误(缺省)
+        report,  // 继续输出其余字段, 结束后返回第一个错误
+        ignore,  // 跳过出错的字段, 返回成功格式化的字段数
+    };
+
+    inline const error_category format_category("format", format_error_messages);
+    inline const error_category &error_category_of(format_error) { return format_category; }
+
+    namespace details {
+        // 错误位置 " (field N, offset M)", 没有错误时为空; 供 formatter<format_error_info> 与 panic 共用
+        inline size_t format_error_position(const format_error_info &error, char (&buffer)[64]) {
+            if (error.code() == format_error::success) return 0;
+            size_t length = 0;
+            auto append = [&](const char *literal, size_t size) {
+                for (size_t i = 0; i < size; ++i) buffer[length++] = literal[i];
+            };
+            append(" (", 2);
+            if (error.field() != format_error_info::npos_field) {
+                append("field ", 6);
+                length += itoa(error.field(), buffer + length);
+                append(", ", 2);
+            }
+            append("offset ", 7);
+            length += itoa(error.offset(), buffer + length);
+            append(")", 1);
+            return length;
+        }
+    }
+
+    // unwrap/expect 失败时 result.h 通过 ADL 找到以下 panic_value 输出错误值, 不需要包含 format.hpp
+    template <class Out, typename Enum, typename = std::enable_if_t<is_error_code_enum<Enum>::value>>
+    void panic_value(Out &out, Enum code) {
+        const std::string_view text = error_category_of(code).message(static_cast<int>(code));
+        out(text.data(), text.size());
+    }
+
+    template <class Out>
+    void panic_value(Out &out, const error_code &code) {
+        const std::string_view name = code.category().name();
+        const std::string_view text = code.message();
+        out(name.data(), name.size());
+        out(": ", 2);
+        out(text.data(), text.size());
+    }
+
+    template <class Out>
+    void panic_value(Out &out, const format_error_info &error) {
+        const std::string_view text = format_error_to_string(error.code());
+        out(text.data(), text.size());
+        char buffer[64];
+        out(buffer, details::format_error_position(error, buffer));
+    }
+}
+
+// std::error_code ec = StringFlow::format_error::buffer_full;
+template <>
+struct std::is_error_code_enum<StringFlow::format_error> : std::true_type {};
+
+namespace StringFlow {
+    inline std::error_code make_error_code(format_error code) { return error_code(code).to_std(); }
+}
+#endif //ERROR_HPP
@@ -0,0 +1,126 @@
+//
+// Created by ruixuezhao on 25-3-20.
+//
+
+#ifndef ESCAPE_HPP
+#define ESCAPE_HPP
+#include <cstring>
+#include "stdint.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STRINGFLOW_ESCAPE_SSE2 1
+#endif
+
+/**
+ * @brief JSON 与 CSV 转义时查找需要处理的字节
+ *
+ * @note 绝大多数字符串不含需要转义的字符, 先整块扫描, 无需转义的片段整段拷贝.
+ *       支持 SSE2 时每次比较 16 字节, 否则每次按 8 字节的 SWAR 检查, 命中的块再逐字节定位.
+ */
+namespace StringFlow {
+    namespace details {
+        /**
+         * @brief 查找第一个属于 Chars 的字节, Control 为 true 时同时查找控制字符(< 0x20)
+         *
+         * @return 命中位置, 没有时返回 size
+         */
+        template <bool Control, char... Chars>
+        inline size_t find_special(const char *data, size_t size) {
+            auto is_special = [](char ch) {
+                return (Control && static_cast<uint8_t>(ch) < 0x20) || ((ch == Chars) || ...);
+            };
+            size_t i = 0;
+            // 不足一块时直接逐字节查找; 也让编译器看到短字面量不会进入块读取, 不再误报 -Warray-bounds
+            if (size < 16) {
+                for (; i < size; ++i)
+                    if (is_special(data[i])) return i;
+                return size;
+            }
+#if defined(STRINGFLOW_ESCAPE_SSE2)
+            const __m128i control = _mm_set1_epi8(0x1F);
+            for (; i + 16 <= size; i += 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                __m128i hit = _mm_setzero_si128();
+                if constexpr (Control)
+                    hit = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk);
+                ((hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(Chars)))), ...);
+                if (_mm_movemask_epi8(hit)) break;
+            }
+#else
+            constexpr uint64_t ones = 0x0101010101010101ULL;
+            constexpr uint64_t highs = 0x8080808080808080ULL;
+            // 某个字节为 0 时对应的最高位置 1; 块内是否命中是准确的
+            auto has_zero = [](uint64_t value) { return (value - ones) & ~value & highs; };
+            for (; i + 8 <= size; i += 8) {
+                uint64_t chunk;
+                memcpy(&chunk, data + i, sizeof(chunk));
+                uint64_t hit = Control ? (chunk - ones * 0x20) & ~chunk & highs : 0;
+                ((hit |= has_zero(chunk ^ (ones * static_cast<uint8_t>(Chars)))), ...);
+                if (hit) break;
+            }
+#endif
+            for (; i < size; ++i)
+                if (is_special(data[i])) return i;
+            return size;
+        }
+
+        // JSON 字符串中需要转义的字节: 控制字符、'"' 与 '\\'
+        inline size_t find_json_escape(const char *data, size_t size) {
+            return find_special<true, '"', '\\'>(data, size);
+        }
+
+        // CSV 字段含有这些字节时需要加引号
+        inline size_t find_csv_special(const char *data, size_t size) {
+            return find_special<false, ',', '"', '\r', '\n'>(data, size);
+        }
+
+        /**
+         * @brief 写入单个字节的 JSON 转义序列, 返回长度(2 或 6)
+         */
+        inline size_t json_escape(char ch, char *out) {
+            out[0] = '\\';
+            switch (ch) {
+                case '"':  out[1] = '"';  return 2;
+                case '\\': out[1] = '\\'; return 2;
+                case '\b': out[1] = 'b';  return 2;
+                case '\f': out[1] = 'f';  return 2;
+                case '\n': out[1] = 'n';  return 2;
+                case '\r': out[1] = 'r';  return 2;
+                case '\t': out[1] = 't';  return 2;
+                default: {
+                    constexpr char digits[] = "0123456789abcdef";
+                    const auto byte = static_cast<uint8_t>(ch);
+                    memcpy(out + 1, "u00", 3);
+                    out[4] = digits[byte >> 4];
+                    out[5] = digits[byte & 0x0F];
+                    return 6;
+                }
+            }
+        }
+
+        /**
+         * @brief JSON 转义(含两侧引号)比原文多出的字节数
+         */
+        inline size_t json_escape_overhead(const char *data, size_t size) {
+            size_t overhead = 2;
+            char escape[6];
+            for (size_t pos = find_json_escape(data, size); pos < size;
+                 pos += 1 + find_json_escape(data + pos + 1, size - pos - 1))
+                overhead += json_escape(data[pos], escape) - 1;
+            return overhead;
+        }
+
+        /**
+         * @brief CSV 字段转义比原文多出的字节数: 需要引号时为两侧引号加每个 '"' 的重复
+         */
+        inline size_t csv_escape_overhead(const char *data, size_t size) {
+            if (find_csv_special(data, size) == size) return 0;
+            size_t overhead = 2;
+            for (size_t pos = find_special<false, '"'>(data, size); pos < size;
+                 pos += 1 + find_special<false, '"'>(data + pos + 1, size - pos - 1))
+                ++overhead;
+            return overhead;
+        }
+    }
+}
+#endif //ESCAPE_HPP
@@ -6,9 +6,17 @@
 #define FORMAT_HPP
 #include <cmath>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <include/utils.hpp>
+#include <include/error.hpp>
 #include <include/type_traits.hpp>
 #include <include/itoa.hpp>
+#include <include/static_format.hpp>
+#include <include/named_args.hpp>
+#include <include/number_facet.hpp>
+#include <include/escape.hpp>
 #include "result/result.h"
 
 #include <algorithm>
@@ -18,108 +26,345 @@ using namespace result;
 namespace StringFlow {
     using OutputFunc =int(*)(const char *);
 
-    enum class format_error {
-        success = 0,
-        // 格式字符串错误
-        unmatched_brace,       // 花括号不匹配
-        invalid_format_spec,  // 无效格式说明符
-        argument_index_out_of_range,
-        // 类型错误
-        unsupported_type,
-        type_mismatch,
-        // 数值错误
-        number_overflow,
-        nan_format_error,
-        inf_format_error,
-        // 缓冲区错误
-        buffer_full,
-        // 对齐错误
-        invalid_alignment
-    };
-    inline std::string format_error_to_string(format_error code){
-        switch (code) {
-            // 成功状态
-            case format_error::success:
-                return "Success";
-
-            // 格式字符串错误
-            case format_error::unmatched_brace:
-                return "Unmatched braces in format string";
-            case format_error::invalid_format_spec:
-                return "Invalid format specifier";
-            case format_error::argument_index_out_of_range:
-                return "Argument index out of range";
-
-            // 类型错误
-            case format_error::unsupported_type:
-                return "Unsupported data type";
-            case format_error::type_mismatch:
-                return "Type mismatch between format specifier and argument";
-
-            // 数值错误
-            case format_error::number_overflow:
-                return "Number exceeds allowable range";
-            case format_error::nan_format_error:
-                return "Invalid NaN (Not-a-Number) formatting attempt";
-            case format_error::inf_format_error:
-                return "Invalid INF (Infinity) formatting attempt";
-
-            // 缓冲区错误
-            case format_error::buffer_full:
-                return "Output buffer full";
-
-            // 对齐错误
-            case format_error::invalid_alignment:
-                return "Invalid alignment specification";
-
-            // 未知错误处理
-            default:
-                return "Unknown error code: " + std::to_string(static_cast<int>(code));
+    //声明所需要的全部函数
+    template <class output_str_function_wrap,typename ... Args>
+    Result<size_t,format_error_info> format_to(output_str_function_wrap && output_str_function_wrap_,const char * format,Args&&...args);
+    template <class output_str_function_wrap,typename ... Args>
+    Result<size_t,format_error_info> format_to(output_str_function_wrap && output_str_function_wrap_,error_policy policy,const char * format,Args&&...args);
+    template <class output_str_function_wrap,typename ... Args>
+    Result<size_t,format_error_info> format_to(output_str_function_wrap && output_str_function_wrap_,const name_table &names,const char * format,Args&&...args);
+    namespace details {
+        template <class output_str_function_wrap,typename ... Args>
+        Result<size_t,format_error_info> format_to_impl(output_str_function_wrap && output_str_function_wrap_,const name_table *names,error_policy policy,const char * format,Args&&...args);
+
+        /**
+         * @brief 扫描格式字符串, 文本段交给 on_text(text, size), 每个 {...} 字段交给 on_field(context, index, name, name_size)
+         *
+         * @note "{{" 与 "}}" 输出单个花括号; 未闭合的 '{' 或单独的 '}' 返回 unmatched_brace 及其偏移.
+         *       具名字段的 index 为 npos_arg, name 指向名字; 否则 name 为 nullptr.
+         *       on_field 返回 bool 时, 返回 false 立即停止扫描
+         */
+        template <class TextHandler, class FieldHandler>
+        Result<bool,format_error_info> scan_format(const char *format, TextHandler &&on_text, FieldHandler &&on_field);
+
+        // 记录第一个字段错误, 返回是否继续格式化
+        STRINGFLOW_COLD inline bool record_field_error(error_policy policy, format_error_info &first, format_error_info error) {
+            if (first.code() == format_error::success) first = error;
+            return policy != error_policy::stop;
         }
     }
 
-    //声明所需要的全部函数
-    template <class output_str_function_wrap,typename ... Args>
-    Result<size_t,format_error> format_to(output_str_function_wrap && output_str_function_wrap_,const char * format,Args&&...args);
+    /**
+     * @brief 自定义类型的格式化特化点
+     *
+     * @note 特化需提供两个成员:
+     *       void parse(const Context &context, const FormatterOption &option);
+     *           每次格式化该字段时在新构造的 formatter 上调用一次; 经 compiled_format::bind<Args...>() 绑定类型的
+     *           模板在绑定时为每个字段 parse 一次并保留 formatter, 之后每次格式化只调用 format;
+     *           option 为 context 中标准格式说明已解析的结果(预编译模板中只在 compile 时解析一次),
+     *           需要自定义语法时可直接读取 context.colon + 1 到 context.end 之间的文本
+     *       template <class Out> Result<bool, format_error> format(const T &value, Out &&out) const;
+     *           直接写入输出函数, 不需要构造中间字符串
+     *
+     *       内置类型(整数、浮点、字符、布尔、字符串、指针)都有现成的 formatter, 包装类型可以直接委托:
+     *       template <> struct formatter<price> : formatter<double> {
+     *           template <class Out> Result<bool, format_error> format(const price &p, Out &&out) const {
+     *               return formatter<double>::format(p.cents / 100.0, out);
+     *           }
+     *       };
+     */
+    template <typename T, typename = void>
+    struct formatter {};
+
+    template <typename T, typename = void>
+    struct has_formatter : std::false_type {};
+    template <typename T>
+    struct has_formatter<T, void_t<decltype(std::declval<formatter<T> &>().parse(std::declval<const Context &>(), std::declval<const FormatterOption &>()))>> : std::true_type {};
+
+    namespace details {
+        // 格式化单个参数, option 为已由 context 解析好的格式选项
+        template <class output_str_function_wrap, typename Arg>
+        Result<bool,format_error> format_value(output_str_function_wrap &&out_fct_wrap, const Context &context, const FormatterOption &parsed, Arg &&arg);
+    }
+
+    /**
+     * @brief 内置类型的 formatter, parse 只保存格式选项, format 走与 format_to 相同的输出路径
+     */
+    template <typename T>
+    struct formatter<T, std::enable_if_t<!type_check<T>::is_class_v>> {
+        FormatterOption option;
+
+        void parse(const Context &, const FormatterOption &parsed) { option = parsed; }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const T &value, output_str_function_wrap &&out_fct_wrap) const {
+            return details::format_value(out_fct_wrap, Context{}, option, value);
+        }
+    };
+
+    namespace details {
+        /**
+         * @brief 容器元素等嵌套值的格式化器: 有 formatter<T> 时复用它(只 parse 一次), 否则退回 format_value
+         */
+        template <typename T, bool = has_formatter<T>::value>
+        struct nested_formatter {
+            formatter<T> impl;
+
+            void parse(const Context &context, const FormatterOption &option) { impl.parse(context, option); }
+
+            template <class output_str_function_wrap>
+            Result<bool,format_error> format(const T &value, output_str_function_wrap &&out_fct_wrap) const {
+                return impl.format(value, out_fct_wrap);
+            }
+        };
+
+        template <typename T>
+        struct nested_formatter<T, false> {
+            Context context;
+            FormatterOption option;
 
+            void parse(const Context &parsed_context, const FormatterOption &parsed) {
+                context = parsed_context;
+                option = parsed;
+            }
+
+            template <class output_str_function_wrap>
+            Result<bool,format_error> format(const T &value, output_str_function_wrap &&out_fct_wrap) const {
+                return format_value(out_fct_wrap, context, option, value);
+            }
+        };
+    }
+
+    // option 为已由 context 解析好的格式选项, 预编译的格式模板可直接复用
     template <size_t Index, class output_str_function_wrap, typename Arg, typename... Args>
-     Result<bool,format_error> formatter_to(size_t index, output_str_function_wrap &&out_fct_wrap, const Context &context, Arg &&arg, Args &&...args);
+     Result<bool,format_error> formatter_to(size_t index, output_str_function_wrap &&out_fct_wrap, const Context &context, const FormatterOption &parsed, Arg &&arg, Args &&...args);
     template <size_t Index, class output_str_function_wrap>
-     Result<bool,format_error> formatter_to(size_t index, output_str_function_wrap out_fct_wrap, const Context &context) { return Ok(false); }
+     STRINGFLOW_COLD Result<bool,format_error> formatter_to(size_t, output_str_function_wrap &&, const Context &, const FormatterOption &) { return Err(format_error::argument_index_out_of_range); }
 
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> handle_integral(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg);
+     Result<bool,format_error> handle_integral(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg);
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> handle_float(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg);
+     Result<bool,format_error> handle_float(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg);
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> ftoa_to(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg);
+     Result<bool,format_error> ftoa_to(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg);
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> etoa_to(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg);
+     Result<bool,format_error> etoa_to(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg);
     template <class output_str_function_wrap>
-     Result<bool,format_error> handle_point(output_str_function_wrap out_fct_wrap, const FormatterOption &option, const void *arg);
+     Result<bool,format_error> handle_point(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, uintptr_t address);
     template <class output_str_function_wrap>
-     Result<bool,format_error> handle_cstring(output_str_function_wrap out_fct_wrap, const FormatterOption &option, const char *arg);
+     Result<bool,format_error> handle_cstring(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const char *arg);
+    template <class output_str_function_wrap>
+     Result<bool,format_error> handle_string(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const char *arg, size_t length);
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> handle_class(output_str_function_wrap out_fct_wrap, const Context &context, Arg arg);
+     Result<bool,format_error> handle_class(output_str_function_wrap &&out_fct_wrap, const Context &context, const Arg &arg);
 
     template <class output_str_function_wrap>
-     Result<bool,format_error> handle_rev(output_str_function_wrap out_fct_wrap, const FormatterOption &option, const char *buffer, size_t length);
+     Result<bool,format_error> handle_rev(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const char *buffer, size_t length);
+    template <class output_str_function_wrap, typename CharT>
+     Result<bool,format_error> handle_wide(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const CharT *arg, size_t length);
+    namespace details {
+        // 整数的绝对值(以无符号类型返回, 最小负数不会溢出)
+        template <typename Arg>
+        constexpr auto magnitude(Arg value) {
+            using T = std::remove_cv_t<std::remove_reference_t<Arg>>;
+            if constexpr (std::is_same_v<T, bool>) {
+                return static_cast<unsigned>(value);
+            } else {
+                using U = std::make_unsigned_t<T>;
+                return value < 0 ? static_cast<U>(U(0) - static_cast<U>(value)) : static_cast<U>(value);
+            }
+        }
+
+        template <typename Arg>
+        constexpr bool is_negative(Arg value) {
+            if constexpr (std::is_signed_v<std::remove_cv_t<std::remove_reference_t<Arg>>>)
+                return value < 0;
+            else
+                return false;
+        }
+
+        // 输出一段已知长度的文本, 输出函数支持 out(data, size) 时整段交给它
+        template <class output_str_function_wrap>
+        inline void write_span(output_str_function_wrap &out_fct_wrap, const char *data, size_t size) {
+            if constexpr (has_write_span<output_str_function_wrap>::value) {
+                out_fct_wrap(data, size);
+            } else {
+                for (size_t i = 0; i < size; ++i)
+                    out_fct_wrap(data[i]);
+            }
+        }
+
+        // JSON 字符串字面量: 无需转义的片段整段输出
+        template <class output_str_function_wrap>
+        void write_json_string(output_str_function_wrap &out_fct_wrap, const char *data, size_t size) {
+            out_fct_wrap('"');
+            for (size_t pos = 0; pos < size;) {
+                const size_t next = pos + find_json_escape(data + pos, size - pos);
+                write_span(out_fct_wrap, data + pos, next - pos);
+                if (next == size) break;
+                char escape[6];
+                write_span(out_fct_wrap, escape, json_escape(data[next], escape));
+                pos = next + 1;
+            }
+            out_fct_wrap('"');
+        }
+
+        // CSV 字段(RFC 4180): 含分隔符、引号或换行时加引号, 字段内的 '"' 写两次
+        template <class output_str_function_wrap>
+        void write_csv_field(output_str_function_wrap &out_fct_wrap, const char *data, size_t size) {
+            if (find_csv_special(data, size) == size) {
+                write_span(out_fct_wrap, data, size);
+                return;
+            }
+            out_fct_wrap('"');
+            for (size_t pos = 0; pos < size;) {
+                const size_t next = pos + find_special<false, '"'>(data + pos, size - pos);
+                // 连同命中的 '"' 一起输出, 再补一个
+                write_span(out_fct_wrap, data + pos, next - pos + (next < size));
+                if (next == size) break;
+                out_fct_wrap('"');
+                pos = next + 1;
+            }
+            out_fct_wrap('"');
+        }
+
+        // {:.N} 截断: 返回不超过 N 列显示宽度的前缀字节数, 不会截断在多字节字符中间
+        inline size_t truncate_to_width(const char *data, size_t size, size_t columns) {
+            const size_t head = size < columns ? size : columns;
+            if (is_ascii(data, head)) return head;
+
+            size_t width = 0, pos = 0;
+            while (pos < size) {
+                size_t consumed = 1;
+                const size_t cp_width = codepoint_width(utf8_decode(data + pos, size - pos, consumed));
+                if (width + cp_width > columns) break;
+                width += cp_width;
+                pos += consumed;
+            }
+            return pos;
+        }
+
+        template <class output_str_function_wrap, class Writer>
+        Result<bool,format_error> write_padded(output_str_function_wrap &out_fct_wrap, const FormatterOption &option, size_t width, Writer &&write_content);
+
+        // 指针参数的地址: 数组取首元素地址, 函数指针按整数转换, nullptr 为 0
+        template <typename Arg>
+        uintptr_t pointer_value(const Arg &arg) {
+            using T = std::decay_t<const Arg>;
+            if constexpr (std::is_null_pointer_v<T>) {
+                return 0;
+            } else {
+                const T pointer = arg;
+                if constexpr (std::is_function_v<std::remove_pointer_t<T>>)
+                    return reinterpret_cast<uintptr_t>(pointer);
+                else
+                    return reinterpret_cast<uintptr_t>(static_cast<const volatile void *>(pointer));
+            }
+        }
+
+        /**
+         * @brief 由格式选项得到数字分组规则, 不需要分组时返回 nullptr
+         *
+         * @note ',' 每 3 位一组; '_' 十进制每 3 位、其他进制每 4 位一组; 'L' 仅对十进制按 number_facet 分组
+         */
+        inline const digit_grouping *resolve_grouping(char grouping, size_t radix) {
+            static constexpr digit_grouping comma(',', 3);
+            static constexpr digit_grouping underscore('_', 3);
+            static constexpr digit_grouping underscore_nibble('_', 4);
+            switch (grouping) {
+                case ',': return &comma;
+                case '_': return radix == 10 ? &underscore : &underscore_nibble;
+                case 'L': return radix == 10 ? &number_facet::thread().grouping() : nullptr;
+                default:  return nullptr;
+            }
+        }
+
+        // 写入符号位: 负数总是 '-', 非负数按 sign 选项输出 '+'、' ' 或不输出
+        inline char *write_sign(char *pos, bool negative, Sign sign) {
+            if (negative)
+                *pos++ = '-';
+            else if (sign == Sign::Plus)
+                *pos++ = '+';
+            else if (sign == Sign::Space)
+                *pos++ = ' ';
+            return pos;
+        }
+
+        // 输出 count 列填充; 宽填充字符无法整除时, 余下的列用空格补齐
+        template <class output_str_function_wrap>
+        void write_fill(output_str_function_wrap &out_fct_wrap, const Fill &fill, size_t count) {
+            for (size_t i = 0; i < count / fill.width; ++i)
+                for (size_t j = 0; j < fill.size; ++j)
+                    out_fct_wrap(fill.data[j]);
+            for (size_t i = 0; i < count % fill.width; ++i)
+                out_fct_wrap(' ');
+        }
+
+        /**
+         * @brief 输出已写入缓冲区的数字, 前 prefix 个字符为符号与进制前缀
+         *
+         * @note '=' 对齐时填充写在前缀与数字之间(如 -000042、0x00ff), 其余对齐方式与 handle_rev 相同
+         */
+        template <class output_str_function_wrap>
+        Result<bool,format_error> write_number(output_str_function_wrap &out_fct_wrap, const FormatterOption &option, const char *buffer, size_t prefix, size_t length) {
+            if (option.align != Align::Numeric || option.width <= length)
+                return handle_rev(out_fct_wrap, option, buffer, length);
+            write_span(out_fct_wrap, buffer, prefix);
+            write_fill(out_fct_wrap, option.fill, option.width - length);
+            write_span(out_fct_wrap, buffer + prefix, length - prefix);
+            return Ok(true);
+        }
+
+        // 定点格式最多输出的小数位数, 更大的精度按此截断
+        constexpr int max_fixed_decimals = 40;
+
+        /**
+         * @brief 非负有限值按定点格式写入缓冲区, 末位四舍五入, 返回写入结束的位置
+         *
+         * @note 未指定精度时保留 6 位小数(值为 0 时保留 1 位), 最多 max_fixed_decimals 位; 精度为 0 时只有 '#' 才输出小数点.
+         *       strip_zeros 为 g 格式去掉小数部分末尾的 0, 小数部分全为 0 时连同小数点一起去掉
+         */
+        inline char *write_fixed(char *pos, double value, const FormatterOption &option, const digit_grouping *grouping, bool strip_zeros) {
+            const int decimals = option.auto_precision ? (value == 0 ? 1 : 6) : std::min<int>(option.precision, max_fixed_decimals);
+            value += 0.5 * std::pow(10.0, -decimals);
+
+            const auto integer = static_cast<uint64_t>(value);
+            pos += grouping ? itoa_grouped(integer, pos, *grouping) : itoa(integer, pos);
+            if (decimals == 0 && !option.alternate) return pos;
+
+            char *point = pos;
+            *pos++ = option.grouping == 'L' ? number_facet::thread().decimal_point() : '.';
+            double fraction = value - static_cast<double>(integer);
+            for (int i = 0; i < decimals; ++i) {
+                fraction *= 10;
+                const int digit = static_cast<int>(fraction);
+                *pos++ = static_cast<char>('0' + digit);
+                fraction -= digit;
+            }
+
+            if (strip_zeros) {
+                while (pos > point + 1 && pos[-1] == '0') --pos;
+                if (pos == point + 1) pos = point;
+            }
+            return pos;
+        }
+    }
 
     // 默认版本，使用 putchar
     template<typename ...Args>
-    Result<size_t, format_error> print(const char* format, Args&&... args) {
+    Result<size_t, format_error_info> print(const char* format, Args&&... args) {
         return format_to(putchar, format, std::forward<Args>(args)...);
     }
 
     // 自定义输出函数的版本
     template<typename ...Args>
-    Result<size_t, format_error> print( const char* format, Args&&... args,OutputFunc out) {
+    Result<size_t, format_error_info> print( const char* format, Args&&... args,OutputFunc out) {
         return format_to(out, format, std::forward<Args>(args)...);
     }
 
     // 默认版本，使用 putchar
     template<typename ...Args>
-    Result<size_t, format_error> println(const char* format, Args&&... args) {
+    Result<size_t, format_error_info> println(const char* format, Args&&... args) {
         auto retval = format_to(putchar, format, std::forward<Args>(args)...);
         putchar('\n');
         return  retval;
@@ -127,12 +372,50 @@ namespace StringFlow {
 
     // 自定义输出函数的版本
     template< typename ...Args>
-    Result<size_t, format_error> println( const char* format, Args&&... args,OutputFunc out) {
+    Result<size_t, format_error_info> println( const char* format, Args&&... args,OutputFunc out) {
         auto retval = format_to(out, format, std::forward<Args>(args)...);
         out("\n");
         return  retval;
     }
 
+    namespace details {
+        template <typename Allocator, typename = void>
+        struct is_allocator : std::false_type {};
+        template <typename Allocator>
+        struct is_allocator<Allocator, std::void_t<typename Allocator::value_type,
+                                                   decltype(std::declval<Allocator &>().allocate(size_t{}))>> : std::true_type {};
+
+        // 追加到字符串的输出函数, 文本段整段 append
+        template <class String>
+        struct string_sink {
+            String &text;
+
+            void operator()(char ch) { text.push_back(ch); }
+            void operator()(const char *data, size_t size) { text.append(data, size); }
+        };
+    }
+
+    template <class Allocator>
+    using basic_format_string = std::basic_string<char, std::char_traits<char>,
+                                                  typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
+
+    /**
+     * @brief 格式化为字符串, 内存由 allocator 分配(例如 arena_allocator 或 std::pmr::polymorphic_allocator)
+     */
+    template <class Allocator, typename... Args, typename = std::enable_if_t<details::is_allocator<Allocator>::value>>
+    Result<basic_format_string<Allocator>, format_error_info> format(const Allocator &allocator, const char *format, Args &&...args) {
+        using String = basic_format_string<Allocator>;
+        String text{typename String::allocator_type(allocator)};
+        auto written = format_to(details::string_sink<String>{text}, format, std::forward<Args>(args)...);
+        if (STRINGFLOW_UNLIKELY(written.is_err())) return Err(written.unwrap_err());
+        return Ok(std::move(text));
+    }
+
+    template <typename... Args>
+    Result<std::string, format_error_info> format(const char *format, Args &&...args) {
+        return StringFlow::format(std::allocator<char>(), format, std::forward<Args>(args)...);
+    }
+
     template <typename... Args>
    size_t format_to_buffer(void *buffer, size_t size, const char *format, Args &&...args)
     {
@@ -149,99 +432,162 @@ namespace StringFlow {
     }
 
     template <class output_str_function_wrap,typename ... Args>
-    Result<size_t,format_error> format_to(output_str_function_wrap && output_str_function_wrap_,const char * format,Args&&...args) {
-        size_t count = 0;
-        size_t auto_index = 0;
+    Result<size_t,format_error_info> format_to(output_str_function_wrap && output_str_function_wrap_,const char * format,Args&&...args) {
+        return details::format_to_impl(output_str_function_wrap_, nullptr, error_policy::stop, format, std::forward<Args>(args)...);
+    }
+
+    // 指定字段出错时的处理方式, 例如 format_to(out, error_policy::report, format, args...)
+    // 未提供名字表时, {name} 字段每次格式化都在参数包中逐个比较 arg("name", value) 的名字;
+    // 高频的运行期模板应使用 name_table 或 compiled_format::compile(format, &names) 把名字一次解析为下标
+    template <class output_str_function_wrap,typename ... Args>
+    Result<size_t,format_error_info> format_to(output_str_function_wrap && output_str_function_wrap_,error_policy policy,const char * format,Args&&...args) {
+        return details::format_to_impl(output_str_function_wrap_, nullptr, policy, format, std::forward<Args>(args)...);
+    }
+
+    // 按名字表解析 {name} 字段, 名字在表中的下标即位置参数的下标
+    template <class output_str_function_wrap,typename ... Args>
+    Result<size_t,format_error_info> format_to(output_str_function_wrap && output_str_function_wrap_,const name_table &names,const char * format,Args&&...args) {
+        return details::format_to_impl(output_str_function_wrap_, &names, error_policy::stop, format, std::forward<Args>(args)...);
+    }
 
-        if (!format) return Err(format_error::invalid_alignment);
+    template <class TextHandler, class FieldHandler>
+    Result<bool,format_error_info> details::scan_format(const char *format, TextHandler &&on_text, FieldHandler &&on_field) {
+        const char *const start = format;
+        size_t auto_index = 0;
+        size_t field = 0;
+        const char *text = format;
 
         for (; *format; ++format) {
-            if (*format != '{' && *format != '}') {
-                output_str_function_wrap_(*format);
+            if (*format != '{' && *format != '}') continue;
+
+            // 先输出字段之前的整段文本
+            if (format != text) on_text(text, format - text);
+
+            // "{{" 与 "}}" 转义为单个花括号
+            if (format[1] == *format) {
+                on_text(format++, 1);
+                text = format + 1;
                 continue;
             }
+            if (STRINGFLOW_UNLIKELY(*format == '}')) return Err(format_error_info(format_error::unmatched_brace, field, format - start));
 
-            if (*format == '{') {
-                const char* spec_begin = format++;
-                const char* colon = nullptr;
-                bool is_closed = false;
-
-                // Parse format specifier
-                while (*format && *format != '{' && *format != '}') {
-                    if (*format == ':' && !colon) colon = format;
-                    ++format;
+            const char* spec_begin = format++;
+            const char* colon = nullptr;
+            while (*format && *format != '{' && *format != '}') {
+                if (*format == ':' && !colon) colon = format;
+                ++format;
+            }
+            if (STRINGFLOW_UNLIKELY(*format != '}')) return Err(format_error_info(format_error::unmatched_brace, field, spec_begin - start));
+
+            // 解析参数下标或参数名
+            const char* num_start = spec_begin + 1;
+            const char* name = nullptr;
+            size_t name_size = 0;
+            size_t arg_index = 0;
+            if (is_digit(*num_start)) {
+                while (is_digit(*num_start)) {
+                    arg_index = arg_index * 10 + (*num_start++ - '0');
                 }
+            } else if (is_name_start(*num_start)) {
+                name = num_start;
+                while (is_name_char(*num_start)) ++num_start;
+                name_size = num_start - name;
+                arg_index = npos_arg;
+            } else {
+                arg_index = auto_index++;
+            }
 
-                if (*format == '}') {
-                    is_closed = true;
-                    const char* spec_end = format;//此处由++改为不加这样就能支持{0}{1}二者都输出{0} {1}
-                    const char* num_start = spec_begin + 1;
-
-                    // Parse argument index
-                    size_t arg_index = auto_index;
-                    if (num_start < spec_end && *num_start >= '0' && *num_start <= '9') {
-                        arg_index = 0;
-                        while (num_start < spec_end && *num_start >= '0' && *num_start <= '9') {
-                            arg_index = arg_index * 10 + (*num_start++ - '0');
-                        }
-                    } else {
-                        arg_index = auto_index++;
-                    }
+            ++field;
+            if constexpr (std::is_same_v<decltype(on_field(Context{}, arg_index, name, name_size)), bool>) {
+                if (!on_field(Context{spec_begin, colon, format}, arg_index, name, name_size)) return Ok(false);
+            } else {
+                on_field(Context{spec_begin, colon, format}, arg_index, name, name_size);
+            }
+            text = format + 1;
+        }
 
-                    count += formatter_to<0>(
-                        arg_index,
-                        output_str_function_wrap_,
-                        {spec_begin, colon, spec_end},
-                        std::forward<Args>(args)...
-                    );
-                } else {
-                    // Handle unclosed brace or escape
-                    output_str_function_wrap_('{');
-                    if (*format == '{') output_str_function_wrap_(*format++);
-                    // if (format_to(output_str_function_wrap_,colon+1,args...).is_err())
-                    // {
-                    //     output_str_function_wrap_('}');
-                    // }
+        if (format != text) on_text(text, format - text);
+        return Ok(true);
+    }
+
+    template <class output_str_function_wrap,typename ... Args>
+    Result<size_t,format_error_info> details::format_to_impl(output_str_function_wrap && output_str_function_wrap_,const name_table *names,error_policy policy,const char * format,Args&&...args) {
+        size_t count = 0;
+        size_t field = 0;
+        format_error_info error;
+
+        if (STRINGFLOW_UNLIKELY(!format)) return Err(format_error_info(format_error::invalid_alignment));
+
+        auto scanned = scan_format(format,
+            [&](const char *text, size_t size) {
+                write_span(output_str_function_wrap_, text, size);
+            },
+            [&](const Context &context, size_t arg_index, const char *name, size_t name_size) {
+                // 具名字段: 优先查名字表, 否则在参数包中查找 arg("name", value)
+                if (name) {
+                    arg_index = names ? names->index_of(name, name_size)
+                                      : find_named_arg<0>(name, name_size, args...);
                 }
-            } else { // Handle '}'
-                // Find closing brace
-                const char* start = format++;
-                while (*format && *format != '}') ++format;
-
-                if (*format == '}') {
-                    output_str_function_wrap_('}');
-                    ++format;
+                FormatterOption option;
+                context.unpack_to(option);
+                auto formatted = formatter_to<0>(arg_index, output_str_function_wrap_, context, option, args...);
+                const size_t index = field++;
+                if (STRINGFLOW_LIKELY(formatted.is_ok())) {
+                    ++count;
+                    return true;
                 }
-            }
-        }
+                return record_field_error(policy, error,
+                                          format_error_info(formatted.unwrap_err(), index, context.begin - format));
+            });
+        if (STRINGFLOW_UNLIKELY(scanned.is_err())) return Err(scanned.unwrap_err());
+        if (STRINGFLOW_UNLIKELY(error.code() != format_error::success) && policy != error_policy::ignore) return Err(error);
 
         return Ok(count);
     }
 
     template <size_t Index, class output_str_function_wrap, typename Arg, typename... Args>
-    Result<bool,format_error> formatter_to(size_t index, output_str_function_wrap &&out_fct_wrap, const Context &context, Arg &&arg, Args &&...args) {
-        FormatterOption option;
-
+    Result<bool,format_error> formatter_to(size_t index, output_str_function_wrap &&out_fct_wrap, const Context &context, const FormatterOption &parsed, Arg &&arg, Args &&...args) {
         if (Index != index)
-            return formatter_to<Index + 1>(index, out_fct_wrap, context, args...);
+            return formatter_to<Index + 1>(index, out_fct_wrap, context, parsed, args...);
 
-        // 类类型处理
-        if constexpr (type_check<Arg>::is_class_v) {
-            constexpr bool has_custom = has_out_class_function<output_str_function_wrap, Arg>::value;
-            return has_custom ? out_fct_wrap(context, arg) : out_class_to(out_fct_wrap, context, arg);
-        }
+        return details::format_value(out_fct_wrap, context, parsed, arg);
+    }
 
-        context.unpack_to(option);
+    template <class output_str_function_wrap, typename Arg>
+    Result<bool,format_error> details::format_value(output_str_function_wrap &&out_fct_wrap, const Context &context, const FormatterOption &parsed, Arg &&arg) {
+        using T = std::remove_cv_t<std::remove_reference_t<Arg>>;
+        FormatterOption option = parsed;
+
+        // 具名参数: 按其引用的值格式化
+        if constexpr (is_named_arg_v<Arg>) {
+            return format_value(out_fct_wrap, context, parsed, arg.value);
+        }
+        // 类类型处理: 优先使用 formatter<T> 特化, 其次是输出函数自身的 (Context, Arg) 重载
+        else if constexpr (type_check<Arg>::is_class_v) {
+            if constexpr (has_formatter<T>::value) {
+                formatter<T> custom;
+                custom.parse(context, parsed);
+                return custom.format(arg, out_fct_wrap);
+            } else if constexpr (has_out_class_function<output_str_function_wrap, Arg>::value) {
+                return out_fct_wrap(context, arg);
+            } else {
+                return handle_class(out_fct_wrap, context, arg);
+            }
+        }
+        // 枚举: format_error 输出其说明, 其余枚举按底层整数输出
+        else if constexpr (std::is_same_v<T, format_error>) {
+            const std::string_view text = format_error_to_string(arg);
+            return handle_string(out_fct_wrap, option, text.data(), text.size());
+        } else if constexpr (std::is_enum_v<T>) {
+            return format_value(out_fct_wrap, context, parsed, static_cast<std::underlying_type_t<T>>(arg));
+        }
 
         // 统一指针处理 (包含 C 字符串)
         constexpr bool is_ptr = type_check<Arg>::is_pointer_v;
         constexpr bool is_cstr = type_check<Arg>::is_cstring_v;
         if constexpr (is_ptr || is_cstr) {
-            if (option.type == Type::Pointer || option.type == Type::pointer) {
-                const void* ptr = is_cstr ? static_cast<const void*>(arg) :
-                                          static_cast<const void*>(&arg);
-                return handle_point(out_fct_wrap, option, ptr);
-            }
+            if (option.type == Type::Pointer || option.type == Type::pointer)
+                return handle_point(out_fct_wrap, option, details::pointer_value(arg));
         }
 
         // 基础类型分发器
@@ -257,7 +603,12 @@ namespace StringFlow {
             return handle_integral(out_fct_wrap, option, arg);
         };
 
-        if constexpr (type_check<Arg>::is_character_v) {
+        // 宽字符编码为 UTF-8 输出, 指定整数类型(d/x/...)时按码点数值输出
+        if constexpr (type_check<Arg>::is_wide_character_v) {
+            if (option.type == Type::None || option.type == Type::Chr)
+                return handle_wide(out_fct_wrap, option, &arg, 1);
+            return handle_integral(out_fct_wrap, option, static_cast<uint32_t>(arg));
+        } else if constexpr (type_check<Arg>::is_character_v) {
             return handle_scalar(char{});
         } else if constexpr (type_check<Arg>::is_bool_v) {
             return handle_scalar(bool{});
@@ -269,7 +620,7 @@ namespace StringFlow {
         // 浮点类型处理
         if constexpr (type_check<Arg>::is_floating_point_v) {
             constexpr auto is_in_float_range = [](auto val) {
-                return (val < max_float && val >= min_float) ||
+                return val == 0 || (val < max_float && val >= min_float) ||
                       (-val < max_float && -val >= min_float);
             };
             option.type = (option.type == Type::None) ?
@@ -279,15 +630,24 @@ namespace StringFlow {
         }
 
         // 兜底处理
+        if constexpr (type_check<Arg>::is_wide_cstring_v) {
+            using CharT = std::remove_cv_t<std::remove_pointer_t<std::decay_t<Arg>>>;
+            return handle_wide(out_fct_wrap, option, arg, std::char_traits<CharT>::length(arg));
+        }
+        if constexpr (type_check<Arg>::is_string_v) {
+            return handle_string(out_fct_wrap, option, arg.data(), arg.size());
+        }
+        if constexpr (type_check<Arg>::is_wide_string_v) {
+            return handle_wide(out_fct_wrap, option, arg.data(), arg.size());
+        }
         if constexpr (is_cstr) return handle_cstring(out_fct_wrap, option, arg);
-        if constexpr (is_ptr)  return handle_point(out_fct_wrap, option,
-                                                   static_cast<const void*>(arg));
+        if constexpr (is_ptr)  return handle_point(out_fct_wrap, option, details::pointer_value(arg));
     }
 
 
     template <class output_str_function_wrap, typename Arg>
-    Result<bool,format_error> handle_integral(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg) {
-        char temp[33]={0};
+    Result<bool,format_error> handle_integral(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg) {
+        char temp[136]={0};  // 64 位二进制加分组分隔符、进制前缀与符号
         switch (option.type) {
             case Type::Chr:
                 return handle_rev(out_fct_wrap, option, (const char*)&arg, 1);//只能使用c风格的强转换，不然报错
@@ -310,193 +670,217 @@ namespace StringFlow {
 
                 if (radix == 0) return Err(format_error::type_mismatch);
 
-                // 符号预处理
-                const bool needs_sign = (arg < 0) || (option.sign == Sign::Minus);
-                const char sign_char = needs_sign ? '-' :
-                                      (option.sign == Sign::Plus) ? '+' : '\0';
-
-                char* buffer_start = temp;
-                if (sign_char) {
-                    *buffer_start++ = sign_char;
+                // 符号与进制前缀(#)写在数字之前, '=' 对齐时填充插在两者之间
+                char* buffer_start = details::write_sign(temp, details::is_negative(arg), option.sign);
+                if (option.alternate && radix != 10) {
+                    *buffer_start++ = '0';
+                    *buffer_start++ = radix == 2 ? 'b' : radix == 8 ? 'o' : (itoa_case == IotaCase::Upper ? 'X' : 'x');
                 }
+                const size_t prefix = buffer_start - temp;
 
-                // 统一数值转换
-                size_t length = itoa(needs_sign ? std::abs(arg) : arg, buffer_start, radix, itoa_case);
-                length += (buffer_start - temp);  // 包含符号长度
+                // 统一数值转换, 需要分组时在转换过程中插入分隔符
+                const digit_grouping *grouping = details::resolve_grouping(option.grouping, radix);
+                const size_t length = grouping ? itoa_grouped(details::magnitude(arg), buffer_start, *grouping, radix, itoa_case)
+                                               : itoa(details::magnitude(arg), buffer_start, radix, itoa_case);
 
-                return handle_rev(out_fct_wrap, option, temp, length);
+                return details::write_number(out_fct_wrap, option, temp, prefix, prefix + length);
             }
         }
     }
 
+    namespace details {
+        // inf/nan: 符号规则与有限值相同, 不补零; 很少出现, 不内联进 handle_float
+        template <class output_str_function_wrap>
+        STRINGFLOW_COLD Result<bool,format_error> format_non_finite(output_str_function_wrap &out_fct_wrap, const FormatterOption &option, bool nan, bool negative) {
+            char temp[8];
+            char *pos = write_sign(temp, negative, option.sign);
+            memcpy(pos, nan ? "nan" : "inf", 3);
+            pos += 3;
+            // 与有限值一致, % 格式在末尾加上百分号
+            if (option.type == Type::Percent) *pos++ = '%';
+            FormatterOption special = option;
+            if (special.align == Align::Numeric) {
+                special.fill = ' ';
+                special.align = Align::Right;
+            }
+            return handle_rev(out_fct_wrap, special, temp, pos - temp);
+        }
+    }
+
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> handle_float(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg) {
+     Result<bool,format_error> handle_float(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg) {
         static_assert(type_check<Arg>::is_floating_point_v);
 
-        // 处理特殊值
-        if (arg != arg)  // NaN检测
-            return handle_rev(out_fct_wrap, option, "nan", 3);
-
-        if (arg < -DBL_MAX)  // 负无穷
-            return handle_rev(out_fct_wrap, option, "-inf", 4);
-
-        // 处理正无穷
-        if (arg > DBL_MAX) {
-            const auto [inf_str, inf_len] = [&]() -> std::pair<const char*, size_t> {
-                switch (option.sign) {
-                    case Sign::Minus: return {"inf",   3};
-                    case Sign::Plus:  return {"+inf",  4};
-                    case Sign::Space: return {" inf",  4};
-                    default:          return {nullptr, 0};
-                }
-            }();
-            return inf_str ? handle_rev(out_fct_wrap, option, inf_str, inf_len) : Err(format_error::number_overflow);
-        }
+        if (STRINGFLOW_UNLIKELY(arg != arg || arg < -DBL_MAX || arg > DBL_MAX))
+            return details::format_non_finite(out_fct_wrap, option, arg != arg, std::signbit(arg));
 
         // 常规数值格式化
         switch (option.type) {
-            case Type::Float: return ftoa_to(out_fct_wrap, option, arg);
+            case Type::Float:   return ftoa_to(out_fct_wrap, option, arg);
+            case Type::Percent: return ftoa_to(out_fct_wrap, option, arg * 100);
             case Type::exp:   // 允许小写形式
-            case Type::Exp:   return etoa_to(out_fct_wrap, option, arg);
-            default:          return  Err(format_error::type_mismatch);
+            case Type::Exp:     return etoa_to(out_fct_wrap, option, arg);
+            case Type::gen:
+            case Type::Gen: {
+                // P 位有效数字, 十进制指数 X: -4 <= X < P 时用定点格式, 否则用科学计数法, 末尾的 0 被去掉
+                const int significant = option.auto_precision ? 6 : (option.precision ? option.precision : 1);
+                const double value = std::fabs(static_cast<double>(arg));
+                int exponent = value == 0 ? 0 : static_cast<int>(std::floor(std::log10(value)));
+                // 舍入可能进位到下一个数量级, 例如 9.9999995 保留 6 位有效数字为 10.0000
+                if (value != 0 && value + 0.5 * std::pow(10.0, exponent - significant + 1) >= std::pow(10.0, exponent + 1))
+                    ++exponent;
+
+                FormatterOption general = option;
+                general.auto_precision = false;
+                if (exponent >= -4 && exponent < significant) {
+                    // 小数位数最多为 significant + 3, 先截断到定点格式的上限再收窄, 避免 uint8_t 回绕
+                    general.precision = static_cast<uint8_t>(std::min(significant - 1 - exponent, details::max_fixed_decimals));
+                    return ftoa_to(out_fct_wrap, general, arg);
+                }
+                general.precision = static_cast<uint8_t>(significant - 1);
+                return etoa_to(out_fct_wrap, general, arg);
+            }
+            default:            return  Err(format_error::type_mismatch);
         }
     }
 
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> ftoa_to(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg) {
-        char temp[66]={0};
-        char* pos = temp;
-        auto value = arg;
-
-        // 符号处理
-        if (value < 0) {
-            *pos++ = '-';
-            value = -value;
-        } else if (option.sign != Sign::Minus) {
-            *pos++ = static_cast<char>(option.sign);
-        }
+     Result<bool,format_error> ftoa_to(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg) {
+        const double value = std::fabs(static_cast<double>(arg));
+        // 整数部分超出 uint64_t 时改用科学计数法
+        if (value >= 1e19) return etoa_to(out_fct_wrap, option, arg);
 
-        // 整数部分处理
-        const int integer = static_cast<int>(value);
-        const size_t int_len = (integer != 0) ? itoa(integer, pos) : (pos += (*pos = '0', 1), 0);
-        pos += int_len;
-        *pos++ = '.';  // 小数点
+        char temp[96]={0};
+        char *pos = details::write_sign(temp, std::signbit(arg), option.sign);
+        const size_t prefix = pos - temp;
+        const bool general = option.type == Type::gen || option.type == Type::Gen;
 
-        // 小数部分参数
-        const size_t max_decimals = option.precision;
-        size_t buffer_remaining = sizeof(temp) - (pos - temp);
+        // 数字、小数点与百分号一次写入缓冲区; g 格式在缓冲区内去掉末尾的 0
+        pos = details::write_fixed(pos, value, option, details::resolve_grouping(option.grouping, 10), general && !option.alternate);
+        if (option.type == Type::Percent) *pos++ = '%';
 
-        // 小数位生成
-        for (size_t i = 0; buffer_remaining > 1 && i < max_decimals; ++i, --buffer_remaining) {
-
-            const int digit = static_cast<int>(value * 10) % 10;
-            *pos++ = '0' + digit;
-            value *= 10;
+        return details::write_number(out_fct_wrap, option, temp, prefix, pos - temp);
+    }
 
-            if (option.auto_precision && value < 1e-9) break;  // 浮点精度容差
+    template <class output_str_function_wrap, typename Arg>
+     Result<bool,format_error> etoa_to(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, Arg &&arg) {
+        char temp[96]={0};
+        char *pos = details::write_sign(temp, std::signbit(arg), option.sign);
+        const size_t prefix = pos - temp;
+        const bool general = option.type == Type::gen || option.type == Type::Gen;
+
+        // 尾数规范到 [1, 10), 舍入后可能进位到 10
+        FormatterOption mantissa_option = option;
+        mantissa_option.auto_precision = false;
+        mantissa_option.precision = option.auto_precision ? 6 : option.precision;
+        double value = std::fabs(static_cast<double>(arg));
+        int exponent = 0;
+        if (value != 0) {
+            exponent = static_cast<int>(std::floor(std::log10(value)));
+            value /= std::pow(10.0, exponent);
+            if (value < 1.0) {  // log10 的舍入误差
+                value *= 10;
+                --exponent;
+            }
+            if (value + 0.5 * std::pow(10.0, -mantissa_option.precision) >= 10.0) {
+                value /= 10;
+                ++exponent;
+            }
         }
 
-        return handle_rev(out_fct_wrap, option, temp, pos - temp);
-    }
+        pos = details::write_fixed(pos, value, mantissa_option, nullptr, general && !option.alternate);
 
-    template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> etoa_to(output_str_function_wrap out_fct_wrap, const FormatterOption &option, Arg &&arg) {
-        char temp[66]={0};
-        char* iter = temp;
-        double value = arg;
-        int expval;
-
-        // 安全类型转换替代联合体
-        auto safe_bit_cast = [](auto& dest, const auto& src) {
-            static_assert(sizeof(dest) == sizeof(src), "Size mismatch");
-            memcpy(&dest, &src, sizeof(dest));
-        };
+        // 指数: 总是带符号, 至少两位
+        *pos++ = (option.type == Type::Exp || option.type == Type::Gen) ? 'E' : 'e';
+        *pos++ = exponent < 0 ? '-' : '+';
+        const unsigned exponent_magnitude = exponent < 0 ? -exponent : exponent;
+        if (exponent_magnitude < 10) *pos++ = '0';
+        pos += itoa(exponent_magnitude, pos);
 
-        // 提取浮点位表示
-        uint64_t bit_representation;
-        safe_bit_cast(bit_representation, value < 0 ? -value : value);
-
-        // 计算 log2 指数
-        const int exp2 = static_cast<int>((bit_representation >> 52U) & 0x07FFU) - 1023;
-
-        // 构造标准化尾数 [1,2)
-        bit_representation = (bit_representation & ((1ULL << 52U) - 1U)) | (0x3FF0000000000000ULL);
-        double mantissa;
-        safe_bit_cast(mantissa, bit_representation);
-
-        // 近似 log10 计算
-        expval = static_cast<int>(0.1760912590558 + exp2 * 0.301029995663981 + (mantissa - 1.5) * 0.289529654602168);
-
-        // 指数修正计算
-        int exp_correction = static_cast<int>(expval * 3.321928094887362 + 0.5);
-        const double z = expval * 2.302585092994046 - exp_correction * 0.6931471805599453;
-        const double z_sq = z * z;
-
-        // 连分数近似
-        const double exp_factor = 1.0 + (2.0 * z) / (2.0 - z + z_sq / (6.0 + z_sq / (10.0 + z_sq / 14.0)));
-
-        // 构造缩放因子
-        bit_representation = static_cast<uint64_t>(exp_correction + 1023) << 52U;
-        double scaling_factor;
-        safe_bit_cast(scaling_factor, bit_representation);
-        scaling_factor *= mantissa * exp_factor;
-
-        // 边界修正
-        if (std::abs(value) < scaling_factor) {
-            scaling_factor /= 10.0;
-            --expval;
-        }
-
-        // 格式化输出
-         const bool success = ftoa_to(out_fct_wrap,
-                                FormatterOption{
-                                    .sign = option.sign,
-                                    .width = 0,
-                                    .auto_precision = option.auto_precision,
-                                    .precision = option.precision,
-                                    .type = Type::Float
-                                },
-                                value / scaling_factor
-         ).unwrap();
-
-        if (!success) return Err(format_error::inf_format_error);
-
-        out_fct_wrap(static_cast<char>(option.type));
-        return handle_integral(out_fct_wrap, {.type = Type::Dec}, expval);
+        return details::write_number(out_fct_wrap, option, temp, prefix, pos - temp);
     }
 
     template <class output_str_function_wrap>
-     Result<bool,format_error> handle_point(output_str_function_wrap out_fct_wrap, const FormatterOption &option, const void *arg) {
-        char temp[33];
-        const auto ptr = reinterpret_cast<uintptr_t>(arg);
-        size_t length = itoa(ptr, temp, 16, (option.type == Type::Pointer) ? IotaCase::Upper : IotaCase::Lower);
-
-        if (length >= option.width)
-        {
-            for (size_t i = 0; i < length; i++)
-                out_fct_wrap(temp[i]);
-            return Ok(true);
+     Result<bool,format_error> handle_point(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, uintptr_t address) {
+        // 缺省与 p/P 输出 0x 前缀; x/X 只有指定 '#' 时才有前缀. 地址总是补零到 uintptr_t 的完整宽度
+        bool prefix = option.alternate;
+        const char *digits = "0123456789abcdef";
+        switch (option.type) {
+            case Type::None:
+            case Type::pointer: prefix = true; break;
+            case Type::Pointer: prefix = true; digits = "0123456789ABCDEF"; break;
+            case Type::hex:     break;
+            case Type::Hex:     digits = "0123456789ABCDEF"; break;
+            default:            return Err(format_error::type_mismatch);
         }
 
-        return handle_rev(out_fct_wrap, option, temp, length);
+        char temp[2 + sizeof(uintptr_t) * 2];
+        size_t length = 0;
+        if (prefix) {
+            temp[length++] = '0';
+            temp[length++] = 'x';
+        }
+        // 固定次数的移位, 编译器会完全展开
+        for (int shift = sizeof(uintptr_t) * 8 - 4; shift >= 0; shift -= 4)
+            temp[length++] = digits[(address >> shift) & 0x0F];
+
+        return details::write_number(out_fct_wrap, option, temp, prefix ? 2 : 0, length);
     }
 
     template <class output_str_function_wrap>
-     Result<bool,format_error> handle_cstring(output_str_function_wrap out_fct_wrap, const FormatterOption &option, const char *arg) {
-        size_t length = strlen(arg);
+     Result<bool,format_error> handle_cstring(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const char *arg) {
+        return handle_string(out_fct_wrap, option, arg, strlen(arg));
+    }
 
-        if (length >= option.width)
-        {
-            for (size_t i = 0; i < length; i++)
-                out_fct_wrap(arg[i]);
-            return Ok(true);
+    template <class output_str_function_wrap>
+     Result<bool,format_error> handle_string(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const char *arg, size_t length) {
+        if (!option.auto_precision)
+            length = details::truncate_to_width(arg, length, option.precision);
+        // {:j} 与 {:q} 在输出时转义, 不生成中间字符串; 截断作用于原文
+        if (option.type == Type::Json || option.type == Type::Csv) {
+            const bool json = option.type == Type::Json;
+            const size_t width = !option.width ? 0
+                : display_width(arg, length) + (json ? details::json_escape_overhead(arg, length)
+                                                     : details::csv_escape_overhead(arg, length));
+            return details::write_padded(out_fct_wrap, option, width, [&] {
+                if (json)
+                    details::write_json_string(out_fct_wrap, arg, length);
+                else
+                    details::write_csv_field(out_fct_wrap, arg, length);
+            });
         }
-
         return handle_rev(out_fct_wrap, option, arg, length);
     }
 
+    template <class output_str_function_wrap, typename CharT>
+     Result<bool,format_error> handle_wide(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const CharT *arg, size_t length) {
+        // {:.N} 截断到 N 列
+        if (!option.auto_precision) {
+            size_t width = 0, pos = 0;
+            while (pos < length) {
+                size_t consumed = 1;
+                const size_t cp_width = codepoint_width(wide_decode(arg + pos, length - pos, consumed));
+                if (width + cp_width > option.precision) break;
+                width += cp_width;
+                pos += consumed;
+            }
+            length = pos;
+        }
+        const size_t width = option.width ? wide_display_width(arg, length) : 0;
+        return details::write_padded(out_fct_wrap, option, width, [&] {
+            char utf8[4];
+            for (size_t i = 0; i < length;) {
+                size_t consumed = 1;
+                const size_t size = utf8_encode(wide_decode(arg + i, length - i, consumed), utf8);
+                for (size_t j = 0; j < size; ++j)
+                    out_fct_wrap(utf8[j]);
+                i += consumed;
+            }
+        });
+    }
+
     template <class output_str_function_wrap, typename Arg>
-     Result<bool,format_error> handle_class(output_str_function_wrap out_fct_wrap, const Context &context, Arg arg) {
+     Result<bool,format_error> handle_class(output_str_function_wrap &&out_fct_wrap, const Context &context, const Arg &arg) {
         FormatterOption option;
         const char *temp = typeid(Arg).name();
         context.unpack_to(option);
@@ -504,27 +888,28 @@ namespace StringFlow {
     }
 
     template <class output_str_function_wrap>
-     Result<bool,format_error> handle_rev(output_str_function_wrap out_fct_wrap, const FormatterOption &option, const char *buffer, size_t length) {
-        auto write_buffer = [&](const char* data, size_t len) {
-            for (size_t i = 0; i < len; ++i)
-                out_fct_wrap(data[i]);
-        };
+     Result<bool,format_error> handle_rev(output_str_function_wrap &&out_fct_wrap, const FormatterOption &option, const char *buffer, size_t length) {
+        // 按显示宽度计算填充, 未指定宽度时无需计算
+        const size_t width = option.width ? display_width(buffer, length) : 0;
+        return details::write_padded(out_fct_wrap, option, width, [&] {
+            details::write_span(out_fct_wrap, buffer, length);
+        });
+    }
 
-        auto write_fill = [&](size_t count) {
-            for (size_t i = 0; i < count; ++i)
-                out_fct_wrap(option.fill);
-        };
+    template <class output_str_function_wrap, class Writer>
+    Result<bool,format_error> details::write_padded(output_str_function_wrap &out_fct_wrap, const FormatterOption &option, size_t width, Writer &&write_content) {
+        auto write_fill = [&](size_t count) { details::write_fill(out_fct_wrap, option.fill, count); };
 
-        if (option.width <= length) {
-            write_buffer(buffer, length);
+        if (option.width <= width) {
+            write_content();
             return Ok(true);
         }
 
-        const size_t padding = option.width - length;
+        const size_t padding = option.width - width;
 
         switch (option.align) {
             case Align::Left:
-                write_buffer(buffer, length);
+                write_content();
             write_fill(padding);
             break;
 
@@ -532,14 +917,15 @@ namespace StringFlow {
                 const size_t left_pad = padding / 2;
                 const size_t right_pad = padding - left_pad;
                 write_fill(left_pad);
-                write_buffer(buffer, length);
+                write_content();
                 write_fill(right_pad);
                 break;
             }
 
             case Align::Right:
+            case Align::Numeric:  // 非数值参数的 '=' 按右对齐处理
                 write_fill(padding);
-            write_buffer(buffer, length);
+            write_content();
             break;
 
             default:
@@ -549,6 +935,74 @@ namespace StringFlow {
         return Ok(true);
     }
 
+    /**
+     * @brief unit_t 输出为 "()"
+     */
+    template <>
+    struct formatter<unit_t> {
+        void parse(const Context &, const FormatterOption &) {}
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const unit_t &, output_str_function_wrap &&out_fct_wrap) const {
+            details::write_span(out_fct_wrap, "()", 2);
+            return Ok(true);
+        }
+    };
+
+    /**
+     * @brief format_error_info 输出错误说明及位置, 例如 "Type mismatch ... (field 2, offset 14)"
+     */
+    template <>
+    struct formatter<format_error_info> {
+        void parse(const Context &, const FormatterOption &) {}
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const format_error_info &error, output_str_function_wrap &&out_fct_wrap) const {
+            const std::string_view text = format_error_to_string(error.code());
+            details::write_span(out_fct_wrap, text.data(), text.size());
+            char buffer[64];
+            details::write_span(out_fct_wrap, buffer, details::format_error_position(error, buffer));
+            return Ok(true);
+        }
+    };
+
+    // 输出 "类别: 说明", 例如 "format: Output buffer full"
+    template <>
+    struct formatter<error_code> {
+        void parse(const Context &, const FormatterOption &) {}
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const error_code &code, output_str_function_wrap &&out_fct_wrap) const {
+            const std::string_view name = code.category().name();
+            const std::string_view text = code.message();
+            details::write_span(out_fct_wrap, name.data(), name.size());
+            details::write_span(out_fct_wrap, ": ", 2);
+            details::write_span(out_fct_wrap, text.data(), text.size());
+            return Ok(true);
+        }
+    };
+
+    /**
+     * @brief Result<T, E> 输出为 Ok(value) 或 Err(error), 格式说明作用于其中的值
+     */
+    template <typename T, typename E>
+    struct formatter<Result<T, E>> {
+        details::nested_formatter<T> ok_formatter;
+        details::nested_formatter<E> err_formatter;
+
+        void parse(const Context &context, const FormatterOption &option) {
+            ok_formatter.parse(context, option);
+            err_formatter.parse(context, option);
+        }
 
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const Result<T, E> &value, output_str_function_wrap &&out_fct_wrap) const {
+            auto formatted = value.is_ok() ? (details::write_span(out_fct_wrap, "Ok(", 3), ok_formatter.format(value.ok_unchecked(), out_fct_wrap))
+                                           : (details::write_span(out_fct_wrap, "Err(", 4), err_formatter.format(value.err_unchecked(), out_fct_wrap));
+            out_fct_wrap(')');
+            return formatted;
+        }
+    };
 }
+
 #endif //FORMAT_HPP
@@ -0,0 +1,269 @@
+//
+// Created by ruixuezhao on 25-3-18.
+//
+
+#ifndef HEXDUMP_HPP
+#define HEXDUMP_HPP
+#include <cstring>
+#include <iterator>
+#include "format.hpp"
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/**
+ * @brief 二进制数据的十六进制与 base64 输出
+ *
+ * @note 逐字节 println("{:x}", byte) 每个字节都要经过一次完整的格式化流程, 这里按块转换:
+ *       支持 SSSE3 时每次用 pshufb 把 16 字节展开为 32 个十六进制字符, 否则查 512 字节的表.
+ *
+ *       StringFlow::hexdump(putchar, packet, size).unwrap();
+ *       00000000  48 65 6c 6c 6f 2c 20 53  74 72 69 6e 67 46 6c 6f  |Hello, StringFlo|
+ *
+ *       字节序列也可以作为普通参数: {:xs} 连续的小写十六进制, {:Xs} 大写, {:xs4} 每 4 字节一组,
+ *       {:b64} base64:
+ *       StringFlow::println("{:xs} {:b64}", StringFlow::bytes(key, 16), StringFlow::bytes(token)).unwrap();
+ */
+namespace StringFlow {
+    /**
+     * @brief 每个字节对应两个十六进制字符, 共 512 字节
+     */
+    struct hex_table {
+        char data[512];
+
+        constexpr hex_table(const char *digits) : data{} {
+            for (size_t i = 0; i < 256; ++i) {
+                data[i * 2] = digits[i >> 4];
+                data[i * 2 + 1] = digits[i & 0x0F];
+            }
+        }
+    };
+
+    static constexpr hex_table hex_lower("0123456789abcdef");
+    static constexpr hex_table hex_upper("0123456789ABCDEF");
+
+    static constexpr char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    namespace details {
+        /**
+         * @brief 把 size 字节转换为 2 * size 个十六进制字符
+         */
+        inline void hex_encode(const uint8_t *data, size_t size, char *out, bool upper) {
+            size_t i = 0;
+#if defined(__SSSE3__)
+            const __m128i digits = upper ? _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F')
+                                         : _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+            const __m128i low_mask = _mm_set1_epi8(0x0F);
+            for (; i + 16 <= size; i += 16) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask));
+                const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, low_mask));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_unpacklo_epi8(high, low));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+            }
+#endif
+            const char *table = upper ? hex_upper.data : hex_lower.data;
+            for (; i < size; ++i)
+                memcpy(out + i * 2, table + data[i] * 2, 2);
+        }
+
+        /**
+         * @brief 按组输出十六进制, group 为每组字节数(0 表示不分组), 组之间以空格分隔
+         */
+        template <class output_str_function_wrap>
+        void write_hex(output_str_function_wrap &out_fct_wrap, const uint8_t *data, size_t size, bool upper, size_t group) {
+            // 每块 64 字节, 先整块转换, 再按组拷贝并插入空格
+            char hex[128];
+            char buffer[192];
+            for (size_t offset = 0; offset < size; offset += 64) {
+                const size_t chunk = size - offset < 64 ? size - offset : 64;
+                hex_encode(data + offset, chunk, hex, upper);
+                if (!group) {
+                    write_span(out_fct_wrap, hex, chunk * 2);
+                    continue;
+                }
+                // 组可能跨越块的边界, 按全局下标判断是否插入空格
+                size_t used = 0;
+                for (size_t i = 0; i < chunk;) {
+                    const size_t position = offset + i;
+                    if (position && position % group == 0) buffer[used++] = ' ';
+                    const size_t rest = group - position % group;
+                    const size_t count = chunk - i < rest ? chunk - i : rest;
+                    memcpy(buffer + used, hex + i * 2, count * 2);
+                    used += count * 2;
+                    i += count;
+                }
+                write_span(out_fct_wrap, buffer, used);
+            }
+        }
+
+        /**
+         * @brief 标准 base64(带 '=' 补齐), 每次转换 48 字节到 64 个字符
+         */
+        template <class output_str_function_wrap>
+        void write_base64(output_str_function_wrap &out_fct_wrap, const uint8_t *data, size_t size) {
+            char buffer[64];
+            size_t i = 0;
+            while (size - i >= 3) {
+                size_t used = 0;
+                for (; size - i >= 3 && used < sizeof(buffer); i += 3, used += 4) {
+                    const uint32_t triple = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+                    buffer[used] = base64_alphabet[(triple >> 18) & 0x3F];
+                    buffer[used + 1] = base64_alphabet[(triple >> 12) & 0x3F];
+                    buffer[used + 2] = base64_alphabet[(triple >> 6) & 0x3F];
+                    buffer[used + 3] = base64_alphabet[triple & 0x3F];
+                }
+                write_span(out_fct_wrap, buffer, used);
+            }
+            if (i == size) return;
+
+            const uint32_t rest = (uint32_t(data[i]) << 16) | (size - i == 2 ? uint32_t(data[i + 1]) << 8 : 0);
+            buffer[0] = base64_alphabet[(rest >> 18) & 0x3F];
+            buffer[1] = base64_alphabet[(rest >> 12) & 0x3F];
+            buffer[2] = size - i == 2 ? base64_alphabet[(rest >> 6) & 0x3F] : '=';
+            buffer[3] = '=';
+            write_span(out_fct_wrap, buffer, 4);
+        }
+    }
+
+    /**
+     * @brief hexdump 的输出选项
+     */
+    struct hexdump_options {
+        size_t bytes_per_line = 16;  // 每行字节数, 最多 64
+        size_t group = 1;            // 每组字节数, 组之间以空格分隔; 0 表示不分组
+        size_t column = 8;           // 每 column 个字节多加一个空格分隔, 0 表示不分栏
+        bool offset = true;          // 行首的偏移量列
+        uint64_t base_offset = 0;    // 偏移量列的起始值
+        bool ascii = true;           // 行尾的 ASCII 栏, 不可打印字符显示为 '.'
+        bool upper = false;          // 大写十六进制
+    };
+
+    /**
+     * @brief 输出多行十六进制转储, 格式与 hexdump -C 相同
+     *
+     * @return 转储的字节数
+     */
+    template <class output_str_function_wrap>
+    Result<size_t, format_error> hexdump(output_str_function_wrap &&out_fct_wrap, const void *data, size_t size,
+                                         const hexdump_options &options = {}) {
+        if (!data && size) return Err(format_error::invalid_format_spec);
+        const size_t per_line = options.bytes_per_line == 0 ? 16 : (options.bytes_per_line > 64 ? 64 : options.bytes_per_line);
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        const bool wide_offset = options.base_offset + size > 0xFFFFFFFFull;
+
+        // 一行的十六进制区宽度固定, 最后一行不足时用空格补齐, 使 ASCII 栏对齐
+        auto hex_width = [&](size_t count) {
+            size_t width = count * 2;
+            for (size_t i = 1; i < count; ++i) {
+                if (options.group && i % options.group == 0) ++width;
+                if (options.column && i % options.column == 0) ++width;
+            }
+            return width;
+        };
+        const size_t full_width = hex_width(per_line);
+
+        char hex[128];
+        char line[512];
+        for (size_t offset = 0; offset < size; offset += per_line) {
+            const size_t count = size - offset < per_line ? size - offset : per_line;
+            size_t used = 0;
+
+            if (options.offset) {
+                const uint64_t address = options.base_offset + offset;
+                const size_t digits = wide_offset ? 16 : 8;
+                for (size_t i = 0; i < digits; ++i)
+                    line[used + i] = hex_lower.data[((address >> ((digits - 1 - i) * 4)) & 0x0F) * 2 + 1];
+                used += digits;
+                line[used++] = ' ';
+                line[used++] = ' ';
+            }
+
+            details::hex_encode(bytes + offset, count, hex, options.upper);
+            const size_t hex_start = used;
+            for (size_t i = 0; i < count; ++i) {
+                if (i) {
+                    if (options.group && i % options.group == 0) line[used++] = ' ';
+                    if (options.column && i % options.column == 0) line[used++] = ' ';
+                }
+                line[used++] = hex[i * 2];
+                line[used++] = hex[i * 2 + 1];
+            }
+
+            if (options.ascii) {
+                const size_t pad = full_width - (used - hex_start);
+                memset(line + used, ' ', pad + 2);
+                used += pad + 2;
+                line[used++] = '|';
+                for (size_t i = 0; i < count; ++i) {
+                    const uint8_t ch = bytes[offset + i];
+                    line[used++] = (ch >= 0x20 && ch < 0x7F) ? static_cast<char>(ch) : '.';
+                }
+                line[used++] = '|';
+            }
+            line[used++] = '\n';
+            details::write_span(out_fct_wrap, line, used);
+        }
+        return Ok(size);
+    }
+
+    /**
+     * @brief 输出 base64 编码
+     */
+    template <class output_str_function_wrap>
+    Result<size_t, format_error> base64(output_str_function_wrap &&out_fct_wrap, const void *data, size_t size) {
+        if (!data && size) return Err(format_error::invalid_format_spec);
+        details::write_base64(out_fct_wrap, static_cast<const uint8_t *>(data), size);
+        return Ok(size);
+    }
+
+    /**
+     * @brief 字节序列参数, 只保存指针与长度
+     */
+    struct byte_span {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    inline byte_span bytes(const void *data, size_t size) { return {static_cast<const uint8_t *>(data), size}; }
+
+    // 连续存储的单字节元素容器, 例如 std::string、std::vector<uint8_t>、std::array<char, N>
+    template <class Container,
+              typename = std::enable_if_t<sizeof(*std::data(std::declval<const Container &>())) == 1>>
+    byte_span bytes(const Container &container) {
+        return {reinterpret_cast<const uint8_t *>(std::data(container)), std::size(container)};
+    }
+
+    /**
+     * @brief 字节序列的格式说明: [x|X][s][分组字节数] 或 b64, 缺省为 {:xs}
+     */
+    template <>
+    struct formatter<byte_span> {
+        bool base64 = false;
+        bool upper = false;
+        size_t group = 0;
+
+        void parse(const Context &context, const FormatterOption &) {
+            if (!context.colon) return;
+            const char *iter = context.colon + 1;
+            if (context.end - iter >= 3 && memcmp(iter, "b64", 3) == 0) {
+                base64 = true;
+                return;
+            }
+            if (iter < context.end && (*iter == 'x' || *iter == 'X')) upper = *iter++ == 'X';
+            if (iter < context.end && *iter == 's') ++iter;
+            for (; iter < context.end && is_digit(*iter); ++iter)
+                group = group * 10 + (*iter - '0');
+        }
+
+        template <class output_str_function_wrap>
+        Result<bool, format_error> format(const byte_span &span, output_str_function_wrap &&out_fct_wrap) const {
+            if (base64)
+                details::write_base64(out_fct_wrap, span.data, span.size);
+            else
+                details::write_hex(out_fct_wrap, span.data, span.size, upper, group);
+            return Ok(true);
+        }
+    };
+}
+#endif //HEXDUMP_HPP
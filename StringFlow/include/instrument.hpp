@@ -0,0 +1,395 @@
+//
+// Created by ruixuezhao on 25-3-22.
+//
+
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "format.hpp"
+
+/**
+ * @brief 按调用处统计格式化开销: 调用次数、输出字节数、错误次数与延迟直方图
+ *
+ * @note 默认关闭. 定义 STRINGFLOW_INSTRUMENT 后, STRINGFLOW_FORMAT_TO / STRINGFLOW_PRINT / STRINGFLOW_PRINTLN
+ *       在每个调用处生成一个静态的 call_site(格式字符串、文件与行号), 每次调用计时并累加到当前线程的分片;
+ *       未定义时这些宏直接展开为 format_to / print / println, 没有任何额外开销.
+ *
+ *       STRINGFLOW_PRINTLN("request {} took {}us", id, elapsed).unwrap();
+ *       ...
+ *       StringFlow::instrument_registry::global().dump(putchar, 10).unwrap();  // 输出字节数最多的 10 个调用处
+ *
+ *       每个线程第一次经过某个调用处时为它分配一个分片并挂到该调用处的无锁链表上, 之后只有本线程写入,
+ *       计数用 relaxed 原子变量的 load + store 完成, 没有锁与 RMW 指令. 每个分片约 2.4KB;
+ *       线程退出时交还分片(数据仍计入快照), 之后的线程优先接管空闲分片, 因此分片总数不超过
+ *       同时经过该调用处的线程数. call_site 析构时从登记表注销并释放分片, 静态析构期间的快照不会读到已销毁的调用处;
+ *       线程退出时只交还登记表中仍存在的调用处的分片, 因此局部调用处可以先于写入过它的线程析构.
+ */
+namespace StringFlow {
+    /**
+     * @brief HDR 风格的对数-线性直方图: 每个 2 的幂区间再等分为 8 个子区间, 相对误差不超过 12.5%
+     *
+     * @note 记录范围为 [0, 2^40) 纳秒(约 18 分钟), 更大的值计入最后一个桶
+     */
+    class latency_histogram {
+    public:
+        static constexpr unsigned sub_bits = 3;
+        static constexpr unsigned max_bits = 40;
+        static constexpr size_t bucket_count = (max_bits - sub_bits + 1) << sub_bits;
+
+        static constexpr size_t bucket_of(uint64_t value) {
+            constexpr uint64_t sub_count = uint64_t(1) << sub_bits;
+            if (value >= (uint64_t(1) << max_bits)) value = (uint64_t(1) << max_bits) - 1;
+            if (value < sub_count) return static_cast<size_t>(value);
+            unsigned exponent = sub_bits;
+            while (value >> (exponent + 1)) ++exponent;
+            const unsigned shift = exponent - sub_bits;
+            return static_cast<size_t>(((shift + 1) << sub_bits) + ((value >> shift) & (sub_count - 1)));
+        }
+
+        // 桶内的最大值
+        static constexpr uint64_t bucket_upper(size_t bucket) {
+            constexpr size_t sub_count = size_t(1) << sub_bits;
+            if (bucket < sub_count) return bucket;
+            const unsigned shift = static_cast<unsigned>(bucket / sub_count - 1);
+            return ((sub_count + bucket % sub_count) << shift) + (uint64_t(1) << shift) - 1;
+        }
+
+        void record(uint64_t value) {
+            ++m_buckets[bucket_of(value)];
+            ++m_count;
+            if (value > m_max) m_max = value;
+        }
+
+        void add(size_t bucket, uint64_t count) {
+            m_buckets[bucket] += count;
+            m_count += count;
+            if (count && bucket_upper(bucket) > m_max) m_max = bucket_upper(bucket);
+        }
+
+        /**
+         * @brief 分位数(0 到 1), 返回所在桶的最大值; 没有数据时返回 0
+         */
+        uint64_t percentile(double quantile) const {
+            if (!m_count) return 0;
+            const auto rank = static_cast<uint64_t>(quantile * static_cast<double>(m_count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < bucket_count; ++i) {
+                seen += m_buckets[i];
+                if (seen >= rank) return std::min(bucket_upper(i), m_max);
+            }
+            return m_max;
+        }
+
+        uint64_t count() const { return m_count; }
+        uint64_t max() const { return m_max; }
+
+    private:
+        uint64_t m_buckets[bucket_count] = {};
+        uint64_t m_count = 0;
+        uint64_t m_max = 0;
+    };
+
+    class call_site;
+
+    /**
+     * @brief 一个调用处的统计快照
+     *
+     * @note format/file/line 在快照时复制, site 只用于识别调用处, 调用处析构后不应再解引用
+     */
+    struct call_site_stats {
+        const call_site *site = nullptr;
+        const char *format = nullptr;
+        const char *file = nullptr;
+        unsigned line = 0;
+        uint64_t calls = 0;
+        uint64_t bytes = 0;
+        uint64_t errors = 0;
+        latency_histogram latency;  // 纳秒
+    };
+
+    /**
+     * @brief 所有调用处的登记表
+     */
+    class instrument_registry {
+    public:
+        static instrument_registry &global() {
+            static instrument_registry registry;
+            return registry;
+        }
+
+        uint32_t add(call_site *site) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sites.push_back(site);
+            return static_cast<uint32_t>(m_sites.size() - 1);
+        }
+
+        // 调用处析构时注销; 编号不复用, 线程局部的分片表仍以编号为下标
+        void remove(uint32_t id) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (id < m_sites.size()) m_sites[id] = nullptr;
+        }
+
+        /**
+         * @brief 线程退出时交还分片表中的分片, 表以调用处编号为下标
+         *
+         * @note 持锁检查调用处是否仍在登记表中: 已析构的调用处已释放其分片, 对应表项不再访问.
+         *       调用处析构时先在同一把锁下注销再释放分片, 两者不会交错
+         */
+        template <typename Shard>
+        void release(const std::vector<Shard *> &shards) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t id = 0; id < shards.size() && id < m_sites.size(); ++id)
+                if (shards[id] && m_sites[id]) shards[id]->in_use.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @brief 汇总各线程的分片, 按输出字节数从多到少排序
+         */
+        std::vector<call_site_stats> snapshot() const;
+
+        /**
+         * @brief 把各分片的计数清零; 与写入并发时个别计数可能丢失
+         */
+        void reset();
+
+        /**
+         * @brief 以表格形式输出前 limit 个调用处, limit 为 0 时全部输出
+         */
+        template <class output_str_function_wrap>
+        Result<size_t, format_error_info> dump(output_str_function_wrap &&out_fct_wrap, size_t limit = 0) const;
+
+    private:
+        instrument_registry() = default;
+
+        mutable std::mutex m_mutex;
+        std::vector<call_site *> m_sites;
+    };
+
+    /**
+     * @brief 一处格式化调用的元数据与各线程的计数分片
+     */
+    class call_site {
+    public:
+        struct shard {
+            std::atomic<uint64_t> calls{0};
+            std::atomic<uint64_t> bytes{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<uint64_t> buckets[latency_histogram::bucket_count] = {};
+            std::atomic<bool> in_use{true};  // 线程退出时置为 false, 由之后的线程接管
+            shard *next = nullptr;
+        };
+
+        // 登记表在第一个调用处的构造过程中创建, 因此晚于所有调用处析构
+        call_site(const char *file, unsigned line) : m_file(file), m_line(line) {
+            m_id = instrument_registry::global().add(this);
+        }
+
+        ~call_site() {
+            instrument_registry::global().remove(m_id);
+            for (shard *iter = m_shards.load(std::memory_order_acquire); iter;) {
+                shard *next = iter->next;
+                delete iter;
+                iter = next;
+            }
+        }
+
+        call_site(const call_site &) = delete;
+        call_site &operator=(const call_site &) = delete;
+
+        // 第一次调用时记录格式字符串
+        void bind(const char *format) {
+            if (!m_format.load(std::memory_order_relaxed)) m_format.store(format, std::memory_order_relaxed);
+        }
+
+        void record(uint64_t nanoseconds, uint64_t bytes, bool failed) {
+            shard &local = local_shard();
+            auto bump = [](auto &counter, uint64_t delta) {
+                counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            };
+            bump(local.calls, 1);
+            bump(local.bytes, bytes);
+            if (failed) bump(local.errors, 1);
+            bump(local.buckets[latency_histogram::bucket_of(nanoseconds)], 1);
+        }
+
+        const char *format() const { return m_format.load(std::memory_order_relaxed); }
+        const char *file() const { return m_file; }
+        unsigned line() const { return m_line; }
+
+        call_site_stats stats() const {
+            call_site_stats result;
+            result.site = this;
+            result.format = format();
+            result.file = m_file;
+            result.line = m_line;
+            for (const shard *iter = m_shards.load(std::memory_order_acquire); iter; iter = iter->next) {
+                result.calls += iter->calls.load(std::memory_order_relaxed);
+                result.bytes += iter->bytes.load(std::memory_order_relaxed);
+                result.errors += iter->errors.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < latency_histogram::bucket_count; ++i)
+                    result.latency.add(i, iter->buckets[i].load(std::memory_order_relaxed));
+            }
+            return result;
+        }
+
+        // 已分配的分片数
+        size_t shard_count() const {
+            size_t count = 0;
+            for (const shard *iter = m_shards.load(std::memory_order_acquire); iter; iter = iter->next) ++count;
+            return count;
+        }
+
+        void reset() {
+            for (shard *iter = m_shards.load(std::memory_order_acquire); iter; iter = iter->next) {
+                iter->calls.store(0, std::memory_order_relaxed);
+                iter->bytes.store(0, std::memory_order_relaxed);
+                iter->errors.store(0, std::memory_order_relaxed);
+                for (auto &bucket : iter->buckets) bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        // 线程局部的分片表, 线程退出时交还其中仍然存活的调用处的分片
+        struct shard_table {
+            std::vector<shard *> shards;
+
+            ~shard_table() {
+                if (!shards.empty()) instrument_registry::global().release(shards);
+            }
+        };
+
+        // 当前线程的分片, 以调用处编号为下标缓存在线程局部的表中; 优先接管已退出线程的分片
+        shard &local_shard() {
+            thread_local shard_table table;
+            std::vector<shard *> &shards = table.shards;
+            if (m_id < shards.size() && shards[m_id]) return *shards[m_id];
+
+            shard *adopted = nullptr;
+            for (shard *iter = m_shards.load(std::memory_order_acquire); iter && !adopted; iter = iter->next) {
+                bool in_use = false;
+                if (!iter->in_use.load(std::memory_order_relaxed) &&
+                    iter->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+                    adopted = iter;
+            }
+            if (!adopted) {
+                adopted = new shard;
+                adopted->next = m_shards.load(std::memory_order_relaxed);
+                while (!m_shards.compare_exchange_weak(adopted->next, adopted, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {}
+            }
+            if (shards.size() <= m_id) shards.resize(m_id + 1, nullptr);
+            shards[m_id] = adopted;
+            return *adopted;
+        }
+
+        std::atomic<const char *> m_format{nullptr};
+        const char *m_file;
+        unsigned m_line;
+        uint32_t m_id = 0;
+        std::atomic<shard *> m_shards{nullptr};
+    };
+
+    inline std::vector<call_site_stats> instrument_registry::snapshot() const {
+        std::vector<call_site_stats> result;
+        {
+            // 持锁汇总, 调用处不会在读取期间析构
+            std::lock_guard<std::mutex> lock(m_mutex);
+            result.reserve(m_sites.size());
+            for (const call_site *site : m_sites)
+                if (site) result.push_back(site->stats());
+        }
+        std::stable_sort(result.begin(), result.end(),
+                         [](const call_site_stats &lhs, const call_site_stats &rhs) { return lhs.bytes > rhs.bytes; });
+        return result;
+    }
+
+    inline void instrument_registry::reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (call_site *site : m_sites)
+            if (site) site->reset();
+    }
+
+    template <class output_str_function_wrap>
+    Result<size_t, format_error_info> instrument_registry::dump(output_str_function_wrap &&out_fct_wrap, size_t limit) const {
+        const std::vector<call_site_stats> stats = snapshot();
+        const size_t rows = limit && limit < stats.size() ? limit : stats.size();
+        auto header = format_to(out_fct_wrap, "{:>10} {:>12} {:>8} {:>10} {:>10} {:>10}  {}\n",
+                                "calls", "bytes", "errors", "p50(ns)", "p99(ns)", "max(ns)", "site");
+        if (header.is_err()) return header;
+        for (size_t i = 0; i < rows; ++i) {
+            const call_site_stats &row = stats[i];
+            auto written = format_to(out_fct_wrap, "{:>10} {:>12} {:>8} {:>10} {:>10} {:>10}  {}:{} {:j}\n",
+                                     row.calls, row.bytes, row.errors, row.latency.percentile(0.5),
+                                     row.latency.percentile(0.99), row.latency.max(), row.file, row.line,
+                                     row.format ? row.format : "");
+            if (written.is_err()) return written;
+        }
+        return Ok(rows);
+    }
+
+    namespace details {
+        // 统计写入字节数的输出函数包装
+        template <class output_str_function_wrap>
+        struct counting_sink {
+            output_str_function_wrap &out;
+            uint64_t &bytes;
+
+            void operator()(char ch) {
+                ++bytes;
+                out(ch);
+            }
+
+            void operator()(const char *data, size_t size) {
+                bytes += size;
+                write_span(out, data, size);
+            }
+        };
+
+        inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    /**
+     * @brief 带统计的 format_to, 一般通过 STRINGFLOW_FORMAT_TO 等宏调用
+     */
+    template <class output_str_function_wrap, typename... Args>
+    Result<size_t, format_error_info> instrumented_format_to(call_site &site, output_str_function_wrap &&out_fct_wrap,
+                                                             const char *format, Args &&...args) {
+        site.bind(format);
+        uint64_t bytes = 0;
+        details::counting_sink<std::remove_reference_t<output_str_function_wrap>> counting{out_fct_wrap, bytes};
+        const auto start = std::chrono::steady_clock::now();
+        auto result = format_to(counting, format, std::forward<Args>(args)...);
+        site.record(details::elapsed_ns(start), bytes, result.is_err());
+        return result;
+    }
+
+    template <typename... Args>
+    Result<size_t, format_error_info> instrumented_println(call_site &site, const char *format, Args &&...args) {
+        auto result = instrumented_format_to(site, putchar, format, std::forward<Args>(args)...);
+        putchar('\n');
+        return result;
+    }
+}
+
+#if defined(STRINGFLOW_INSTRUMENT)
+#define STRINGFLOW_INSTRUMENTED_CALL(function, ...)                                      \
+    ([&]() {                                                                             \
+        static ::StringFlow::call_site stringflow_call_site_(__FILE__, __LINE__);         \
+        return ::StringFlow::function(stringflow_call_site_, __VA_ARGS__);               \
+    }())
+#define STRINGFLOW_FORMAT_TO(out, ...) STRINGFLOW_INSTRUMENTED_CALL(instrumented_format_to, out, __VA_ARGS__)
+#define STRINGFLOW_PRINT(...) STRINGFLOW_INSTRUMENTED_CALL(instrumented_format_to, putchar, __VA_ARGS__)
+#define STRINGFLOW_PRINTLN(...) STRINGFLOW_INSTRUMENTED_CALL(instrumented_println, __VA_ARGS__)
+#else
+#define STRINGFLOW_FORMAT_TO(out, ...) ::StringFlow::format_to(out, __VA_ARGS__)
+#define STRINGFLOW_PRINT(...) ::StringFlow::print(__VA_ARGS__)
+#define STRINGFLOW_PRINTLN(...) ::StringFlow::println(__VA_ARGS__)
+#endif
+#endif //INSTRUMENT_HPP
@@ -15,18 +15,47 @@ namespace StringFlow
     };
 
     template <typename integral>
-    size_t itoa(integral value, char *string, size_t radix = 10, IotaCase type = IotaCase::Lower);
+    constexpr size_t itoa(integral value, char *string, size_t radix = 10, IotaCase type = IotaCase::Lower);
+
+    /**
+     * @brief 数字分组规则, 语义同 std::numpunct::grouping()
+     *
+     * @note sizes[0] 为最右侧一组的位数, 之后依次向左; 用完后重复最后一组; 某组为 0 表示不再分组
+     *       count 为 0 时不分组, 超过 sizes 的长度时按 sizes 的长度处理
+     */
+    struct digit_grouping
+    {
+        char separator = ',';
+        uint8_t sizes[4] = {3, 0, 0, 0};
+        uint8_t count = 1;
+
+        constexpr digit_grouping() = default;
+        constexpr digit_grouping(char sep, uint8_t size) : separator(sep), sizes{size, 0, 0, 0} {}
+        constexpr uint8_t group_size(size_t index) const {
+            const size_t used = count < sizeof(sizes) ? count : sizeof(sizes);
+            return used ? sizes[index < used ? index : used - 1] : 0;
+        }
+    };
+
+    /**
+     * @brief 无符号整数转字符串, 在生成数字的同时插入分组分隔符
+     *
+     * @return 写入的字符数(不含结尾 '\0'), string 至少需要 130 字节
+     */
+    template <typename unsigned_integral>
+    constexpr size_t itoa_grouped(unsigned_integral value, char *string, const digit_grouping &grouping,
+                                  size_t radix = 10, IotaCase type = IotaCase::Lower);
 } // namespace fmt
 
 template <typename integral>
-size_t StringFlow::itoa(integral value, char *string, size_t radix, IotaCase type)
+constexpr size_t StringFlow::itoa(integral value, char *string, size_t radix, IotaCase type)
 {
-    char tmp[33];
+    char tmp[sizeof(integral) * 8 + 1] = {};  // 二进制时每一位一个字符
     char *tp = tmp;
-    integral i;
-    integral v;
-    char sign;
-    char *sp;
+    integral i = 0;
+    integral v = 0;
+    char sign = '+';
+    char *sp = nullptr;
 
     static_assert(std::is_integral<integral>::value, "value is not signed integral");
 
@@ -65,4 +94,46 @@ size_t StringFlow::itoa(integral value, char *string, size_t radix, IotaCase typ
     return (size_t)(sp - string);
 }
 
+template <typename unsigned_integral>
+constexpr size_t StringFlow::itoa_grouped(unsigned_integral value, char *string, const digit_grouping &grouping,
+                                          size_t radix, IotaCase type)
+{
+    static_assert(std::is_unsigned<unsigned_integral>::value, "value is not unsigned integral");
+
+    char tmp[130] = {};
+    char *tp = tmp;
+    size_t group = 0;
+    size_t in_group = 0;
+    size_t limit = grouping.group_size(0);
+
+    if (string == nullptr || radix > 36 || radix <= 1)
+    {
+        return 0;
+    }
+
+    // 逆序生成数字, 每满一组插入一个分隔符
+    do
+    {
+        if (limit != 0 && in_group == limit)
+        {
+            *tp++ = grouping.separator;
+            in_group = 0;
+            limit = grouping.group_size(++group);
+        }
+        const auto digit = static_cast<size_t>(value % radix);
+        value /= radix;
+        *tp++ = static_cast<char>((digit < 10) ? (digit + '0') : (digit + (char)type - 10));
+        ++in_group;
+    } while (value != 0);
+
+    char *sp = string;
+    while (tp > tmp)
+    {
+        *sp++ = *--tp;
+    }
+    *sp = 0;
+
+    return (size_t)(sp - string);
+}
+
 #endif //ITOA_HPP
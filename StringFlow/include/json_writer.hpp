@@ -0,0 +1,186 @@
+//
+// Created by ruixuezhao on 25-3-20.
+//
+
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+#include <cmath>
+#include <string>
+#include <string_view>
+#include "format.hpp"
+
+/**
+ * @brief 直接写入输出函数的 JSON 构造器
+ *
+ * @note 逗号与冒号由 json_writer 按嵌套层次自动插入, 字符串经由 {:j} 相同的转义路径输出,
+ *       不构造 DOM 或中间字符串. 结构错误(例如在数组中调用 key)记录第一次出现的错误, 由 finish 返回.
+ *
+ *       StringFlow::json_writer json(putchar);
+ *       json.begin_object().key("name").value("StringFlow").key("tags").begin_array()
+ *           .value("fmt").value(3).end_array().end_object();
+ *       json.finish().unwrap();  // {"name":"StringFlow","tags":["fmt",3]}
+ */
+namespace StringFlow {
+    namespace details {
+        /**
+         * @brief 单个 JSON 值: 字符串转义后加引号, 整数按十进制, 浮点数按 15 位有效数字,
+         *        枚举按底层整数, nullptr、空的 C 字符串、NaN 与无穷大输出 null
+         */
+        template <class output_str_function_wrap, typename T>
+        Result<bool, format_error> write_json_value(output_str_function_wrap &out_fct_wrap, const T &data) {
+            using V = std::decay_t<T>;
+            if constexpr (std::is_same_v<V, std::nullptr_t>) {
+                write_span(out_fct_wrap, "null", 4);
+                return Ok(true);
+            } else if constexpr (std::is_same_v<V, bool>) {
+                write_span(out_fct_wrap, data ? "true" : "false", data ? 4 : 5);
+                return Ok(true);
+            } else if constexpr (std::is_enum_v<V>) {
+                return write_json_value(out_fct_wrap, static_cast<std::underlying_type_t<V>>(data));
+            } else if constexpr (std::is_arithmetic_v<V>) {
+                FormatterOption option;
+                Context{}.unpack_to(option);
+                if constexpr (std::is_floating_point_v<V>) {
+                    if (!std::isfinite(data)) return write_json_value(out_fct_wrap, nullptr);
+                    option.type = Type::gen;
+                    option.auto_precision = false;
+                    option.precision = 15;
+                } else {
+                    option.type = Type::Dec;
+                }
+                return format_value(out_fct_wrap, Context{}, option, data);
+            } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+                if constexpr (std::is_pointer_v<T>) {
+                    if (!data) return write_json_value(out_fct_wrap, nullptr);
+                }
+                const std::string_view text(data);
+                write_json_string(out_fct_wrap, text.data(), text.size());
+                return Ok(true);
+            } else {
+                static_assert(sizeof(V) == 0, "json value must be null, bool, number, enum or string");
+            }
+        }
+    }
+
+    template <class output_str_function_wrap>
+    class json_writer {
+    public:
+        static constexpr size_t max_depth = 64;
+
+        explicit json_writer(output_str_function_wrap &out_fct_wrap) : m_out(out_fct_wrap) {}
+
+        json_writer &begin_object() { return open('{', false); }
+        json_writer &end_object() { return close('}', false); }
+        json_writer &begin_array() { return open('[', true); }
+        json_writer &end_array() { return close(']', true); }
+
+        /**
+         * @brief 对象成员的键, 之后必须跟一个值
+         */
+        json_writer &key(std::string_view name) {
+            if (!m_depth || in_array() || m_pending_value) return fail(format_error::invalid_format_spec);
+            separator();
+            details::write_json_string(m_out, name.data(), name.size());
+            m_out(':');
+            m_pending_value = true;
+            return *this;
+        }
+
+        /**
+         * @brief 写入一个值, 取值规则见 details::write_json_value
+         */
+        template <typename T>
+        json_writer &value(const T &data) {
+            if (!begin_value()) return *this;
+            auto result = details::write_json_value(m_out, data);
+            if (result.is_err()) fail(result.unwrap_err());
+            return *this;
+        }
+
+        /**
+         * @brief 原样写入一个已经是合法 JSON 的值
+         */
+        json_writer &raw(std::string_view json) {
+            if (!begin_value()) return *this;
+            details::write_span(m_out, json.data(), json.size());
+            return *this;
+        }
+
+        /**
+         * @brief 所有对象与数组均已闭合且没有结构错误时返回 Ok
+         */
+        Result<bool, format_error> finish() const {
+            if (m_error != format_error::success) return Err(m_error);
+            if (m_depth || m_pending_value) return Err(format_error::unmatched_brace);
+            return Ok(true);
+        }
+
+    private:
+        bool in_array() const { return (m_array_mask >> (m_depth - 1)) & 1; }
+
+        // 同一层中第一个元素之前不写逗号
+        void separator() {
+            const uint64_t bit = uint64_t(1) << (m_depth - 1);
+            if (m_used_mask & bit) m_out(',');
+            m_used_mask |= bit;
+        }
+
+        // 值只能出现在顶层(一次)、数组中或键之后
+        bool begin_value() {
+            if (m_error != format_error::success) return false;
+            if (!m_depth) {
+                if (m_root_written) {
+                    fail(format_error::invalid_format_spec);
+                    return false;
+                }
+                m_root_written = true;
+                return true;
+            }
+            if (m_pending_value) {
+                m_pending_value = false;
+                return true;
+            }
+            if (!in_array()) {
+                fail(format_error::invalid_format_spec);
+                return false;
+            }
+            separator();
+            return true;
+        }
+
+        json_writer &open(char bracket, bool array) {
+            if (m_depth == max_depth) return fail(format_error::number_overflow);
+            if (!begin_value()) return *this;
+            m_out(bracket);
+            const uint64_t bit = uint64_t(1) << m_depth++;
+            m_used_mask &= ~bit;
+            m_array_mask = array ? (m_array_mask | bit) : (m_array_mask & ~bit);
+            return *this;
+        }
+
+        json_writer &close(char bracket, bool array) {
+            if (m_error != format_error::success) return *this;
+            if (!m_depth || in_array() != array || m_pending_value) return fail(format_error::unmatched_brace);
+            --m_depth;
+            m_out(bracket);
+            return *this;
+        }
+
+        json_writer &fail(format_error error) {
+            if (m_error == format_error::success) m_error = error;
+            return *this;
+        }
+
+        output_str_function_wrap &m_out;
+        uint64_t m_array_mask = 0;  // 第 i 层是否为数组
+        uint64_t m_used_mask = 0;   // 第 i 层是否已有元素
+        size_t m_depth = 0;
+        bool m_pending_value = false;
+        bool m_root_written = false;
+        format_error m_error = format_error::success;
+    };
+
+    template <class output_str_function_wrap>
+    json_writer(output_str_function_wrap &) -> json_writer<output_str_function_wrap>;
+}
+#endif //JSON_WRITER_HPP
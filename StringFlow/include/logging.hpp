@@ -0,0 +1,483 @@
+//
+// Created by ruixuezhao on 25-3-21.
+//
+
+#ifndef LOGGING_HPP
+#define LOGGING_HPP
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compiled_format.hpp"
+#include "json_writer.hpp"
+
+/**
+ * @brief 结构化日志: 调用处一次性声明消息模板与带类型的字段, 记录可编码为文本、JSON 或二进制
+ *
+ * @note log_event 通常声明为静态对象, 构造时(静态初始化阶段)完成所有与值无关的工作:
+ *       编译消息模板、为字段名建立名字表、预先渲染 JSON 的键、在 log_registry 中登记并取得编号.
+ *       之后每条记录只写入字段的值:
+ *
+ *       static const StringFlow::log_event<std::string_view, uint32_t> login{
+ *           StringFlow::log_level::info, "user {user} logged in from {port}", "user", "port"};
+ *
+ *       login.text(sink, user, port).unwrap();    // INFO user alice logged in from 8080
+ *       login.json(sink, user, port).unwrap();    // {"level":"INFO","msg":"user {user} ...","user":"alice","port":8080}
+ *       login.binary(sink, user, port).unwrap();  // [u32 长度][u32 编号][各字段的值]
+ *
+ *       下游收到二进制记录后用 decode_log_record 按编号取回模板与字段类型, 直接得到字段值,
+ *       不需要从文本中解析; render_log_record 可把二进制记录还原为与 text 相同的文本.
+ */
+namespace StringFlow {
+    enum class log_level : uint8_t {
+        trace,
+        debug,
+        info,
+        warn,
+        error,
+        fatal,
+    };
+
+    inline std::string_view log_level_name(log_level level) {
+        switch (level) {
+            case log_level::trace: return "TRACE";
+            case log_level::debug: return "DEBUG";
+            case log_level::info:  return "INFO";
+            case log_level::warn:  return "WARN";
+            case log_level::error: return "ERROR";
+            case log_level::fatal: return "FATAL";
+            default:               return "UNKNOWN";
+        }
+    }
+
+    /**
+     * @brief 二进制记录中字段值的编码方式, 由字段的声明类型决定, 不写入记录
+     */
+    enum class log_field_type : uint8_t {
+        boolean,   // 1 字节
+        signed_,   // zigzag 变长整数
+        unsigned_, // 变长整数
+        floating,  // 8 字节 double, 主机字节序
+        string,    // 变长整数长度 + 字节
+        character, // 单字节字符(char/int8_t/uint8_t), 原值的 zigzag 变长整数; 与 format_to 相同, 默认按字符输出
+        wide_char, // wchar_t/char16_t/char32_t, 码点的变长整数; 默认按 UTF-8 输出
+    };
+
+    namespace details {
+        template <typename T>
+        constexpr bool log_field_supported() {
+            using V = std::decay_t<T>;
+            return std::is_arithmetic_v<V> || std::is_enum_v<V> || std::is_convertible_v<const T &, std::string_view>;
+        }
+
+        template <typename T>
+        constexpr log_field_type log_field_type_of() {
+            using V = std::decay_t<T>;
+            if constexpr (std::is_same_v<V, bool>)
+                return log_field_type::boolean;
+            else if constexpr (std::is_enum_v<V>)
+                return log_field_type_of<std::underlying_type_t<V>>();
+            else if constexpr (type_check<V>::is_wide_character_v)
+                return log_field_type::wide_char;
+            else if constexpr (type_check<V>::is_character_v)
+                return log_field_type::character;
+            else if constexpr (std::is_floating_point_v<V>)
+                return log_field_type::floating;
+            else if constexpr (std::is_signed_v<V>)
+                return log_field_type::signed_;
+            else if constexpr (std::is_integral_v<V>)
+                return log_field_type::unsigned_;
+            else
+                return log_field_type::string;
+        }
+
+        inline size_t varint_size(uint64_t value) {
+            size_t size = 1;
+            for (; value >= 0x80; value >>= 7) ++size;
+            return size;
+        }
+
+        inline size_t write_varint(uint64_t value, char *out) {
+            size_t size = 0;
+            for (; value >= 0x80; value >>= 7)
+                out[size++] = static_cast<char>((value & 0x7F) | 0x80);
+            out[size++] = static_cast<char>(value);
+            return size;
+        }
+
+        inline bool read_varint(const uint8_t *&pos, const uint8_t *end, uint64_t &value) {
+            value = 0;
+            for (unsigned shift = 0; pos < end && shift < 64; shift += 7) {
+                const uint8_t byte = *pos++;
+                value |= uint64_t(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+
+        inline uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+        inline int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+        // 字符串字段统一按 string_view 处理, 空指针视为空串
+        template <typename T>
+        std::string_view log_string(const T &value) {
+            if constexpr (std::is_pointer_v<std::decay_t<T>>) {
+                if (!value) return {};
+            }
+            return std::string_view(value);
+        }
+
+        // 字段值在二进制记录中占用的字节数
+        template <typename T>
+        size_t log_field_size(const T &value) {
+            using V = std::decay_t<T>;
+            constexpr log_field_type type = log_field_type_of<T>();
+            if constexpr (std::is_enum_v<V>) {
+                return log_field_size(static_cast<std::underlying_type_t<V>>(value));
+            } else if constexpr (type == log_field_type::boolean) {
+                return 1;
+            } else if constexpr (type == log_field_type::floating) {
+                return sizeof(double);
+            } else if constexpr (type == log_field_type::signed_ || type == log_field_type::character) {
+                return varint_size(zigzag(static_cast<int64_t>(value)));
+            } else if constexpr (type == log_field_type::wide_char) {
+                return varint_size(static_cast<uint32_t>(value));
+            } else if constexpr (type == log_field_type::unsigned_) {
+                return varint_size(static_cast<uint64_t>(value));
+            } else {
+                const std::string_view text = log_string(value);
+                return varint_size(text.size()) + text.size();
+            }
+        }
+
+        template <class output_str_function_wrap, typename T>
+        void write_log_field(output_str_function_wrap &out_fct_wrap, const T &value) {
+            using V = std::decay_t<T>;
+            constexpr log_field_type type = log_field_type_of<T>();
+            char buffer[10];
+            if constexpr (std::is_enum_v<V>) {
+                write_log_field(out_fct_wrap, static_cast<std::underlying_type_t<V>>(value));
+            } else if constexpr (type == log_field_type::boolean) {
+                out_fct_wrap(static_cast<char>(value ? 1 : 0));
+            } else if constexpr (type == log_field_type::floating) {
+                const double number = static_cast<double>(value);
+                memcpy(buffer, &number, sizeof(number));
+                write_span(out_fct_wrap, buffer, sizeof(number));
+            } else if constexpr (type == log_field_type::signed_ || type == log_field_type::character) {
+                write_span(out_fct_wrap, buffer, write_varint(zigzag(static_cast<int64_t>(value)), buffer));
+            } else if constexpr (type == log_field_type::wide_char) {
+                write_span(out_fct_wrap, buffer, write_varint(static_cast<uint32_t>(value), buffer));
+            } else if constexpr (type == log_field_type::unsigned_) {
+                write_span(out_fct_wrap, buffer, write_varint(static_cast<uint64_t>(value), buffer));
+            } else {
+                const std::string_view text = log_string(value);
+                write_span(out_fct_wrap, buffer, write_varint(text.size(), buffer));
+                write_span(out_fct_wrap, text.data(), text.size());
+            }
+        }
+    }
+
+    class log_site;
+
+    /**
+     * @brief 按编号查找 log_site, 编号从 1 开始, 按登记顺序分配
+     *
+     * @note 同一程序的所有二进制记录共享这份编号; 下游解码时需要同一个程序(或相同登记顺序)的 registry
+     */
+    class log_registry {
+    public:
+        static log_registry &global() {
+            static log_registry registry;
+            return registry;
+        }
+
+        uint32_t add(const log_site *site) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sites.push_back(site);
+            return static_cast<uint32_t>(m_sites.size());
+        }
+
+        void remove(uint32_t id) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (id && id <= m_sites.size()) m_sites[id - 1] = nullptr;
+        }
+
+        const log_site *find(uint32_t id) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return id && id <= m_sites.size() ? m_sites[id - 1] : nullptr;
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_sites.size();
+        }
+
+    private:
+        log_registry() = default;
+
+        mutable std::mutex m_mutex;
+        std::vector<const log_site *> m_sites;
+    };
+
+    /**
+     * @brief 一处日志调用的元数据: 级别、消息模板、字段名与字段类型
+     */
+    class log_site {
+    public:
+        log_site(log_level level, const char *message, std::vector<std::string> names, std::vector<log_field_type> types)
+            : m_level(level), m_names(std::move(names)), m_types(std::move(types)),
+              m_table(m_names.begin(), m_names.end()), m_text(compile_template(message, m_table, m_names.size())) {
+            // {"level":"INFO","msg":"..."  以及每个字段的 ,"name":
+            auto append = [this](char ch) { m_json_prefix.push_back(ch); };
+            const std::string_view level_name = log_level_name(level);
+            m_json_prefix = "{\"level\":\"";
+            m_json_prefix.append(level_name.data(), level_name.size());
+            m_json_prefix += "\",\"msg\":";
+            details::write_json_string(append, message, strlen(message));
+            for (const std::string &name : m_names) {
+                std::string key = ",";
+                auto append_key = [&key](char ch) { key.push_back(ch); };
+                details::write_json_string(append_key, name.data(), name.size());
+                key += ':';
+                m_json_keys.push_back(std::move(key));
+            }
+            m_id = log_registry::global().add(this);
+        }
+
+        ~log_site() { log_registry::global().remove(m_id); }
+
+        log_site(const log_site &) = delete;
+        log_site &operator=(const log_site &) = delete;
+
+        uint32_t id() const { return m_id; }
+        log_level level() const { return m_level; }
+        const char *message() const { return m_text.c_str(); }
+        size_t field_count() const { return m_names.size(); }
+        const std::string &field_name(size_t index) const { return m_names[index]; }
+        log_field_type field_type(size_t index) const { return m_types[index]; }
+        const compiled_format &text_format() const { return m_text; }
+        const std::string &json_prefix() const { return m_json_prefix; }
+        const std::string &json_key(size_t index) const { return m_json_keys[index]; }
+
+    private:
+        // 模板在静态初始化阶段编译, 引用了未声明的字段时直接终止
+        static compiled_format compile_template(const char *message, const name_table &names, size_t count) {
+            return compiled_format::compile(message, &names)
+                .and_then([count](compiled_format &&compiled) -> Result<compiled_format, format_error_info> {
+                    size_t field = 0;
+                    for (const auto &segment : compiled.segments()) {
+                        if (!segment.has_field) continue;
+                        if (segment.arg_index >= count)
+                            return Err(format_error_info(format_error::argument_index_out_of_range, field,
+                                                         segment.context.begin - compiled.c_str()));
+                        ++field;
+                    }
+                    return Ok(std::move(compiled));
+                })
+                .expect("invalid log template");
+        }
+
+        log_level m_level;
+        uint32_t m_id = 0;
+        std::vector<std::string> m_names;
+        std::vector<log_field_type> m_types;
+        name_table m_table;
+        compiled_format m_text;
+        std::string m_json_prefix;
+        std::vector<std::string> m_json_keys;
+    };
+
+    /**
+     * @brief 带类型的日志事件, 字段的值按声明类型传入
+     *
+     * @note 支持的字段类型: bool、整数、字符(含宽字符)、浮点数、枚举与可转换为 std::string_view 的字符串;
+     *       字符与 format_to 一样默认按字符输出, render_log_record 对每种类型都还原出与 text 相同的文本
+     */
+    template <typename... Fields>
+    class log_event : public log_site {
+        static_assert((details::log_field_supported<Fields>() && ...),
+                      "log field must be bool, number, enum or string");
+
+    public:
+        template <typename... Names, typename = std::enable_if_t<sizeof...(Names) == sizeof...(Fields)>>
+        log_event(log_level level, const char *message, const Names &...names)
+            : log_site(level, message, {std::string(names)...}, {details::log_field_type_of<Fields>()...}) {}
+
+        /**
+         * @brief 文本: 级别名、空格、按模板格式化的消息与换行
+         */
+        template <class output_str_function_wrap>
+        Result<size_t, format_error_info> text(output_str_function_wrap &&out_fct_wrap, const Fields &...fields) const {
+            const std::string_view level_name = log_level_name(level());
+            details::write_span(out_fct_wrap, level_name.data(), level_name.size());
+            out_fct_wrap(' ');
+            auto formatted = format_to(out_fct_wrap, text_format(), fields...);
+            out_fct_wrap('\n');
+            return formatted;
+        }
+
+        /**
+         * @brief 单行 JSON: 级别、消息模板与各字段, 以换行结束
+         */
+        template <class output_str_function_wrap>
+        Result<size_t, format_error> json(output_str_function_wrap &&out_fct_wrap, const Fields &...fields) const {
+            details::write_span(out_fct_wrap, json_prefix().data(), json_prefix().size());
+            size_t index = 0;
+            format_error error = format_error::success;
+            auto write_field = [&](const auto &value) {
+                const std::string &key = json_key(index++);
+                details::write_span(out_fct_wrap, key.data(), key.size());
+                auto written = details::write_json_value(out_fct_wrap, value);
+                if (written.is_err() && error == format_error::success) error = written.unwrap_err();
+            };
+            (write_field(fields), ...);
+            out_fct_wrap('}');
+            out_fct_wrap('\n');
+            if (error != format_error::success) return Err(error);
+            return Ok(sizeof...(Fields));
+        }
+
+        /**
+         * @brief 二进制: u32 记录长度(不含自身) + u32 编号 + 各字段的值, 长度与编号为主机字节序
+         *
+         * @return 写入的总字节数
+         */
+        template <class output_str_function_wrap>
+        Result<size_t, format_error> binary(output_str_function_wrap &&out_fct_wrap, const Fields &...fields) const {
+            const size_t payload = sizeof(uint32_t) + (size_t(0) + ... + details::log_field_size(fields));
+            if (payload > UINT32_MAX) return Err(format_error::number_overflow);
+
+            char header[2 * sizeof(uint32_t)];
+            const auto length = static_cast<uint32_t>(payload);
+            const uint32_t site = id();
+            memcpy(header, &length, sizeof(length));
+            memcpy(header + sizeof(length), &site, sizeof(site));
+            details::write_span(out_fct_wrap, header, sizeof(header));
+            (details::write_log_field(out_fct_wrap, fields), ...);
+            return Ok(sizeof(uint32_t) + payload);
+        }
+    };
+
+    /**
+     * @brief 解码后的字段值, 字符串指向记录内部; character 存于 signed_, wide_char 的码点存于 unsigned_
+     */
+    struct log_value {
+        log_field_type type = log_field_type::boolean;
+        bool boolean = false;
+        int64_t signed_ = 0;
+        uint64_t unsigned_ = 0;
+        double floating = 0;
+        std::string_view string;
+    };
+
+    /**
+     * @brief 解码一条二进制记录, 对每个字段调用 visit(const log_site &, size_t index, const log_value &)
+     *
+     * @return 这条记录占用的字节数, 可据此继续解码后续记录; 数据不完整或编号未登记时返回错误
+     */
+    template <class Visitor>
+    Result<size_t, format_error> decode_log_record(const void *data, size_t size, Visitor &&visit) {
+        if (size < 2 * sizeof(uint32_t)) return Err(format_error::buffer_full);
+        const auto *begin = static_cast<const uint8_t *>(data);
+        uint32_t length = 0, id = 0;
+        memcpy(&length, begin, sizeof(length));
+        memcpy(&id, begin + sizeof(length), sizeof(id));
+        if (length < sizeof(id) || size - sizeof(length) < length) return Err(format_error::buffer_full);
+
+        const log_site *site = log_registry::global().find(id);
+        if (!site) return Err(format_error::argument_index_out_of_range);
+
+        const uint8_t *pos = begin + 2 * sizeof(uint32_t);
+        const uint8_t *const end = begin + sizeof(length) + length;
+        for (size_t index = 0; index < site->field_count(); ++index) {
+            log_value value;
+            value.type = site->field_type(index);
+            uint64_t raw = 0;
+            switch (value.type) {
+                case log_field_type::boolean:
+                    if (pos == end) return Err(format_error::buffer_full);
+                    value.boolean = *pos++ != 0;
+                    break;
+                case log_field_type::floating:
+                    if (end - pos < static_cast<ptrdiff_t>(sizeof(double))) return Err(format_error::buffer_full);
+                    memcpy(&value.floating, pos, sizeof(double));
+                    pos += sizeof(double);
+                    break;
+                case log_field_type::signed_:
+                case log_field_type::character:
+                    if (!details::read_varint(pos, end, raw)) return Err(format_error::buffer_full);
+                    value.signed_ = details::unzigzag(raw);
+                    break;
+                case log_field_type::unsigned_:
+                case log_field_type::wide_char:
+                    if (!details::read_varint(pos, end, raw)) return Err(format_error::buffer_full);
+                    value.unsigned_ = raw;
+                    break;
+                case log_field_type::string:
+                    if (!details::read_varint(pos, end, raw) || raw > static_cast<uint64_t>(end - pos))
+                        return Err(format_error::buffer_full);
+                    value.string = std::string_view(reinterpret_cast<const char *>(pos), raw);
+                    pos += raw;
+                    break;
+            }
+            visit(*site, index, value);
+        }
+        if (pos != end) return Err(format_error::invalid_format_spec);
+        return Ok(sizeof(length) + length);
+    }
+
+    /**
+     * @brief 把二进制记录还原为与 log_event::text 相同的文本
+     */
+    template <class output_str_function_wrap>
+    Result<size_t, format_error> render_log_record(output_str_function_wrap &&out_fct_wrap, const void *data, size_t size) {
+        log_value values[64];
+        auto decoded = decode_log_record(data, size, [&](const log_site &, size_t index, const log_value &value) {
+            if (index < 64) values[index] = value;
+        });
+        if (decoded.is_err()) return decoded;
+
+        // 解码成功时记录头完整且编号已登记; 直接按编号查找, 没有字段的事件也能还原
+        uint32_t id = 0;
+        memcpy(&id, static_cast<const char *>(data) + sizeof(uint32_t), sizeof(id));
+        const log_site *site = log_registry::global().find(id);
+        if (!site) return Err(format_error::argument_index_out_of_range);
+        if (site->field_count() > 64) return Err(format_error::number_overflow);
+
+        const std::string_view level_name = log_level_name(site->level());
+        details::write_span(out_fct_wrap, level_name.data(), level_name.size());
+        out_fct_wrap(' ');
+        for (const auto &segment : site->text_format().segments()) {
+            details::write_span(out_fct_wrap, segment.text, segment.text_size);
+            if (!segment.has_field) continue;
+            auto formatted = [&](const log_value &value) -> Result<bool, format_error> {
+                switch (value.type) {
+                    case log_field_type::boolean:
+                        return details::format_value(out_fct_wrap, segment.context, segment.option, value.boolean);
+                    case log_field_type::signed_:
+                        return details::format_value(out_fct_wrap, segment.context, segment.option, value.signed_);
+                    case log_field_type::unsigned_:
+                        return details::format_value(out_fct_wrap, segment.context, segment.option, value.unsigned_);
+                    case log_field_type::floating:
+                        return details::format_value(out_fct_wrap, segment.context, segment.option, value.floating);
+                    case log_field_type::character:
+                        // 按原值的符号选择字符类型, 默认输出字符, 指定 d/x 等类型时输出原来的数值
+                        if (value.signed_ < 0)
+                            return details::format_value(out_fct_wrap, segment.context, segment.option,
+                                                         static_cast<signed char>(value.signed_));
+                        return details::format_value(out_fct_wrap, segment.context, segment.option,
+                                                     static_cast<unsigned char>(value.signed_));
+                    case log_field_type::wide_char:
+                        return details::format_value(out_fct_wrap, segment.context, segment.option,
+                                                     static_cast<char32_t>(value.unsigned_));
+                    default:
+                        return details::format_value(out_fct_wrap, segment.context, segment.option, value.string);
+                }
+            }(values[segment.arg_index]);
+            if (formatted.is_err()) return Err(formatted.unwrap_err());
+        }
+        out_fct_wrap('\n');
+        return decoded;
+    }
+}
+#endif //LOGGING_HPP
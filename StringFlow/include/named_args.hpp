@@ -0,0 +1,152 @@
+//
+// Created by ruixuezhao on 25-3-12.
+//
+
+#ifndef NAMED_ARGS_HPP
+#define NAMED_ARGS_HPP
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "utils.hpp"
+
+/**
+ * @brief 具名参数
+ *
+ * @note 两种用法:
+ *       1. 调用处绑定名字: format_to(out, "{user}@{host}", arg("user", u), arg("host", h));
+ *       2. 运行期模板(如配置文件中的告警模板)预先建立名字表, 按名字表顺序传入位置参数:
+ *          static const name_table names{"user", "host"};
+ *          format_to(out, names, tpl, u, h);
+ *          名字表使用完美哈希, 每个字段的查找为 O(1).
+ */
+namespace StringFlow {
+    static inline constexpr bool is_name_start(char ch) { return is_upper(ch) || is_lower(ch) || ch == '_'; }
+    static inline constexpr bool is_name_char(char ch) { return is_name_start(ch) || is_digit(ch); }
+
+    // 名字哈希(FNV-1a, 带种子以便构造完美哈希)
+    static inline constexpr uint32_t name_hash(const char *name, size_t size, uint32_t seed = 0) {
+        uint32_t hash = 2166136261u ^ seed;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint8_t>(name[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static inline constexpr bool name_equal(const char *lhs, size_t lhs_size, const char *rhs, size_t rhs_size) {
+        if (lhs_size != rhs_size) return false;
+        for (size_t i = 0; i < lhs_size; ++i)
+            if (lhs[i] != rhs[i]) return false;
+        return true;
+    }
+
+    /**
+     * @brief 具名参数, 只保存名字与值的引用, 不拷贝参数
+     */
+    template <typename T>
+    struct named_arg {
+        const char *name;
+        size_t size;
+        const T &value;
+    };
+
+    template <typename T>
+    struct is_named_arg : std::false_type {};
+    template <typename T>
+    struct is_named_arg<named_arg<T>> : std::true_type {};
+    template <typename T>
+    inline constexpr bool is_named_arg_v = is_named_arg<std::remove_cv_t<std::remove_reference_t<T>>>::value;
+
+    template <size_t N, typename T>
+    constexpr named_arg<std::remove_cv_t<std::remove_reference_t<T>>> arg(const char (&name)[N], const T &value) {
+        return {name, N - 1, value};
+    }
+
+    template <typename T>
+    constexpr named_arg<std::remove_cv_t<std::remove_reference_t<T>>> arg(std::string_view name, const T &value) {
+        return {name.data(), name.size(), value};
+    }
+
+    static constexpr size_t npos_arg = static_cast<size_t>(-1);
+
+    namespace details {
+        template <size_t Index>
+        constexpr size_t find_named_arg(const char *, size_t) { return npos_arg; }
+
+        // 在参数包中按名字查找具名参数的下标, 找不到返回 npos_arg
+        template <size_t Index, typename Arg, typename... Args>
+        constexpr size_t find_named_arg(const char *name, size_t size, const Arg &arg, const Args &...args) {
+            if constexpr (is_named_arg_v<Arg>) {
+                if (name_equal(arg.name, arg.size, name, size)) return Index;
+            }
+            return find_named_arg<Index + 1>(name, size, args...);
+        }
+    } // namespace details
+
+    /**
+     * @brief 运行期名字表, 构造时一次性求出完美哈希种子, 之后每次查找只需一次哈希与一次比较
+     */
+    class name_table {
+    public:
+        name_table() = default;
+        name_table(std::initializer_list<std::string_view> names) : name_table(names.begin(), names.end()) {}
+
+        template <class Iterator>
+        name_table(Iterator first, Iterator last) {
+            for (; first != last; ++first)
+                m_names.emplace_back(*first);
+            build();
+        }
+
+        /**
+         * @return 名字在表中的下标(即对应位置参数的下标), 不存在时返回 npos_arg
+         */
+        size_t index_of(const char *name, size_t size) const {
+            if (m_slots.empty()) return npos_arg;
+            const uint32_t slot = name_hash(name, size, m_seed) & m_mask;
+            const uint32_t index = m_slots[slot];
+            if (index == empty_slot) return npos_arg;
+            const std::string &candidate = m_names[index];
+            return name_equal(candidate.data(), candidate.size(), name, size) ? index : npos_arg;
+        }
+        size_t index_of(std::string_view name) const { return index_of(name.data(), name.size()); }
+
+        size_t size() const { return m_names.size(); }
+
+    private:
+        static constexpr uint32_t empty_slot = static_cast<uint32_t>(-1);
+
+        void build() {
+            if (m_names.empty()) return;
+            // 槽位数取不小于 2n 的 2 的幂, 逐个尝试种子直到无冲突; 多次失败则扩大表
+            uint32_t capacity = 1;
+            while (capacity < m_names.size() * 2) capacity <<= 1;
+
+            for (;; capacity <<= 1) {
+                m_mask = capacity - 1;
+                for (m_seed = 0; m_seed < 256; ++m_seed) {
+                    m_slots.assign(capacity, empty_slot);
+                    bool collided = false;
+                    for (uint32_t i = 0; i < m_names.size() && !collided; ++i) {
+                        const uint32_t slot = name_hash(m_names[i].data(), m_names[i].size(), m_seed) & m_mask;
+                        if (m_slots[slot] == empty_slot)
+                            m_slots[slot] = i;
+                        else
+                            collided = !name_equal(m_names[m_slots[slot]].data(), m_names[m_slots[slot]].size(),
+                                                   m_names[i].data(), m_names[i].size());
+                    }
+                    if (!collided) return;
+                }
+            }
+        }
+
+        std::vector<std::string> m_names;
+        std::vector<uint32_t> m_slots;
+        uint32_t m_mask = 0;
+        uint32_t m_seed = 0;
+    };
+}
+#endif //NAMED_ARGS_HPP
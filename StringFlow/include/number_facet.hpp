@@ -0,0 +1,77 @@
+//
+// Created by ruixuezhao on 25-3-17.
+//
+
+#ifndef NUMBER_FACET_HPP
+#define NUMBER_FACET_HPP
+#include <climits>
+#include <locale>
+#include <string>
+#include "itoa.hpp"
+
+/**
+ * @brief 数字本地化信息: 小数点、千位分隔符与分组规则
+ *
+ * @note {:L} 使用当前线程缓存的 number_facet. 每个线程第一次使用时从全局 std::locale 读取一次,
+ *       之后格式化只读取这份缓存, 不再访问 std::locale. 修改全局 locale 后需调用 reload_thread
+ *       或 set_thread 更新当前线程的缓存.
+ *
+ *       StringFlow::number_facet::set_thread(StringFlow::number_facet(',', '.'));
+ *       StringFlow::println("{:.2Lf}", 1234567.5).unwrap();  // 1.234.567,50
+ */
+namespace StringFlow {
+    class number_facet {
+    public:
+        constexpr number_facet() = default;
+        constexpr number_facet(char decimal_point, char thousands_sep, digit_grouping grouping = {})
+            : m_decimal_point(decimal_point), m_grouping(grouping) {
+            m_grouping.separator = thousands_sep;
+        }
+
+        /**
+         * @brief 从 std::locale 的 numpunct<char> 读取本地化信息
+         */
+        static number_facet from_locale(const std::locale &locale) {
+            const auto &punct = std::use_facet<std::numpunct<char>>(locale);
+            const std::string sizes = punct.grouping();
+
+            digit_grouping grouping;
+            grouping.separator = punct.thousands_sep();
+            grouping.count = 0;
+            for (size_t i = 0; i < sizes.size() && i < sizeof(grouping.sizes); ++i) {
+                // 非正数或 CHAR_MAX 表示此后不再分组
+                const bool stop = sizes[i] <= 0 || sizes[i] == CHAR_MAX;
+                grouping.sizes[grouping.count++] = stop ? 0 : static_cast<uint8_t>(sizes[i]);
+                if (stop) break;
+            }
+            if (grouping.count == 0) {
+                grouping.sizes[0] = 0;
+                grouping.count = 1;
+            }
+            return number_facet(punct.decimal_point(), grouping.separator, grouping);
+        }
+
+        constexpr char decimal_point() const { return m_decimal_point; }
+        constexpr char thousands_sep() const { return m_grouping.separator; }
+        constexpr const digit_grouping &grouping() const { return m_grouping; }
+
+        /**
+         * @brief 当前线程缓存的 facet
+         */
+        static const number_facet &thread() { return thread_slot(); }
+
+        static void set_thread(const number_facet &facet) { thread_slot() = facet; }
+
+        static void reload_thread(const std::locale &locale = std::locale()) { thread_slot() = from_locale(locale); }
+
+    private:
+        static number_facet &thread_slot() {
+            thread_local number_facet facet = from_locale(std::locale());
+            return facet;
+        }
+
+        char m_decimal_point = '.';
+        digit_grouping m_grouping;
+    };
+}
+#endif //NUMBER_FACET_HPP
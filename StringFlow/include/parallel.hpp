@@ -0,0 +1,336 @@
+//
+// Created by ruixuezhao on 25-3-24.
+//
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "compiled_format.hpp"
+#include "ranges.hpp"
+
+/**
+ * @brief 多线程批量格式化: 每条记录输出一行, 输出顺序与记录顺序一致
+ *
+ * @note 记录按 chunk_records 条分块, 工作线程通过一个原子计数器领取下一块(块的代价相近, 动态领取即可均衡负载),
+ *       格式串只预编译一次. 记录为 std::tuple/std::pair 时展开为多个参数, 否则作为单个参数.
+ *
+ *       1. parallel_format_lines: 每块先写入线程自己的缓冲区, 按块的顺序交给输出函数;
+ *          最多 window 块在途, 内存占用与记录总数无关.
+ *          StringFlow::parallel_format_lines(rows, "{},{},{:.3f}", [&](const char *data, size_t size) { ... }).unwrap();
+ *
+ *       2. parallel_format_lines_into: 先并行计算每块的输出长度, 前缀和得到每块的偏移,
+ *          由 allocate(total) 给出目标区域(例如 ftruncate 后 mmap 的文件), 各线程直接写入自己的位置.
+ *
+ *       3. parallel_try_transform: result_algorithm.h 中 try_transform 的多线程版本, 用于大批量的校验与转换.
+ */
+namespace StringFlow {
+    struct parallel_options {
+        size_t threads = 0;           // 0 表示 std::thread::hardware_concurrency()
+        size_t chunk_records = 4096;  // 每块的记录数
+        size_t window = 0;            // 同时在途的块数, 0 表示线程数的 4 倍
+    };
+
+    namespace details {
+        inline size_t parallel_threads(const parallel_options &options, size_t chunks) {
+            size_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+            if (!threads) threads = 1;
+            return threads < chunks ? threads : (chunks ? chunks : 1);
+        }
+
+        /**
+         * @brief 用 threads 个线程(含调用线程)处理 [0, chunks) 的所有块, work(chunk) 返回 false 时其余线程停止领取
+         *
+         * @note 工作线程先装入调用线程的 number_facet, {:L} 在哪个线程上格式化结果都相同
+         */
+        template <class Work>
+        void parallel_chunks(size_t threads, size_t chunks, Work &&work) {
+            std::atomic<size_t> next{0};
+            std::atomic<bool> stopped{false};
+            const number_facet facet = number_facet::thread();
+            auto run = [&] {
+                for (size_t chunk; !stopped.load(std::memory_order_relaxed) &&
+                                   (chunk = next.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+                    if (!work(chunk)) stopped.store(true, std::memory_order_relaxed);
+                }
+            };
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+            for (size_t i = 1; i < threads; ++i)
+                workers.emplace_back([&] {
+                    number_facet::set_thread(facet);
+                    run();
+                });
+            run();
+            for (auto &worker : workers) worker.join();
+        }
+
+        template <class output_str_function_wrap, typename Record>
+        Result<size_t, format_error_info> format_record(output_str_function_wrap &out_fct_wrap, const compiled_format &format,
+                                                        const Record &record) {
+            if constexpr (is_tuple_like<Record>::value) {
+                return std::apply([&](const auto &...fields) { return format_to(out_fct_wrap, format, fields...); }, record);
+            } else {
+                return format_to(out_fct_wrap, format, record);
+            }
+        }
+
+        // 记录第一个出错的块及其错误
+        template <typename E = format_error_info>
+        struct parallel_error {
+            std::mutex mutex;
+            size_t chunk = static_cast<size_t>(-1);
+            std::optional<E> error;
+
+            void record(size_t failed_chunk, E failed) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (failed_chunk < chunk) {
+                    chunk = failed_chunk;
+                    error.emplace(std::move(failed));
+                }
+            }
+        };
+
+        // 写入固定内存区域的输出函数, 超出 end 的部分丢弃并标记 overflow
+        struct pointer_sink {
+            char *pos;
+            char *end;
+            bool overflow = false;
+
+            void operator()(char ch) {
+                if (STRINGFLOW_LIKELY(pos != end))
+                    *pos++ = ch;
+                else
+                    overflow = true;
+            }
+            void operator()(const char *data, size_t size) {
+                if (STRINGFLOW_UNLIKELY(size > static_cast<size_t>(end - pos))) {
+                    size = end - pos;
+                    overflow = true;
+                }
+                if (size) memcpy(pos, data, size);
+                pos += size;
+            }
+        };
+
+        // 只统计长度的输出函数
+        struct size_sink {
+            size_t size = 0;
+
+            void operator()(char) { ++size; }
+            void operator()(const char *, size_t length) { size += length; }
+        };
+    }
+
+    /**
+     * @brief 并行格式化 records, 每条记录一行, 按顺序交给 out_fct_wrap
+     *
+     * @return 记录条数; 某条记录格式化失败时返回最靠前的错误, 其之前的块已经输出
+     */
+    template <class Range, class output_str_function_wrap>
+    Result<size_t, format_error_info> parallel_format_lines(const Range &records, const char *format,
+                                                            output_str_function_wrap &&out_fct_wrap,
+                                                            const parallel_options &options = {}) {
+        static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                        typename std::iterator_traits<decltype(std::begin(records))>::iterator_category>,
+                      "parallel_format_lines requires a random access range");
+        auto compiled = compiled_format::compile(format);
+        if (compiled.is_err()) return Err(compiled.unwrap_err());
+        const compiled_format &tpl = compiled.unwrap();
+
+        const auto first = std::begin(records);
+        const size_t count = static_cast<size_t>(std::size(records));
+        const size_t per_chunk = options.chunk_records ? options.chunk_records : 4096;
+        const size_t chunks = (count + per_chunk - 1) / per_chunk;
+        const size_t threads = details::parallel_threads(options, chunks);
+        const size_t window = options.window ? options.window : threads * 4;
+
+        // 块 c 使用槽位 c % window; 槽位在块 c - window 输出之后才能复用
+        std::vector<std::string> buffers(window);
+        std::vector<char> ready(window, 0);
+        std::mutex mutex;
+        std::condition_variable slot_freed;
+        size_t flushed = 0;
+        bool flushing = false;
+        details::parallel_error<> error;
+
+        details::parallel_chunks(threads, chunks, [&](size_t chunk) {
+            const size_t slot = chunk % window;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slot_freed.wait(lock, [&] { return chunk < flushed + window || error.chunk <= chunk; });
+                if (error.chunk <= chunk) return false;
+            }
+
+            std::string &buffer = buffers[slot];
+            buffer.clear();
+            details::string_sink<std::string> sink{buffer};
+            const size_t begin = chunk * per_chunk;
+            const size_t end = begin + per_chunk < count ? begin + per_chunk : count;
+            bool failed = false;
+            format_error_info failure;
+            for (size_t i = begin; i < end; ++i) {
+                auto formatted = details::format_record(sink, tpl, first[i]);
+                if (STRINGFLOW_UNLIKELY(formatted.is_err())) {
+                    failed = true;
+                    failure = formatted.unwrap_err();
+                    break;
+                }
+                buffer.push_back('\n');
+            }
+
+            // 按顺序输出已完成的块; 同一时刻只有一个线程负责输出, 其余线程标记完成后继续领取
+            std::unique_lock<std::mutex> lock(mutex);
+            if (STRINGFLOW_UNLIKELY(failed)) error.record(chunk, failure);
+            ready[slot] = 1;
+            if (flushing) return error.chunk > chunk;
+            flushing = true;
+            while (flushed < chunks && ready[flushed % window] && flushed < error.chunk) {
+                const std::string &done = buffers[flushed % window];
+                lock.unlock();
+                details::write_span(out_fct_wrap, done.data(), done.size());
+                lock.lock();
+                ready[flushed % window] = 0;
+                ++flushed;
+                slot_freed.notify_all();
+            }
+            flushing = false;
+            slot_freed.notify_all();
+            return error.chunk > chunk;
+        });
+
+        if (error.chunk != static_cast<size_t>(-1)) return Err(*error.error);
+        return Ok(count);
+    }
+
+    /**
+     * @brief 两遍并行格式化到一块连续内存: 先求各块长度与偏移, 再由 allocate(total) 给出目标区域并直接写入
+     *
+     * @param allocate char *(size_t total), 返回 nullptr 时放弃写入并返回 buffer_full
+     * @return 写入的总字节数
+     */
+    template <class Range, class Allocate>
+    Result<size_t, format_error_info> parallel_format_lines_into(const Range &records, const char *format, Allocate &&allocate,
+                                                                 const parallel_options &options = {}) {
+        static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                        typename std::iterator_traits<decltype(std::begin(records))>::iterator_category>,
+                      "parallel_format_lines_into requires a random access range");
+        auto compiled = compiled_format::compile(format);
+        if (compiled.is_err()) return Err(compiled.unwrap_err());
+        const compiled_format &tpl = compiled.unwrap();
+
+        const auto first = std::begin(records);
+        const size_t count = static_cast<size_t>(std::size(records));
+        const size_t per_chunk = options.chunk_records ? options.chunk_records : 4096;
+        const size_t chunks = (count + per_chunk - 1) / per_chunk;
+        const size_t threads = details::parallel_threads(options, chunks);
+        details::parallel_error<> error;
+
+        auto chunk_range = [&](size_t chunk) {
+            const size_t begin = chunk * per_chunk;
+            return std::make_pair(begin, begin + per_chunk < count ? begin + per_chunk : count);
+        };
+
+        // 第一遍: 每块的输出长度
+        std::vector<size_t> offsets(chunks + 1, 0);
+        details::parallel_chunks(threads, chunks, [&](size_t chunk) {
+            details::size_sink sink;
+            const auto [begin, end] = chunk_range(chunk);
+            for (size_t i = begin; i < end; ++i) {
+                auto formatted = details::format_record(sink, tpl, first[i]);
+                if (STRINGFLOW_UNLIKELY(formatted.is_err())) {
+                    error.record(chunk, formatted.unwrap_err());
+                    return false;
+                }
+                ++sink.size;
+            }
+            offsets[chunk + 1] = sink.size;
+            return true;
+        });
+        if (error.chunk != static_cast<size_t>(-1)) return Err(*error.error);
+
+        for (size_t chunk = 0; chunk < chunks; ++chunk) offsets[chunk + 1] += offsets[chunk];
+        const size_t total = offsets[chunks];
+        char *region = allocate(total);
+        if (!region && total) return Err(format_error_info(format_error::buffer_full));
+
+        // 第二遍: 各块只写入第一遍算出的区间; 两遍长度不一致(例如记录在两遍之间被修改)时返回 buffer_full
+        details::parallel_chunks(threads, chunks, [&](size_t chunk) {
+            details::pointer_sink sink{region + offsets[chunk], region + offsets[chunk + 1]};
+            const auto [begin, end] = chunk_range(chunk);
+            for (size_t i = begin; i < end; ++i) {
+                auto formatted = details::format_record(sink, tpl, first[i]);
+                if (STRINGFLOW_UNLIKELY(formatted.is_err())) {
+                    error.record(chunk, formatted.unwrap_err());
+                    return false;
+                }
+                sink('\n');
+            }
+            if (STRINGFLOW_UNLIKELY(sink.overflow || sink.pos != sink.end)) {
+                error.record(chunk, format_error_info(format_error::buffer_full));
+                return false;
+            }
+            return true;
+        });
+        if (error.chunk != static_cast<size_t>(-1)) return Err(*error.error);
+        return Ok(total);
+    }
+
+    /**
+     * @brief 并行地对每个元素调用 fn(返回 Result), 全部成功时按原顺序收集成功值
+     *
+     * @note 每块先收集到自己的 vector, 最后按块的顺序移入结果; 出错时不再领取之后的块,
+     *       返回下标最小的错误(与顺序执行 try_transform 得到的错误相同). fn 会被多个线程同时调用.
+     */
+    template <class Range, class F,
+              typename R = std::decay_t<std::invoke_result_t<const F &, decltype(*std::begin(std::declval<const Range &>()))>>>
+    Result<std::vector<typename R::value_type>, typename R::error_type> parallel_try_transform(const Range &range, const F &fn,
+                                                                                            const parallel_options &options = {}) {
+        static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                        typename std::iterator_traits<decltype(std::begin(range))>::iterator_category>,
+                      "parallel_try_transform requires a random access range");
+        using T = typename R::value_type;
+        using E = typename R::error_type;
+
+        const auto first = std::begin(range);
+        const size_t count = static_cast<size_t>(std::size(range));
+        const size_t per_chunk = options.chunk_records ? options.chunk_records : 4096;
+        const size_t chunks = (count + per_chunk - 1) / per_chunk;
+        const size_t threads = details::parallel_threads(options, chunks);
+        std::vector<std::vector<T>> parts(chunks);
+        details::parallel_error<E> error;
+
+        details::parallel_chunks(threads, chunks, [&](size_t chunk) {
+            const size_t begin = chunk * per_chunk;
+            const size_t end = begin + per_chunk < count ? begin + per_chunk : count;
+            std::vector<T> &values = parts[chunk];
+            values.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                auto converted = fn(first[i]);
+                if (STRINGFLOW_UNLIKELY(converted.is_err())) {
+                    error.record(chunk, std::move(converted).err_unchecked());
+                    return false;
+                }
+                values.push_back(std::move(converted).ok_unchecked());
+            }
+            return true;
+        });
+        if (error.chunk != static_cast<size_t>(-1)) return Err(std::move(*error.error));
+
+        std::vector<T> values;
+        values.reserve(count);
+        for (auto &part : parts) {
+            std::move(part.begin(), part.end(), std::back_inserter(values));
+            std::vector<T>().swap(part);
+        }
+        return Ok(std::move(values));
+    }
+}
+#endif //PARALLEL_HPP
@@ -0,0 +1,296 @@
+//
+// Created by ruixuezhao on 25-3-26.
+//
+
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include "format.hpp"
+
+/**
+ * @brief 有界无锁队列, 在线程间传递变长的字节记录(通常是格式化好的一行文本)
+ *
+ * @note spsc_queue 为单生产者单消费者, mpsc_queue 为多生产者单消费者. 记录在环形缓冲区中连续存放,
+ *       生产者先预留一段空间, 直接格式化进去再提交; 消费者拿到的是指向缓冲区的视图, 释放后空间才归还,
+ *       从格式化到消费没有任何拷贝:
+ *
+ *       StringFlow::mpsc_queue queue(1 << 20);
+ *       // 生产者
+ *       auto slot = queue.try_reserve(256).unwrap();               // 队列满时返回 queue_error::full
+ *       StringFlow::format_to(slot, "{} {}: {}", ts, level, msg).unwrap();
+ *       slot.commit().unwrap();                                     // 超出预留大小时丢弃并返回 too_large
+ *       // 消费者
+ *       auto record = queue.try_pop();                              // 队列空时返回 queue_error::empty
+ *       if (record.is_ok()) consume(record.unwrap().view());        // 记录析构时归还空间
+ *
+ *       每个生产者同时只能持有一个未提交的预留, 消费者同时只能持有一条记录.
+ *       单条记录最多 capacity / 2 减去 8 字节的记录头.
+ */
+namespace StringFlow {
+    enum class queue_error : uint8_t {
+        full = 1,   // 剩余空间不足; 0 留给 error_code 表示成功
+        empty,      // 没有已提交的记录
+        too_large,  // 记录超过 max_record_size() 或预留的大小
+    };
+
+    inline constexpr std::string_view queue_error_messages[] = {
+        "Success",
+        "Queue full",
+        "Queue empty",
+        "Record too large",
+    };
+
+    inline constexpr std::string_view queue_error_to_string(queue_error code) {
+        return details::error_message(queue_error_messages, static_cast<int>(code));
+    }
+
+    inline const error_category queue_category("queue", queue_error_messages);
+    inline const error_category &error_category_of(queue_error) { return queue_category; }
+
+    static constexpr size_t cache_line_size = 64;
+
+    template <bool MultiProducer>
+    class basic_record_queue {
+        // 记录头: word 为记录占用的字节数(含记录头, 8 字节对齐)与状态位, 0 表示尚未提交
+        struct header {
+            std::atomic<uint32_t> word;
+            uint32_t size;
+        };
+
+        static constexpr uint32_t ready_bit = 1;
+        static constexpr uint32_t skip_bit = 2;  // 绕回时的填充或被丢弃的预留, 消费者直接跳过
+        static constexpr uint32_t span_mask = ~uint32_t(7);
+
+    public:
+        /**
+         * @brief 生产者预留的空间, 同时也是 format_to 的输出函数
+         *
+         * @note 未提交就析构时丢弃; 写入超出预留大小的部分被截掉, commit 返回 too_large
+         */
+        class reservation {
+        public:
+            reservation(reservation &&other) noexcept
+                : m_queue(other.m_queue), m_position(other.m_position), m_end(other.m_end),
+                  m_data(other.m_data), m_capacity(other.m_capacity), m_size(other.m_size), m_overflow(other.m_overflow) {
+                other.m_queue = nullptr;
+            }
+            reservation(const reservation &) = delete;
+            reservation &operator=(const reservation &) = delete;
+            reservation &operator=(reservation &&) = delete;
+
+            ~reservation() {
+                if (m_queue) m_queue->publish(*this, skip_bit);
+            }
+
+            char *data() const { return m_data; }
+            size_t capacity() const { return m_capacity; }
+            size_t size() const { return m_size; }
+
+            void operator()(char ch) {
+                if (STRINGFLOW_LIKELY(m_size < m_capacity))
+                    m_data[m_size++] = ch;
+                else
+                    m_overflow = true;
+            }
+
+            void operator()(const char *data, size_t size) {
+                const size_t room = m_capacity - m_size;
+                if (STRINGFLOW_UNLIKELY(size > room)) {
+                    size = room;
+                    m_overflow = true;
+                }
+                memcpy(m_data + m_size, data, size);
+                m_size += size;
+            }
+
+            // 直接写入 data() 之后, 设置实际写入的字节数
+            void resize(size_t size) { m_size = size < m_capacity ? size : m_capacity; }
+
+            /**
+             * @return 记录的字节数
+             */
+            Result<size_t, queue_error> commit() {
+                basic_record_queue *queue = m_queue;
+                m_queue = nullptr;
+                if (!queue) return Err(queue_error::empty);
+                if (STRINGFLOW_UNLIKELY(m_overflow)) {
+                    queue->publish(*this, skip_bit);
+                    return Err(queue_error::too_large);
+                }
+                queue->publish(*this, 0);
+                return Ok(m_size);
+            }
+
+        private:
+            friend class basic_record_queue;
+
+            reservation(basic_record_queue *queue, uint64_t position, uint64_t end, char *data, size_t capacity)
+                : m_queue(queue), m_position(position), m_end(end), m_data(data), m_capacity(capacity) {}
+
+            basic_record_queue *m_queue;
+            uint64_t m_position;  // 记录头的位置
+            uint64_t m_end;       // 记录结束的位置
+            char *m_data;
+            size_t m_capacity;
+            size_t m_size = 0;
+            bool m_overflow = false;
+        };
+
+        /**
+         * @brief 消费者取得的记录, 指向队列内部的缓冲区, 析构(或 release)后空间归还给生产者
+         */
+        class record {
+        public:
+            record(record &&other) noexcept
+                : m_queue(other.m_queue), m_end(other.m_end), m_data(other.m_data), m_size(other.m_size) {
+                other.m_queue = nullptr;
+            }
+            record(const record &) = delete;
+            record &operator=(const record &) = delete;
+            record &operator=(record &&) = delete;
+
+            ~record() { release(); }
+
+            const char *data() const { return m_data; }
+            size_t size() const { return m_size; }
+            std::string_view view() const { return {m_data, m_size}; }
+
+            void release() {
+                if (m_queue) m_queue->advance_head(m_end);
+                m_queue = nullptr;
+            }
+
+        private:
+            friend class basic_record_queue;
+
+            record(basic_record_queue *queue, uint64_t end, const char *data, size_t size)
+                : m_queue(queue), m_end(end), m_data(data), m_size(size) {}
+
+            basic_record_queue *m_queue;
+            uint64_t m_end;
+            const char *m_data;
+            size_t m_size;
+        };
+
+        /**
+         * @param capacity 缓冲区字节数, 向上取整为 2 的幂, 至少 64
+         */
+        explicit basic_record_queue(size_t capacity) {
+            size_t rounded = 64;
+            while (rounded < capacity && rounded < (size_t(1) << 31)) rounded <<= 1;
+            m_capacity = rounded;
+            m_mask = rounded - 1;
+            m_buffer.reset(new header[rounded / sizeof(header)]);
+            memset(static_cast<void *>(m_buffer.get()), 0, rounded);
+        }
+
+        basic_record_queue(const basic_record_queue &) = delete;
+        basic_record_queue &operator=(const basic_record_queue &) = delete;
+
+        size_t capacity() const { return m_capacity; }
+        size_t max_record_size() const { return m_capacity / 2 - sizeof(header); }
+
+        /**
+         * @brief 预留最多 size 字节的连续空间
+         */
+        Result<reservation, queue_error> try_reserve(size_t size) {
+            if (STRINGFLOW_UNLIKELY(size > max_record_size())) return Err(queue_error::too_large);
+            const uint64_t span = sizeof(header) + ((size + 7) & ~size_t(7));
+
+            uint64_t position = m_tail.load(std::memory_order_relaxed);
+            uint64_t need, offset;
+            for (;;) {
+                offset = position & m_mask;
+                // 记录必须连续, 放不下时先用一段填充补齐到缓冲区末尾
+                need = offset + span > m_capacity ? m_capacity - offset + span : span;
+                if constexpr (!MultiProducer) {
+                    if (position + need - m_cached_head > m_capacity) {
+                        m_cached_head = m_head.load(std::memory_order_acquire);
+                        if (position + need - m_cached_head > m_capacity) return Err(queue_error::full);
+                    }
+                    break;
+                } else {
+                    if (position + need - m_head.load(std::memory_order_acquire) > m_capacity) return Err(queue_error::full);
+                    if (m_tail.compare_exchange_weak(position, position + need, std::memory_order_relaxed)) break;
+                }
+            }
+
+            if (need != span) {
+                // 填充立即可见; 单生产者时随提交一起发布
+                at(offset).word.store(static_cast<uint32_t>(m_capacity - offset) | skip_bit | ready_bit,
+                                      std::memory_order_release);
+                position += need - span;
+            }
+            return Ok(reservation(this, position, position + span, reinterpret_cast<char *>(&at(position & m_mask) + 1),
+                                  span - sizeof(header)));
+        }
+
+        /**
+         * @brief 拷贝一段已有的数据作为一条记录
+         */
+        Result<size_t, queue_error> try_push(const void *data, size_t size) {
+            auto reserved = try_reserve(size);
+            if (STRINGFLOW_UNLIKELY(reserved.is_err())) return Err(reserved.unwrap_err());
+            reservation slot = reserved.unwrap();
+            slot(static_cast<const char *>(data), size);
+            return slot.commit();
+        }
+
+        /**
+         * @brief 取出最早提交的记录; 多生产者时, 更早预留但尚未提交的记录会挡住之后的记录
+         */
+        Result<record, queue_error> try_pop() {
+            for (;;) {
+                const uint64_t position = m_head.load(std::memory_order_relaxed);
+                if (position == m_cached_tail) {
+                    m_cached_tail = m_tail.load(std::memory_order_acquire);
+                    if (position == m_cached_tail) return Err(queue_error::empty);
+                }
+                header &head = at(position & m_mask);
+                const uint32_t word = head.word.load(std::memory_order_acquire);
+                if (!(word & ready_bit)) return Err(queue_error::empty);
+
+                const uint64_t end = position + (word & span_mask);
+                if (word & skip_bit) {
+                    advance_head(end);
+                    continue;
+                }
+                return Ok(record(this, end, reinterpret_cast<const char *>(&head + 1), head.size));
+            }
+        }
+
+    private:
+        header &at(uint64_t offset) { return m_buffer[offset / sizeof(header)]; }
+
+        void publish(reservation &slot, uint32_t flags) {
+            header &head = at(slot.m_position & m_mask);
+            head.size = static_cast<uint32_t>(slot.m_size);
+            head.word.store(static_cast<uint32_t>(slot.m_end - slot.m_position) | flags | ready_bit,
+                            std::memory_order_release);
+            if constexpr (!MultiProducer) m_tail.store(slot.m_end, std::memory_order_release);
+        }
+
+        void advance_head(uint64_t end) {
+            const uint64_t position = m_head.load(std::memory_order_relaxed);
+            // 多生产者时记录头的位置不固定, 归还的空间清零, 之后预留到这里的记录在提交前读到的都是 0
+            if constexpr (MultiProducer) memset(static_cast<void *>(&at(position & m_mask)), 0, end - position);
+            m_head.store(end, std::memory_order_release);
+        }
+
+        // 生产者与消费者各自修改的字段分处不同的缓存行
+        alignas(cache_line_size) std::atomic<uint64_t> m_tail{0};
+        uint64_t m_cached_head = 0;  // 单生产者时生产者看到的 m_head
+        alignas(cache_line_size) std::atomic<uint64_t> m_head{0};
+        uint64_t m_cached_tail = 0;  // 消费者看到的 m_tail
+        alignas(cache_line_size) std::unique_ptr<header[]> m_buffer;
+        size_t m_capacity = 0;
+        size_t m_mask = 0;
+    };
+
+    using spsc_queue = basic_record_queue<false>;
+    using mpsc_queue = basic_record_queue<true>;
+}
+#endif //QUEUE_HPP
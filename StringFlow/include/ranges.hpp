@@ -0,0 +1,333 @@
+//
+// Created by ruixuezhao on 25-3-16.
+//
+
+#ifndef RANGES_HPP
+#define RANGES_HPP
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include "format.hpp"
+
+/**
+ * @brief 容器、pair/tuple 与 optional 的格式化
+ *
+ * @note 格式为 {[index][:[n][:element_spec]]}
+ *       n            去掉外层括号
+ *       element_spec 作用于每个元素的格式说明, 例如 {::x} 以十六进制输出每个元素, {:n:>4} 去掉括号并右对齐
+ *
+ *       序列容器输出为 [a, b], 集合为 {a, b}, 映射为 {k: v}, pair/tuple 为 (a, b),
+ *       optional 为 optional(v) 或 none. 自定义分隔符使用 join(range, sep).
+ */
+namespace StringFlow {
+    template <typename T, typename = void>
+    struct is_range : std::false_type {};
+    template <typename T>
+    struct is_range<T, std::void_t<decltype(std::begin(std::declval<const T &>())), decltype(std::end(std::declval<const T &>()))>>
+        : std::integral_constant<bool, !type_check<T>::is_string_v && !type_check<T>::is_wide_string_v && std::is_class<T>::value> {};
+
+    template <typename T, typename = void>
+    struct is_map_like : std::false_type {};
+    template <typename T>
+    struct is_map_like<T, std::void_t<typename T::key_type, typename T::mapped_type>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct is_set_like : std::false_type {};
+    template <typename T>
+    struct is_set_like<T, std::void_t<typename T::key_type>> : std::integral_constant<bool, !is_map_like<T>::value> {};
+
+    template <typename T, typename = void>
+    struct is_contiguous_range : std::false_type {};
+    template <typename T>
+    struct is_contiguous_range<T, std::void_t<decltype(std::data(std::declval<const T &>())), decltype(std::size(std::declval<const T &>()))>>
+        : std::true_type {};
+
+    template <typename T>
+    struct is_tuple_like : std::false_type {};
+    template <typename... Ts>
+    struct is_tuple_like<std::tuple<Ts...>> : std::true_type {};
+    template <typename T1, typename T2>
+    struct is_tuple_like<std::pair<T1, T2>> : std::true_type {};
+
+    namespace details {
+        /**
+         * @brief 解析容器格式说明 [n][:element_spec], 返回元素使用的 Context
+         */
+        inline Context parse_range_spec(const Context &context, bool &brackets) {
+            brackets = true;
+            Context element{context.begin, nullptr, context.end};
+            if (!context.colon) return element;
+
+            const char *iter = context.colon + 1;
+            if (iter < context.end && *iter == 'n') {
+                brackets = false;
+                ++iter;
+            }
+            if (iter < context.end && *iter == ':') element.colon = iter;
+            return element;
+        }
+
+        template <typename T>
+        inline constexpr bool is_plain_decimal_v = std::is_integral_v<T> && !type_check<T>::is_character_v &&
+                                                   !type_check<T>::is_bool_v && !type_check<T>::is_wide_character_v;
+
+        /**
+         * @brief 连续整数序列的批量输出: 未指定宽度/符号/进制/分组时, 整段转换到栈上缓冲区后按块写出
+         *
+         * @return 选项不满足批量条件时返回 false, 由调用方逐个格式化
+         */
+        template <class output_str_function_wrap, typename T>
+        bool format_integers(output_str_function_wrap &out_fct_wrap, const FormatterOption &option,
+                             const T *data, size_t size, std::string_view separator) {
+            if (option.width || option.sign != Sign::Minus || option.alternate || option.grouping ||
+                (option.type != Type::None && option.type != Type::Dec))
+                return false;
+
+            char buffer[512];
+            size_t used = 0;
+            for (size_t i = 0; i < size; ++i) {
+                // 单个 64 位整数最多 20 位加符号, 加上分隔符; 余量不足时先写出
+                if (used + 24 + separator.size() > sizeof(buffer)) {
+                    write_span(out_fct_wrap, buffer, used);
+                    used = 0;
+                }
+                if (i) {
+                    memcpy(buffer + used, separator.data(), separator.size());
+                    used += separator.size();
+                }
+                if (data[i] < 0) buffer[used++] = '-';
+                used += itoa(magnitude(data[i]), buffer + used);
+            }
+            write_span(out_fct_wrap, buffer, used);
+            return true;
+        }
+
+        template <typename T>
+        inline constexpr bool is_batch_float_v = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+        /**
+         * @brief 连续 float/double 序列的批量输出: 未指定宽度/符号/分组且为缺省或 f 格式时, 定点结果直接写入栈上缓冲区
+         *
+         * @note 结果与逐个格式化相同; inf/nan、缺省格式下需要科学计数法以及整数部分超出 uint64_t 的元素
+         *       先写出缓冲区, 再走 handle_float
+         * @return 选项不满足批量条件时返回 Ok(false), 由调用方逐个格式化
+         */
+        template <class output_str_function_wrap, typename T>
+        Result<bool,format_error> format_floats(output_str_function_wrap &out_fct_wrap, const FormatterOption &option,
+                                                const T *data, size_t size, std::string_view separator) {
+            if (option.width || option.sign != Sign::Minus || option.alternate || option.grouping ||
+                (option.type != Type::None && option.type != Type::Float))
+                return Ok(false);
+
+            FormatterOption fixed = option;
+            fixed.type = Type::Float;
+            char buffer[512];
+            size_t used = 0;
+            for (size_t i = 0; i < size; ++i) {
+                // 符号、20 位整数、小数点与最多 40 位小数, 加上分隔符; 余量不足时先写出
+                if (used + 64 + separator.size() > sizeof(buffer)) {
+                    write_span(out_fct_wrap, buffer, used);
+                    used = 0;
+                }
+                if (i) {
+                    memcpy(buffer + used, separator.data(), separator.size());
+                    used += separator.size();
+                }
+
+                const double value = data[i];
+                const double magnitude = std::fabs(value);
+                const bool in_range = magnitude == 0 || (magnitude < max_float && magnitude >= min_float);
+                if (STRINGFLOW_UNLIKELY(value != value || magnitude > DBL_MAX || magnitude >= 1e19 ||
+                                        (option.type == Type::None && !in_range))) {
+                    write_span(out_fct_wrap, buffer, used);
+                    used = 0;
+                    FormatterOption special = fixed;
+                    if (option.type == Type::None && !in_range) special.type = Type::Exp;
+                    auto formatted = handle_float(out_fct_wrap, special, data[i]);
+                    if (formatted.is_err()) return formatted;
+                    continue;
+                }
+                char *const begin = buffer + used;
+                char *pos = write_sign(begin, std::signbit(value), Sign::Minus);
+                pos = write_fixed(pos, magnitude, fixed, nullptr, false);
+                used += static_cast<size_t>(pos - begin);
+            }
+            write_span(out_fct_wrap, buffer, used);
+            return Ok(true);
+        }
+
+        template <class output_str_function_wrap, class Iterator, class ElementFormatter>
+        Result<bool,format_error> format_elements(output_str_function_wrap &out_fct_wrap, Iterator first, Iterator last,
+                                                  const ElementFormatter &element, std::string_view separator) {
+            for (bool leading = true; first != last; ++first, leading = false) {
+                if (!leading) write_span(out_fct_wrap, separator.data(), separator.size());
+                auto formatted = element.format(*first, out_fct_wrap);
+                if (formatted.is_err()) return formatted;
+            }
+            return Ok(true);
+        }
+    }
+
+    /**
+     * @brief 容器格式化, 元素的 formatter 只 parse 一次
+     */
+    template <typename R>
+    struct formatter<R, std::enable_if_t<is_range<R>::value>> {
+        using element_type = std::remove_cv_t<std::remove_reference_t<decltype(*std::begin(std::declval<const R &>()))>>;
+
+        bool brackets = true;
+        FormatterOption element_option;
+        details::nested_formatter<element_type> element;
+
+        void parse(const Context &context, const FormatterOption &) {
+            const Context element_context = details::parse_range_spec(context, brackets);
+            element_context.unpack_to(element_option);
+            element.parse(element_context, element_option);
+        }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const R &range, output_str_function_wrap &&out_fct_wrap) const {
+            constexpr bool braces = is_set_like<R>::value || is_map_like<R>::value;
+            if (brackets) out_fct_wrap(braces ? '{' : '[');
+
+            auto finish = [&](Result<bool,format_error> formatted) {
+                if (brackets) out_fct_wrap(braces ? '}' : ']');
+                return formatted;
+            };
+            if constexpr (is_contiguous_range<R>::value && details::is_plain_decimal_v<element_type>) {
+                if (details::format_integers(out_fct_wrap, element_option, std::data(range), std::size(range), ", "))
+                    return finish(Ok(true));
+            } else if constexpr (is_contiguous_range<R>::value && details::is_batch_float_v<element_type>) {
+                auto batched = details::format_floats(out_fct_wrap, element_option, std::data(range), std::size(range), ", ");
+                if (batched.is_err() || batched.ok_unchecked()) return finish(batched);
+            }
+            return finish(details::format_elements(out_fct_wrap, std::begin(range), std::end(range), element, ", "));
+        }
+    };
+
+    namespace details {
+        template <typename T, typename Seq = std::make_index_sequence<std::tuple_size<T>::value>>
+        struct tuple_formatters;
+        template <typename T, size_t... Is>
+        struct tuple_formatters<T, std::index_sequence<Is...>> {
+            using type = std::tuple<nested_formatter<std::remove_cv_t<std::tuple_element_t<Is, T>>>...>;
+        };
+    }
+
+    /**
+     * @brief pair 与 tuple 输出为 (a, b); 映射容器中的键值对输出为 k: v
+     */
+    template <typename T>
+    struct formatter<T, std::enable_if_t<is_tuple_like<T>::value>> {
+        bool brackets = true;
+        bool map_entry = false;  // 由映射容器设置, 以 k: v 形式输出
+        typename details::tuple_formatters<T>::type elements;
+
+        void parse(const Context &context, const FormatterOption &) {
+            const Context element_context = details::parse_range_spec(context, brackets);
+            FormatterOption element_option;
+            element_context.unpack_to(element_option);
+            std::apply([&](auto &...element) { (element.parse(element_context, element_option), ...); }, elements);
+        }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const T &value, output_str_function_wrap &&out_fct_wrap) const {
+            const bool wrap = brackets && !map_entry;
+            if (wrap) out_fct_wrap('(');
+            const format_error error = format_tuple(value, out_fct_wrap, std::make_index_sequence<std::tuple_size<T>::value>{});
+            if (wrap) out_fct_wrap(')');
+            if (error != format_error::success) return Err(error);
+            return Ok(true);
+        }
+
+    private:
+        template <class output_str_function_wrap, size_t... Is>
+        format_error format_tuple(const T &value, output_str_function_wrap &out_fct_wrap, std::index_sequence<Is...>) const {
+            const std::string_view separator = map_entry ? ": " : ", ";
+            format_error error = format_error::success;
+            auto format_element = [&](auto index) {
+                constexpr size_t I = decltype(index)::value;
+                if (error != format_error::success) return;
+                if (I) details::write_span(out_fct_wrap, separator.data(), separator.size());
+                auto formatted = std::get<I>(elements).format(std::get<I>(value), out_fct_wrap);
+                if (formatted.is_err()) error = formatted.unwrap_err();
+            };
+            (format_element(std::integral_constant<size_t, Is>{}), ...);
+            return error;
+        }
+    };
+
+    namespace details {
+        // 映射容器的元素格式化器: 以 k: v 输出键值对
+        template <typename K, typename V>
+        struct nested_formatter<std::pair<K, V>, true> {
+            formatter<std::pair<K, V>> impl;
+            bool map_entry = std::is_const<K>::value;
+
+            void parse(const Context &context, const FormatterOption &option) {
+                impl.parse(context, option);
+                impl.map_entry = map_entry;
+            }
+
+            template <class output_str_function_wrap>
+            Result<bool,format_error> format(const std::pair<K, V> &value, output_str_function_wrap &&out_fct_wrap) const {
+                return impl.format(value, out_fct_wrap);
+            }
+        };
+    }
+
+    /**
+     * @brief optional 输出为 optional(value) 或 none, 格式说明作用于其中的值
+     */
+    template <typename T>
+    struct formatter<std::optional<T>> {
+        details::nested_formatter<T> value_formatter;
+
+        void parse(const Context &context, const FormatterOption &option) { value_formatter.parse(context, option); }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const std::optional<T> &value, output_str_function_wrap &&out_fct_wrap) const {
+            if (!value) {
+                details::write_span(out_fct_wrap, "none", 4);
+                return Ok(true);
+            }
+            details::write_span(out_fct_wrap, "optional(", 9);
+            auto formatted = value_formatter.format(*value, out_fct_wrap);
+            out_fct_wrap(')');
+            return formatted;
+        }
+    };
+
+    /**
+     * @brief 以自定义分隔符连接元素, 不输出括号, 整个格式说明作用于每个元素
+     *
+     * @note StringFlow::println("{:x}", StringFlow::join(bytes, " ")).unwrap();
+     */
+    template <class Iterator>
+    struct join_view {
+        Iterator first;
+        Iterator last;
+        std::string_view separator;
+    };
+
+    template <class Range>
+    auto join(const Range &range, std::string_view separator) {
+        return join_view<decltype(std::begin(range))>{std::begin(range), std::end(range), separator};
+    }
+
+    template <class Iterator>
+    struct formatter<join_view<Iterator>> {
+        using element_type = std::remove_cv_t<std::remove_reference_t<decltype(*std::declval<Iterator>())>>;
+        details::nested_formatter<element_type> element;
+
+        void parse(const Context &context, const FormatterOption &option) { element.parse(context, option); }
+
+        template <class output_str_function_wrap>
+        Result<bool,format_error> format(const join_view<Iterator> &view, output_str_function_wrap &&out_fct_wrap) const {
+            return details::format_elements(out_fct_wrap, view.first, view.last, element, view.separator);
+        }
+    };
+}
+#endif //RANGES_HPP
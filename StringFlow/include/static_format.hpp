@@ -0,0 +1,267 @@
+//
+// Created by ruixuezhao on 25-3-12.
+//
+
+#ifndef STATIC_FORMAT_HPP
+#define STATIC_FORMAT_HPP
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include "utils.hpp"
+#include "itoa.hpp"
+#include "type_traits.hpp"
+#include "named_args.hpp"
+
+/**
+ * @brief 编译期格式化
+ *
+ * @note 参数全部为常量表达式时, 在编译期把格式化结果写入定长的 std::array<char, N>,
+ *       运行期不再有任何格式化开销. 支持字符、布尔、整数(b/o/d/x/X)、C字符串与 std::string_view,
+ *       具名参数 arg("name", value), 以及 fill/align/sign/#/0/width/.precision(仅截断字符串).
+ *       浮点数不支持编译期格式化.
+ *
+ *       C++17:  constexpr auto s = STRINGFLOW_STATIC_FORMAT("v{}.{}.{}", 1, 2, 3);
+ *       C++20:  constexpr auto s = StringFlow::static_format<"v{}.{}.{}", 1, 2, 3>();
+ *       任意标准: constexpr auto s = StringFlow::static_format<32>("v{}.{}.{}", 1, 2, 3);
+ */
+namespace StringFlow {
+    namespace details {
+        // 编译期格式化失败时调用: 非 constexpr 函数出现在常量求值中会直接导致编译错误
+        inline void static_format_error(const char *) {}
+
+        // 只统计长度的输出端, 用于计算结果数组的大小
+        struct static_count_sink {
+            size_t size = 0;
+            constexpr void operator()(char) { ++size; }
+        };
+
+        // 写入定长数组的输出端, 超出容量的部分被丢弃(始终保留结尾的 '\0')
+        template <size_t N>
+        struct static_array_sink {
+            std::array<char, N> &buffer;
+            size_t size = 0;
+            constexpr void operator()(char ch) {
+                if (size + 1 < N) buffer[size++] = ch;
+            }
+        };
+
+        // prefix 为符号与进制前缀的长度, '=' 对齐时填充写在前缀之后
+        template <class Sink>
+        constexpr void static_write_rev(Sink &sink, const FormatterOption &option, const char *data, size_t length, size_t prefix = 0) {
+            size_t left_pad = 0, right_pad = 0, inner_pad = 0;
+            const size_t width = option.width ? utf8_display_width(data, length) : 0;
+            if (option.width > width) {
+                const size_t padding = option.width - width;
+                switch (option.align) {
+                    case Align::Left:   right_pad = padding; break;
+                    case Align::Center: left_pad = padding / 2; right_pad = padding - left_pad; break;
+                    case Align::Right:  left_pad = padding; break;
+                    case Align::Numeric: inner_pad = padding; break;
+                }
+            }
+            // 宽填充字符无法整除时, 剩余的列用空格补齐
+            auto write_fill = [&](size_t count) {
+                for (size_t i = 0; i < count / option.fill.width; ++i)
+                    for (size_t j = 0; j < option.fill.size; ++j) sink(option.fill.data[j]);
+                for (size_t i = 0; i < count % option.fill.width; ++i) sink(' ');
+            };
+            write_fill(left_pad);
+            for (size_t i = 0; i < prefix; ++i) sink(data[i]);
+            write_fill(inner_pad);
+            for (size_t i = prefix; i < length; ++i) sink(data[i]);
+            write_fill(right_pad);
+        }
+
+        template <class Sink, typename Arg>
+        constexpr bool static_format_value(Sink &sink, FormatterOption option, const Arg &arg) {
+            using T = std::remove_cv_t<std::remove_reference_t<Arg>>;
+
+            if constexpr (is_named_arg_v<T>) {
+                return static_format_value(sink, option, arg.value);
+            } else if constexpr (type_check<T>::is_bool_v) {
+                if (option.type != Type::None && option.type != Type::Bol) return false;
+                static_write_rev(sink, option, arg ? "true" : "false", arg ? 4 : 5);
+                return true;
+            } else if constexpr (type_check<T>::is_character_v) {
+                if (option.type == Type::None || option.type == Type::Chr) {
+                    const char ch = static_cast<char>(arg);
+                    static_write_rev(sink, option, &ch, 1);
+                    return true;
+                }
+                return static_format_value(sink, option, static_cast<int>(arg));
+            } else if constexpr (std::is_integral_v<T>) {
+                size_t radix = 0;
+                IotaCase itoa_case = IotaCase::Lower;
+                switch (option.type) {
+                    case Type::Bin:  radix = 2;  break;
+                    case Type::Oct:  radix = 8;  break;
+                    case Type::None:
+                    case Type::Dec:  radix = 10; break;
+                    case Type::hex:  radix = 16; break;
+                    case Type::Hex:  radix = 16; itoa_case = IotaCase::Upper; break;
+                    default:         return false;
+                }
+                char temp[66] = {};
+                size_t length = 0;
+                if (arg < 0) {
+                    temp[length++] = '-';
+                } else if (option.sign == Sign::Plus) {
+                    temp[length++] = '+';
+                } else if (option.sign == Sign::Space) {
+                    temp[length++] = ' ';
+                }
+                if (option.alternate && radix != 10) {
+                    temp[length++] = '0';
+                    temp[length++] = radix == 2 ? 'b' : radix == 8 ? 'o' : (itoa_case == IotaCase::Upper ? 'X' : 'x');
+                }
+                const size_t prefix = length;
+                // 先转为无符号数再取绝对值, 避免最小负数取反溢出
+                using U = std::make_unsigned_t<T>;
+                const U magnitude = arg < 0 ? static_cast<U>(U(0) - static_cast<U>(arg)) : static_cast<U>(arg);
+                length += itoa(magnitude, temp + length, radix, itoa_case);
+                static_write_rev(sink, option, temp, length, prefix);
+                return true;
+            } else if constexpr (type_check<T>::is_cstring_v || std::is_same_v<T, std::string_view>) {
+                if (option.type != Type::None) return false;
+                const std::string_view str(arg);
+                const size_t length = option.auto_precision ? str.size()
+                                                             : std::min<size_t>(str.size(), option.precision);
+                static_write_rev(sink, option, str.data(), length);
+                return true;
+            } else {
+                // 浮点数、指针与类类型没有编译期实现
+                return false;
+            }
+        }
+
+        template <size_t Index, class Sink>
+        constexpr bool static_formatter_to(size_t, Sink &, const FormatterOption &) { return false; }
+
+        template <size_t Index, class Sink, typename Arg, typename... Args>
+        constexpr bool static_formatter_to(size_t index, Sink &sink, const FormatterOption &option, const Arg &arg, const Args &...args) {
+            if (Index != index)
+                return static_formatter_to<Index + 1>(index, sink, option, args...);
+            return static_format_value(sink, option, arg);
+        }
+
+        /**
+         * @brief format_to 的编译期版本, 语法与 format_to 一致, "{{" 与 "}}" 输出单个花括号
+         *
+         * @return 成功返回 true; 格式串错误、下标越界或类型不支持时返回 false
+         */
+        template <class Sink, typename... Args>
+        constexpr bool static_format_to(Sink &sink, const char *format, const Args &...args) {
+            if (!format) return false;
+            size_t auto_index = 0;
+
+            for (; *format; ++format) {
+                if (*format == '}') {
+                    if (format[1] != '}') return false;
+                    sink('}');
+                    ++format;
+                    continue;
+                }
+                if (*format != '{') {
+                    sink(*format);
+                    continue;
+                }
+                if (format[1] == '{') {
+                    sink('{');
+                    ++format;
+                    continue;
+                }
+
+                Context context{format, nullptr, nullptr};
+                const char *iter = format + 1;
+                size_t arg_index = 0;
+                bool has_index = false;
+                while (is_digit(*iter)) {
+                    arg_index = arg_index * 10 + (*iter++ - '0');
+                    has_index = true;
+                }
+                if (!has_index && is_name_start(*iter)) {
+                    // 具名字段在编译期解析为参数下标
+                    const char *name = iter;
+                    while (is_name_char(*iter)) ++iter;
+                    arg_index = find_named_arg<0>(name, iter - name, args...);
+                } else if (!has_index) {
+                    arg_index = auto_index++;
+                }
+                while (*iter && *iter != '}' && *iter != '{') {
+                    if (*iter == ':' && !context.colon) context.colon = iter;
+                    ++iter;
+                }
+                if (*iter != '}') return false;
+                context.end = iter;
+
+                FormatterOption option;
+                if (context.colon) context.unpack_to(option);
+                if (arg_index >= sizeof...(Args)) return false;
+                if (!static_formatter_to<0>(arg_index, sink, option, args...)) return false;
+                format = iter;
+            }
+            return true;
+        }
+    } // namespace details
+
+    /**
+     * @brief 编译期计算格式化结果的长度(不含结尾 '\0')
+     */
+    template <typename... Args>
+    constexpr size_t static_formatted_size(const char *format, const Args &...args) {
+        details::static_count_sink sink;
+        if (!details::static_format_to(sink, format, args...))
+            details::static_format_error("invalid static format");
+        return sink.size;
+    }
+
+    /**
+     * @brief 格式化到定长数组, 结果以 '\0' 结尾, 超出 N - 1 的部分被截断
+     *
+     * @tparam N 数组长度(包含结尾 '\0')
+     */
+    template <size_t N, typename... Args>
+    constexpr std::array<char, N> static_format(const char *format, const Args &...args) {
+        static_assert(N > 0, "static_format requires room for the terminating '\\0'");
+        std::array<char, N> buffer{};
+        details::static_array_sink<N> sink{buffer};
+        if (!details::static_format_to(sink, format, args...))
+            details::static_format_error("invalid static format");
+        return buffer;
+    }
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief 可作为非类型模板参数的格式字符串字面量(C++20)
+     */
+    template <size_t N>
+    struct format_literal {
+        char value[N]{};
+        constexpr format_literal(const char (&str)[N]) {
+            for (size_t i = 0; i < N; ++i) value[i] = str[i];
+        }
+    };
+
+    /**
+     * @brief 格式串与参数均作为模板参数, 结果数组大小恰好为格式化长度 + 1
+     */
+    template <format_literal Format, auto... Args>
+    consteval auto static_format() {
+        constexpr size_t size = static_formatted_size(Format.value, Args...);
+        return static_format<size + 1>(Format.value, Args...);
+    }
+#endif
+}
+
+/**
+ * @brief C++17 下生成恰好大小的编译期格式化结果, 参数必须为常量表达式
+ */
+#define STRINGFLOW_STATIC_FORMAT(format, ...)                                                       \
+    ([] {                                                                                           \
+        constexpr size_t stringflow_static_size_ =                                                  \
+            ::StringFlow::static_formatted_size(format, ##__VA_ARGS__);                             \
+        return ::StringFlow::static_format<stringflow_static_size_ + 1>(format, ##__VA_ARGS__);     \
+    }())
+
+#endif //STATIC_FORMAT_HPP
@@ -5,6 +5,8 @@
 #ifndef TYPE_TRAITS_HPP
 #define TYPE_TRAITS_HPP
 
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include "utils.hpp"
 namespace StringFlow
@@ -59,7 +61,7 @@ namespace StringFlow
     struct is_reference_of_array<_Tp&&> : public std::is_array<_Tp> {};
 
     template <typename _Tp>
-    struct is_character : public std::integral_constant<bool, (std::is_integral<_Tp>::value && sizeof(_Tp) == 1 && !std::is_same<_Tp, bool>::value && !std::is_same<_Tp, const bool>::value)> {};
+    struct is_character : public std::integral_constant<bool, (std::is_integral<_Tp>::value && sizeof(std::conditional_t<std::is_integral<_Tp>::value, _Tp, int>) == 1 && !std::is_same<_Tp, bool>::value && !std::is_same<_Tp, const bool>::value)> {};
     template <>
     struct is_character<void> : public std::false_type {};
 
@@ -93,6 +95,10 @@ namespace StringFlow
     template <typename _Tp>
     struct is_cstring<_Tp*&&> : public is_character<_Tp> {};
     template <typename _Tp>
+    struct is_cstring<_Tp* const> : public is_character<_Tp> {};
+    template <typename _Tp>
+    struct is_cstring<_Tp* const&> : public is_character<_Tp> {};
+    template <typename _Tp>
     struct is_cstring<_Tp(&)[]> : public is_character<_Tp> {};
     template <typename _Tp>
     struct is_cstring<_Tp(&&)[]> : public is_character<_Tp> {};
@@ -101,9 +107,43 @@ namespace StringFlow
     template <typename _Tp, size_t _Np>
     struct is_cstring<_Tp(&&)[_Np]> : public is_character<_Tp> {};
 
+    template <typename _Tp>
+    struct is_wide_character : public std::integral_constant<bool, (std::is_same<std::remove_cv_t<_Tp>, wchar_t>::value || std::is_same<std::remove_cv_t<_Tp>, char16_t>::value || std::is_same<std::remove_cv_t<_Tp>, char32_t>::value)> {};
+
+    template <typename _Tp, typename _Dp = std::decay_t<_Tp>>
+    struct is_wide_cstring : public std::integral_constant<bool, (std::is_pointer<_Dp>::value && is_wide_character<std::remove_pointer_t<_Dp>>::value)> {};
+
+    // std::basic_string 与 std::basic_string_view, 字符类型由 char_type 给出
+    template <typename _Tp>
+    struct is_string_class : public std::false_type {};
+    template <typename _Ch, typename _Tr, typename _Al>
+    struct is_string_class<std::basic_string<_Ch, _Tr, _Al>> : public std::true_type { using char_type = _Ch; };
+    template <typename _Ch, typename _Tr>
+    struct is_string_class<std::basic_string_view<_Ch, _Tr>> : public std::true_type { using char_type = _Ch; };
+
+    template <typename _Tp, typename = void>
+    struct string_char_type { using type = void; };
+    template <typename _Tp>
+    struct string_char_type<_Tp, std::enable_if_t<is_string_class<std::remove_cv_t<std::remove_reference_t<_Tp>>>::value>>
+    {
+        using type = typename is_string_class<std::remove_cv_t<std::remove_reference_t<_Tp>>>::char_type;
+    };
+
     template <typename _Tp>
     struct type_check
     {
+        static constexpr bool is_string_v =
+            std::is_same<typename string_char_type<_Tp>::type, char>::value;
+
+        static constexpr bool is_wide_string_v =
+            is_wide_character<typename string_char_type<_Tp>::type>::value;
+
+        static constexpr bool is_wide_character_v =
+            is_wide_character<std::remove_reference_t<_Tp>>::value;
+
+        static constexpr bool is_wide_cstring_v =
+            is_wide_cstring<_Tp>::value;
+
         static constexpr bool is_character_v =
             is_character<_Tp>::value || is_reference_of_character<_Tp>::value;
 
@@ -126,10 +166,15 @@ namespace StringFlow
 
         static constexpr bool is_pointer_v =
             (std::is_pointer<_Tp>::value || is_reference_of_pointer<_Tp>::value ||
-            std::is_array<_Tp>::value || is_reference_of_array<_Tp>::value);
+            std::is_array<_Tp>::value || is_reference_of_array<_Tp>::value ||
+            std::is_null_pointer<std::remove_cv_t<std::remove_reference_t<_Tp>>>::value);
+
+        static constexpr bool is_enum_v =
+            std::is_enum<std::remove_cv_t<std::remove_reference_t<_Tp>>>::value;
 
         static constexpr bool is_class_v =
-            !(is_character_v || is_bool_v || is_signed_int_v || is_unsigned_int_v || is_floating_point_v || is_cstring_v || is_pointer_v);
+            !(is_enum_v || is_character_v || is_bool_v || is_signed_int_v || is_unsigned_int_v || is_floating_point_v || is_cstring_v || is_pointer_v ||
+              is_wide_character_v || is_wide_cstring_v || is_string_v || is_wide_string_v);
     };
 
     template <typename>
@@ -138,5 +183,11 @@ namespace StringFlow
     struct has_out_class_function : public std::false_type {};
     template <typename T, typename Arg>
     struct has_out_class_function<T, Arg, void_t<decltype(std::declval<T>()(std::declval<Context>(), std::declval<Arg>()))>> : public std::true_type {};
+
+    // 输出函数可以一次接收一段已知长度的文本: out(const char *data, size_t size)
+    template <typename T, typename V = void>
+    struct has_write_span : public std::false_type {};
+    template <typename T>
+    struct has_write_span<T, void_t<decltype(std::declval<T&>()(std::declval<const char *>(), std::declval<size_t>()))>> : public std::true_type {};
 } // namespace fmt
 #endif //TYPE_TRAITS_HPP
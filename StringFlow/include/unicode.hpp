@@ -0,0 +1,211 @@
+//
+// Created by ruixuezhao on 25-3-14.
+//
+
+#ifndef UNICODE_HPP
+#define UNICODE_HPP
+#include <cstring>
+#include "stdint.h"
+
+/**
+ * @brief UTF-8 编解码与显示宽度
+ *
+ * @note 对齐填充按终端显示宽度计算: 东亚宽字符(中日韩文字、全角符号、大部分 emoji)占 2 列,
+ *       组合附加符号与零宽字符占 0 列, 其余占 1 列. 纯 ASCII 文本走快速路径, 不查表.
+ */
+namespace StringFlow {
+    struct CodepointRange {
+        char32_t first;
+        char32_t last;
+    };
+
+    // 东亚宽度为 W/F 的码点区间(按 Unicode EastAsianWidth.txt 合并压缩)
+    static constexpr CodepointRange wide_ranges[] = {
+        {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},   {0x23E9, 0x23EC},
+        {0x23F0, 0x23F0},   {0x23F3, 0x23F3},   {0x25FD, 0x25FE},   {0x2614, 0x2615},
+        {0x2648, 0x2653},   {0x267F, 0x267F},   {0x2693, 0x2693},   {0x26A1, 0x26A1},
+        {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},   {0x26CE, 0x26CE},
+        {0x26D4, 0x26D4},   {0x26EA, 0x26EA},   {0x26F2, 0x26F3},   {0x26F5, 0x26F5},
+        {0x26FA, 0x26FA},   {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},
+        {0x2728, 0x2728},   {0x274C, 0x274C},   {0x274E, 0x274E},   {0x2753, 0x2755},
+        {0x2757, 0x2757},   {0x2795, 0x2797},   {0x27B0, 0x27B0},   {0x27BF, 0x27BF},
+        {0x2B1B, 0x2B1C},   {0x2B50, 0x2B50},   {0x2B55, 0x2B55},   {0x2E80, 0x303E},
+        {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+        {0xA960, 0xA97F},   {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE10, 0xFE19},
+        {0xFE30, 0xFE6F},   {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4},
+        {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+        {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251}, {0x1F300, 0x1F3FA},
+        {0x1F400, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF},
+        {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+    };
+
+    // 零宽码点区间: 组合附加符号、零宽空格/连接符、变体选择符、肤色修饰符
+    static constexpr CodepointRange zero_width_ranges[] = {
+        {0x0300, 0x036F},   {0x0483, 0x0489},   {0x0591, 0x05BD},   {0x0610, 0x061A},
+        {0x064B, 0x065F},   {0x0E31, 0x0E31},   {0x0E34, 0x0E3A},   {0x0E47, 0x0E4E},
+        {0x1AB0, 0x1AFF},   {0x1DC0, 0x1DFF},   {0x200B, 0x200F},   {0x20D0, 0x20FF},
+        {0x302A, 0x302D},   {0x3099, 0x309A},   {0xFE00, 0xFE0F},   {0xFE20, 0xFE2F},
+        {0xFEFF, 0xFEFF},   {0x1F3FB, 0x1F3FF}, {0xE0100, 0xE01EF},
+    };
+
+    template <size_t N>
+    static inline constexpr bool in_ranges(const CodepointRange (&ranges)[N], char32_t cp) {
+        if (cp < ranges[0].first || cp > ranges[N - 1].last) return false;
+        size_t low = 0, high = N;
+        while (low < high) {
+            const size_t mid = (low + high) / 2;
+            if (cp > ranges[mid].last)
+                low = mid + 1;
+            else if (cp < ranges[mid].first)
+                high = mid;
+            else
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 单个码点的显示宽度(0, 1 或 2)
+     */
+    static inline constexpr size_t codepoint_width(char32_t cp) {
+        if (cp < 0x300) return (cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) ? 0 : 1;
+        if (in_ranges(zero_width_ranges, cp)) return 0;
+        return in_ranges(wide_ranges, cp) ? 2 : 1;
+    }
+
+    /**
+     * @brief 由 UTF-8 首字节得到编码长度, 非法首字节按 1 处理
+     */
+    static inline constexpr size_t utf8_sequence_length(char lead) {
+        const auto byte = static_cast<uint8_t>(lead);
+        if (byte < 0xC0) return 1;
+        if (byte < 0xE0) return 2;
+        if (byte < 0xF0) return 3;
+        return byte < 0xF8 ? 4 : 1;
+    }
+
+    /**
+     * @brief 解码一个 UTF-8 码点
+     *
+     * @param consumed 实际消耗的字节数; 遇到非法或截断的序列时按单字节返回该字节
+     */
+    static inline constexpr char32_t utf8_decode(const char *data, size_t size, size_t &consumed) {
+        const auto lead = static_cast<uint8_t>(data[0]);
+        const size_t length = utf8_sequence_length(data[0]);
+        consumed = 1;
+        if (length == 1 || length > size) return lead;
+
+        char32_t cp = lead & (0x7F >> length);
+        for (size_t i = 1; i < length; ++i) {
+            const auto byte = static_cast<uint8_t>(data[i]);
+            if ((byte & 0xC0) != 0x80) return lead;
+            cp = (cp << 6) | (byte & 0x3F);
+        }
+        consumed = length;
+        return cp;
+    }
+
+    /**
+     * @brief 编码一个码点为 UTF-8, 返回写入的字节数(1~4), 非法码点编码为 U+FFFD
+     */
+    static inline constexpr size_t utf8_encode(char32_t cp, char *out) {
+        if (cp < 0x80) {
+            out[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800) {
+            out[0] = static_cast<char>(0xC0 | (cp >> 6));
+            out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+        if (cp < 0x10000) {
+            out[0] = static_cast<char>(0xE0 | (cp >> 12));
+            out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (cp >> 18));
+        out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+    /**
+     * @brief 判断一段字节是否全为 ASCII, 每次检查 8 字节
+     */
+    static inline bool is_ascii(const char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t chunk;
+            memcpy(&chunk, data + i, sizeof(chunk));
+            if (chunk & 0x8080808080808080ULL) return false;
+        }
+        for (; i < size; ++i)
+            if (static_cast<uint8_t>(data[i]) & 0x80) return false;
+        return true;
+    }
+
+    /**
+     * @brief UTF-8 文本的显示宽度(逐码点查表, 可在编译期使用)
+     */
+    static inline constexpr size_t utf8_display_width(const char *data, size_t size) {
+        size_t width = 0;
+        for (size_t i = 0; i < size;) {
+            if (!(static_cast<uint8_t>(data[i]) & 0x80)) {
+                ++width;
+                ++i;
+                continue;
+            }
+            size_t consumed = 1;
+            width += codepoint_width(utf8_decode(data + i, size - i, consumed));
+            i += consumed;
+        }
+        return width;
+    }
+
+    /**
+     * @brief UTF-8 文本的显示宽度, 纯 ASCII 时直接返回字节数
+     */
+    static inline size_t display_width(const char *data, size_t size) {
+        return is_ascii(data, size) ? size : utf8_display_width(data, size);
+    }
+
+    /**
+     * @brief 从宽字符串(UTF-16 或 UTF-32, 由字符大小决定)中取出一个码点
+     *
+     * @param consumed 消耗的代码单元数, 不成对的代理项按 U+FFFD 处理
+     */
+    template <typename CharT>
+    static inline constexpr char32_t wide_decode(const CharT *data, size_t size, size_t &consumed) {
+        consumed = 1;
+        const auto unit = static_cast<char32_t>(data[0]);
+        if constexpr (sizeof(CharT) == 2) {
+            if (unit >= 0xD800 && unit <= 0xDBFF) {
+                if (size > 1 && data[1] >= 0xDC00 && data[1] <= 0xDFFF) {
+                    consumed = 2;
+                    return 0x10000 + ((unit - 0xD800) << 10) + (static_cast<char32_t>(data[1]) - 0xDC00);
+                }
+                return 0xFFFD;
+            }
+            if (unit >= 0xDC00 && unit <= 0xDFFF) return 0xFFFD;
+        }
+        return unit;
+    }
+
+    /**
+     * @brief 宽字符串的显示宽度
+     */
+    template <typename CharT>
+    static inline size_t wide_display_width(const CharT *data, size_t size) {
+        size_t width = 0;
+        for (size_t i = 0; i < size;) {
+            size_t consumed = 1;
+            width += codepoint_width(wide_decode(data + i, size - i, consumed));
+            i += consumed;
+        }
+        return width;
+    }
+}
+#endif //UNICODE_HPP
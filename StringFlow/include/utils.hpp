@@ -5,6 +5,48 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 #include "stdint.h"
+#include "unicode.hpp"
+
+// 分支预测提示: 错误检查等很少成立的条件用 STRINGFLOW_UNLIKELY 标注, 让成功路径保持顺序执行
+#if defined(__GNUC__) || defined(__clang__)
+#define STRINGFLOW_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define STRINGFLOW_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define STRINGFLOW_LIKELY(condition) (condition)
+#define STRINGFLOW_UNLIKELY(condition) (condition)
+#endif
+
+// 只在出错时执行的函数: 不内联, 放入冷代码段(.text.unlikely), 调用处的分支也按不成立预测.
+// 定义 STRINGFLOW_NO_COLD 可关闭, 用于对比代码体积
+#if defined(STRINGFLOW_NO_COLD)
+#define STRINGFLOW_COLD
+#elif defined(__GNUC__) || defined(__clang__)
+#define STRINGFLOW_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define STRINGFLOW_COLD __declspec(noinline)
+#else
+#define STRINGFLOW_COLD
+#endif
+
+// 链接 stringflow 库时由 CMake 定义 STRINGFLOW_COMPILED, 非模板的核心函数只在库中编译一次;
+// 直接包含头文件时这些函数以 inline 形式定义在头文件中. STRINGFLOW_SHARED 表示动态库
+#if defined(STRINGFLOW_SHARED) && defined(_WIN32)
+#if defined(STRINGFLOW_EXPORTS)
+#define STRINGFLOW_API __declspec(dllexport)
+#else
+#define STRINGFLOW_API __declspec(dllimport)
+#endif
+#elif defined(STRINGFLOW_SHARED) && (defined(__GNUC__) || defined(__clang__))
+#define STRINGFLOW_API __attribute__((visibility("default")))
+#else
+#define STRINGFLOW_API
+#endif
+
+#if defined(STRINGFLOW_COMPILED)
+#define STRINGFLOW_FUNC STRINGFLOW_API
+#else
+#define STRINGFLOW_FUNC inline
+#endif
 
 namespace StringFlow {
 
@@ -16,6 +58,7 @@ namespace StringFlow {
         Left = '<',   // 左对齐(默认)
         Center = '^', // 居中对齐
         Right = '>',  // 右对齐
+        Numeric = '=', // 数值对齐, 填充插在符号/进制前缀与数字之间(如 -000042), 仅对数值有效
     };
 
     enum class Sign : char
@@ -37,8 +80,13 @@ namespace StringFlow {
         Float = 'f',   // 普通浮点数(输入为在范围内的浮点数时为默认)
         exp = 'e',     // 科学计数法, 小写(输入为在Float范围外的浮点数时为默认)
         Exp = 'E',     // 科学计数法, 大写
+        gen = 'g',     // 通用格式, 按有效数字在定点与科学计数法之间选择, 去掉末尾的 0
+        Gen = 'G',     // 通用格式, 科学计数法时大写
+        Percent = '%', // 百分比, 乘以 100 后按定点格式输出并加 '%'
         pointer = 'p', // 指针地址, 小写, 输出格式为十六进制(输入为非单字节整型指针(数组)以外的指针(数组)时为默认)
         Pointer = 'P', // 指针地址, 大写, 输出格式为十六进制
+        Json = 'j',    // 字符串按 JSON 字符串字面量输出, 两侧加引号并转义
+        Csv = 'q',     // 字符串按 CSV 字段输出, 含 ',' '"' 或换行时加引号并重复 '"'
         None = 'n',    // 格式化字符串中缺省时为此值, 会转变为对应的默认值
     };
 
@@ -48,24 +96,50 @@ namespace StringFlow {
     static inline constexpr char upper(char ch) { return is_lower(ch) ? (ch - 'a' + 'A') : ch; }
     static inline constexpr char lower(char ch) { return is_upper(ch) ? (ch - 'A' + 'a') : ch; }
 
-    static inline constexpr bool is_align(char ch) { return ch == '<' || ch == '^' || ch == '>'; }
+    static inline constexpr bool is_align(char ch) { return ch == '<' || ch == '^' || ch == '>' || ch == '='; }
     static inline constexpr bool is_sign(char ch) { return ch == '+' || ch == '-' || ch == ' '; }
-    static inline constexpr bool is_type(char ch) { return ch == 'b' || ch == 'o' || ch == 'd' || ch == 'x' || ch == 'X' || ch == 's' || ch == 'c' || ch == 'f' || ch == 'e' || ch == 'E' || ch == 'p' || ch == 'P'; }
+    static inline constexpr bool is_type(char ch) { return ch == 'b' || ch == 'o' || ch == 'd' || ch == 'x' || ch == 'X' || ch == 's' || ch == 'c' || ch == 'f' || ch == 'e' || ch == 'E' || ch == 'g' || ch == 'G' || ch == '%' || ch == 'p' || ch == 'P' || ch == 'j' || ch == 'q'; }
+
+    /**
+     * @brief 填充字符, 可以是任意一个 UTF-8 字符(最多 4 字节), width 为其显示宽度
+     */
+    struct Fill
+    {
+        char data[4] = {' ', 0, 0, 0};
+        uint8_t size = 1;
+        uint8_t width = 1;
+
+        constexpr Fill() = default;
+        constexpr Fill(char ch) : data{ch, 0, 0, 0} {}
+        constexpr Fill(const char *bytes, size_t length)
+        {
+            size = static_cast<uint8_t>(length);
+            for (size_t i = 0; i < length; ++i) data[i] = bytes[i];
+            size_t consumed = 0;
+            width = static_cast<uint8_t>(codepoint_width(utf8_decode(bytes, length, consumed)));
+            if (width == 0) width = 1;
+        }
+    };
 
     /**
      * @brief 格式化字符串中的格式化输出信息
      *
-     * @note 格式为 {[index][:[fill][align][sign][width][.precision][type]]}
+     * @note 格式为 {[index|name][:[fill][align][sign][#][0][width][,|_][.precision][L][type]]}, width 按显示宽度计算
+     *       '#' 为整数加进制前缀(0b/0o/0x), 浮点数总是保留小数点, g 格式保留末尾的 0
+     *       '0' 在未指定对齐时等价于填充 '0' 并按 '=' 对齐, 即补零写在符号与前缀之后
+     *       ',' 与 '_' 为固定的千位分隔符, 'L' 使用当前线程的 number_facet(小数点、分隔符与分组规则)
      */
     struct FormatterOption
     {
-        char fill = ' ';           // 填充字符(仅在width大于原输出宽度时有效)
+        Fill fill = ' ';           // 填充字符(仅在width大于原输出宽度时有效)
         Align align = Align::Left; // 对齐方式(仅在width大于原输出宽度时有效)
-        Sign sign = Sign::Space;   // 符号位
-        uint8_t width;             // 输出宽度(仅在width大于原输出宽度时有效)
-        bool auto_precision;       // 自动精度(仅浮点型数据有效, 当且仅当不指定精度时为真)
-        uint8_t precision;         // 精度(仅浮点型数据且指定精度时有效)
+        Sign sign = Sign::Minus;   // 符号位
+        uint8_t width = 0;         // 输出宽度(仅在width大于原输出宽度时有效)
+        bool auto_precision = true; // 自动精度(仅浮点型数据有效, 当且仅当不指定精度时为真)
+        uint8_t precision = 6;     // 精度(仅浮点型数据且指定精度时有效)
         Type type = Type::None;    // 输出类型
+        char grouping = 0;         // 数字分组: ',' 或 '_' 为固定分隔符, 'L' 为本地化分组, 0 不分组
+        bool alternate = false;    // '#': 进制前缀, 浮点数总是保留小数点
     };
 
     /**
@@ -77,29 +151,34 @@ namespace StringFlow {
         const char *begin = nullptr; // 指向'{'
         const char *colon = nullptr; // 指向':'
         const char *end = nullptr;   // 指向'}'
-        void unpack_to(FormatterOption &option) const;
+        constexpr void unpack_to(FormatterOption &option) const;
     };
 
-    // Context 方法实现
-    inline void Context::unpack_to(FormatterOption &option) const {
-        auto iter = this->colon + 1;
-
+    // Context 方法实现, constexpr 以便编译期格式化(static_format)复用同一套解析逻辑
+    constexpr void Context::unpack_to(FormatterOption &option) const {
         // 初始化默认选项
         option = {
-            ' ', Align::Left, Sign::Space, 0, true, 6, Type::None
+            ' ', Align::Left, Sign::Minus, 0, true, 6, Type::None
         };
+        if (!this->begin || !this->colon || !this->end) return;
 
         // 边界安全检查
+        auto iter = this->colon + 1;
         const auto end_check = [&]{ return iter < this->end; };
-        if (!end_check() || !this->begin || !this->colon || !this->end) return;
+        if (!end_check()) return;
 
         // 解析对齐方式
+        bool explicit_align = true;
         auto parse_align = [&] {
-            if (iter + 1 < this->end && is_align(iter[1])) {
-                option = {iter[0], static_cast<Align>(iter[1]), option.sign};
-                iter += 2;
+            // 填充字符可以是多字节的 UTF-8 字符
+            const size_t fill_size = utf8_sequence_length(*iter);
+            if (iter + fill_size < this->end && is_align(iter[fill_size])) {
+                option = {Fill(iter, fill_size), static_cast<Align>(iter[fill_size]), option.sign};
+                iter += fill_size + 1;
             } else if (is_align(*iter)) {
                 option.align = static_cast<Align>(*iter++);
+            } else {
+                explicit_align = false;
             }
         };
         parse_align();
@@ -109,6 +188,21 @@ namespace StringFlow {
             option.sign = static_cast<Sign>(*iter++);
         }
 
+        // 解析进制前缀标识
+        if (end_check() && *iter == '#') {
+            option.alternate = true;
+            ++iter;
+        }
+
+        // 解析补零标识, 已指定对齐方式时忽略
+        if (end_check() && *iter == '0') {
+            if (!explicit_align) {
+                option.fill = '0';
+                option.align = Align::Numeric;
+            }
+            ++iter;
+        }
+
         // 解析宽度
         auto parse_number = [&](auto& val) {
             while (end_check() && is_digit(*iter)) {
@@ -117,6 +211,11 @@ namespace StringFlow {
         };
         if (end_check()) parse_number(option.width);
 
+        // 解析千位分隔符
+        if (end_check() && (*iter == ',' || *iter == '_')) {
+            option.grouping = *iter++;
+        }
+
         // 解析精度
         if (end_check() && *iter == '.') {
             option.auto_precision = false;
@@ -126,15 +225,20 @@ namespace StringFlow {
             }
         }
 
+        // 解析本地化标识
+        if (end_check() && *iter == 'L') {
+            option.grouping = *iter++;
+        }
+
         // 解析类型标识
         if (end_check()) {
             constexpr auto type_map = [](char c) {
                 switch (c) {
-                    case 'X': case 'P': case 'E': return static_cast<Type>(c);
-                    default: return static_cast<Type>(tolower(c));
+                    case 'X': case 'P': case 'E': case 'G': return static_cast<Type>(c);
+                    default: return static_cast<Type>(lower(c));
                 }
             };
-            if (is_type(*iter) || is_type(tolower(*iter))) {
+            if (is_type(*iter) || is_type(lower(*iter))) {
                 option.type = type_map(*iter++);
             }
         }
@@ -0,0 +1,271 @@
+//
+// Created by ruixuezhao on 25-3-25.
+//
+
+#ifndef VFORMAT_HPP
+#define VFORMAT_HPP
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "error.hpp"
+#include "named_args.hpp"
+#include "type_traits.hpp"
+#include "result/result.h"
+
+/**
+ * @brief 类型擦除的格式化入口, 只依赖轻量头文件
+ *
+ * @note 参数先打包为 format_arg 数组, 输出函数包装为 format_sink, 格式化引擎本身不是模板:
+ *       链接 stringflow 库(定义 STRINGFLOW_COMPILED)时引擎只在库中编译一次, 包含本头文件的翻译单元
+ *       不再实例化 format.hpp 中的模板; 未链接库时引擎以 inline 形式包含进来, 用法相同.
+ *
+ *       std::string line = StringFlow::vformat("{}:{:>5}", StringFlow::make_format_args(name, 42)).unwrap();
+ *       StringFlow::vformat_to(out, "{user}@{host}", StringFlow::make_format_args(StringFlow::arg("user", u), StringFlow::arg("host", h))).unwrap();
+ *
+ *       支持内置类型(布尔、字符与宽字符、整数、浮点、C 字符串、std::string/std::string_view、指针、枚举),
+ *       输出与 format_to 相同(单字节整数按字符输出, 宽字符编码为 UTF-8);
+ *       自定义类型的 formatter 是模板, 需要使用 format.hpp 中的 format_to.
+ */
+using namespace result;
+namespace StringFlow {
+    /**
+     * @brief 单个参数: 类型标记加值(整数与浮点按值保存, 字符串与指针只保存地址)
+     */
+    class format_arg {
+    public:
+        enum class kind : uint8_t {
+            none, boolean, character, signed_char, unsigned_char, wchar, char16, char32,
+            signed_, unsigned_, floating, long_double, cstring, string, pointer
+        };
+
+        constexpr format_arg() : m_unsigned(0) {}
+
+        template <typename T>
+        explicit format_arg(const T &value) : format_arg() { set(value); }
+
+        template <typename T>
+        explicit format_arg(const named_arg<T> &named) : format_arg(named.value) {
+            m_name = named.name;
+            m_name_size = named.size;
+        }
+
+        constexpr kind type() const { return m_kind; }
+        bool name_is(const char *name, size_t size) const { return m_name && name_equal(m_name, m_name_size, name, size); }
+
+        /**
+         * @brief 按保存时的类型把值交给 visit(value)
+         */
+        template <class Visitor>
+        decltype(auto) visit(Visitor &&visit) const {
+            switch (m_kind) {
+                case kind::boolean:       return visit(m_bool);
+                case kind::character:     return visit(m_char);
+                case kind::signed_char:   return visit(m_signed_char);
+                case kind::unsigned_char: return visit(m_unsigned_char);
+                case kind::wchar:         return visit(m_wchar);
+                case kind::char16:        return visit(m_char16);
+                case kind::char32:        return visit(m_char32);
+                case kind::signed_:       return visit(m_signed);
+                case kind::unsigned_:     return visit(m_unsigned);
+                case kind::floating:      return visit(m_double);
+                case kind::long_double:   return visit(m_long_double);
+                case kind::cstring:       return visit(m_string.data);
+                case kind::string:        return visit(std::string_view(m_string.data, m_string.size));
+                case kind::pointer:       return visit(m_pointer);
+                default:                  return visit(m_unsigned);
+            }
+        }
+
+    private:
+        template <typename T>
+        void set(const T &value) {
+            using U = std::remove_cv_t<T>;
+            if constexpr (std::is_same_v<U, bool>) {
+                m_kind = kind::boolean;
+                m_bool = value;
+            } else if constexpr (std::is_same_v<U, char>) {
+                m_kind = kind::character;
+                m_char = value;
+            } else if constexpr (std::is_integral_v<U> && sizeof(U) == 1 && std::is_signed_v<U>) {
+                // 与 format_to 相同, 单字节整数(int8_t/uint8_t 等)按字符输出, 保留原类型以便 {:d} 输出原值
+                m_kind = kind::signed_char;
+                m_signed_char = value;
+            } else if constexpr (std::is_integral_v<U> && sizeof(U) == 1) {
+                m_kind = kind::unsigned_char;
+                m_unsigned_char = value;
+            } else if constexpr (std::is_same_v<U, wchar_t>) {
+                m_kind = kind::wchar;
+                m_wchar = value;
+            } else if constexpr (std::is_same_v<U, char16_t>) {
+                m_kind = kind::char16;
+                m_char16 = value;
+            } else if constexpr (std::is_same_v<U, char32_t>) {
+                m_kind = kind::char32;
+                m_char32 = value;
+            } else if constexpr (std::is_same_v<U, format_error>) {
+                set(format_error_to_string(value));
+            } else if constexpr (std::is_enum_v<U>) {
+                set(static_cast<std::underlying_type_t<U>>(value));
+            } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+                m_kind = kind::signed_;
+                m_signed = value;
+            } else if constexpr (std::is_integral_v<U>) {
+                m_kind = kind::unsigned_;
+                m_unsigned = value;
+            } else if constexpr (std::is_same_v<U, long double>) {
+                m_kind = kind::long_double;
+                m_long_double = value;
+            } else if constexpr (std::is_floating_point_v<U>) {
+                m_kind = kind::floating;
+                m_double = value;
+            } else if constexpr (std::is_array_v<U> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<U>>, char>) {
+                m_kind = kind::cstring;
+                m_string = {value, 0};
+            } else if constexpr (std::is_same_v<U, const char *> || std::is_same_v<U, char *>) {
+                m_kind = kind::cstring;
+                m_string = {value, 0};
+            } else if constexpr (std::is_convertible_v<const U &, std::string_view>) {
+                const std::string_view text = value;
+                m_kind = kind::string;
+                m_string = {text.data(), text.size()};
+            } else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+                m_kind = kind::pointer;
+                if constexpr (std::is_function_v<std::remove_pointer_t<U>>)
+                    m_pointer = reinterpret_cast<const void *>(value);
+                else
+                    m_pointer = value;
+            } else {
+                static_assert(sizeof(U) == 0, "vformat supports built-in types only, use format_to from format.hpp for custom types");
+            }
+        }
+
+        struct string_ref {
+            const char *data;
+            size_t size;
+        };
+
+        kind m_kind = kind::none;
+        union {
+            bool m_bool;
+            char m_char;
+            signed char m_signed_char;
+            unsigned char m_unsigned_char;
+            wchar_t m_wchar;
+            char16_t m_char16;
+            char32_t m_char32;
+            int64_t m_signed;
+            uint64_t m_unsigned;
+            double m_double;
+            long double m_long_double;
+            string_ref m_string;
+            const void *m_pointer;
+        };
+        const char *m_name = nullptr;
+        size_t m_name_size = 0;
+    };
+
+    /**
+     * @brief 参数数组的视图, 参数的生命周期由调用方保证(通常是 make_format_args 的临时对象)
+     */
+    class format_args {
+    public:
+        constexpr format_args() = default;
+        constexpr format_args(const format_arg *data, size_t size) : m_data(data), m_size(size) {}
+
+        constexpr size_t size() const { return m_size; }
+        constexpr const format_arg &operator[](size_t index) const { return m_data[index]; }
+
+        // 具名参数的下标, 不存在时返回 npos_arg
+        size_t index_of(const char *name, size_t size) const {
+            for (size_t i = 0; i < m_size; ++i)
+                if (m_data[i].name_is(name, size)) return i;
+            return npos_arg;
+        }
+
+    private:
+        const format_arg *m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    template <size_t N>
+    struct format_arg_store {
+        std::array<format_arg, N ? N : 1> args;
+
+        operator format_args() const { return {args.data(), N}; }
+    };
+
+    template <typename... Args>
+    format_arg_store<sizeof...(Args)> make_format_args(const Args &...args) {
+        return {{format_arg(args)...}};
+    }
+
+    /**
+     * @brief 类型擦除的输出函数: 函数对象只保存其地址, 生命周期需长于 format_sink; 普通函数(如 putchar)保存函数指针
+     */
+    class format_sink {
+    public:
+        template <class output_str_function_wrap,
+                  typename = std::enable_if_t<!std::is_same_v<std::decay_t<output_str_function_wrap>, format_sink> &&
+                                              !std::is_function_v<std::remove_pointer_t<output_str_function_wrap>>>>
+        format_sink(output_str_function_wrap &out_fct_wrap) : m_write(&write<output_str_function_wrap>) {
+            m_context.object = const_cast<void *>(static_cast<const void *>(&out_fct_wrap));
+        }
+
+        template <typename R, typename Char>
+        format_sink(R (*out_fct)(Char)) : m_write(&write_function<R, Char>) {
+            m_context.function = reinterpret_cast<void (*)()>(out_fct);
+        }
+
+        void operator()(char ch) const { m_write(m_context, &ch, 1); }
+        void operator()(const char *data, size_t size) const { m_write(m_context, data, size); }
+
+    private:
+        // 对象指针与函数指针不能互相转换, 分开保存
+        union context {
+            void *object;
+            void (*function)();
+        };
+
+        template <class output_str_function_wrap>
+        static void write(context target, const char *data, size_t size) {
+            auto &out_fct_wrap = *static_cast<output_str_function_wrap *>(target.object);
+            if constexpr (has_write_span<output_str_function_wrap>::value) {
+                out_fct_wrap(data, size);
+            } else {
+                for (size_t i = 0; i < size; ++i)
+                    out_fct_wrap(data[i]);
+            }
+        }
+
+        template <typename R, typename Char>
+        static void write_function(context target, const char *data, size_t size) {
+            const auto out_fct = reinterpret_cast<R (*)(Char)>(target.function);
+            for (size_t i = 0; i < size; ++i)
+                out_fct(data[i]);
+        }
+
+        context m_context;
+        void (*m_write)(context, const char *, size_t);
+    };
+
+    /**
+     * @brief 格式化引擎: 字段语法、对齐与错误位置与 format_to 相同(error_policy::stop)
+     *
+     * @return 成功格式化的字段数
+     */
+    STRINGFLOW_FUNC Result<size_t, format_error_info> vformat_to(format_sink out, const char *format, format_args args);
+
+    STRINGFLOW_FUNC Result<std::string, format_error_info> vformat(const char *format, format_args args);
+
+    template <class output_str_function_wrap>
+    Result<size_t, format_error_info> vformat_to(output_str_function_wrap &&out_fct_wrap, const char *format, format_args args) {
+        return vformat_to(format_sink(out_fct_wrap), format, args);
+    }
+}
+
+#if !defined(STRINGFLOW_COMPILED)
+#include "vformat_inl.hpp"
+#endif
+#endif //VFORMAT_HPP
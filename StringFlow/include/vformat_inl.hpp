@@ -0,0 +1,94 @@
+//
+// Created by ruixuezhao on 25-3-25.
+//
+
+#ifndef VFORMAT_INL_HPP
+#define VFORMAT_INL_HPP
+#include "format.hpp"
+#include "vformat.hpp"
+
+/**
+ * @brief vformat_to/vformat 的实现: 未链接 stringflow 库时由 vformat.hpp 包含(inline),
+ *        否则只由 src/vformat.cpp 编译一次
+ */
+namespace StringFlow {
+    namespace details {
+        // 把逐字符的输出攒成整段再交给 format_sink, 减少间接调用
+        class buffered_sink {
+        public:
+            explicit buffered_sink(const format_sink &out) : m_out(out) {}
+            ~buffered_sink() { flush(); }
+
+            void operator()(char ch) {
+                if (STRINGFLOW_UNLIKELY(m_size == sizeof(m_buffer))) flush();
+                m_buffer[m_size++] = ch;
+            }
+
+            void operator()(const char *data, size_t size) {
+                if (size > sizeof(m_buffer) - m_size) {
+                    flush();
+                    if (size >= sizeof(m_buffer)) {
+                        m_out(data, size);
+                        return;
+                    }
+                }
+                memcpy(m_buffer + m_size, data, size);
+                m_size += size;
+            }
+
+            void flush() {
+                if (m_size) m_out(m_buffer, m_size);
+                m_size = 0;
+            }
+
+        private:
+            const format_sink &m_out;
+            char m_buffer[256];
+            size_t m_size = 0;
+        };
+    }
+
+    STRINGFLOW_FUNC Result<size_t, format_error_info> vformat_to(format_sink out, const char *format, format_args args) {
+        if (STRINGFLOW_UNLIKELY(!format)) return Err(format_error_info(format_error::invalid_alignment));
+
+        details::buffered_sink sink(out);
+        size_t count = 0;
+        size_t field = 0;
+        format_error_info error;
+        auto scanned = details::scan_format(format,
+            [&](const char *text, size_t size) { sink(text, size); },
+            [&](const Context &context, size_t arg_index, const char *name, size_t name_size) {
+                if (name) arg_index = args.index_of(name, name_size);
+                const size_t index = field++;
+                const size_t offset = context.begin - format;
+                if (STRINGFLOW_UNLIKELY(arg_index >= args.size())) {
+                    error = format_error_info(format_error::argument_index_out_of_range, index, offset);
+                    return false;
+                }
+                FormatterOption option;
+                context.unpack_to(option);
+                auto formatted = args[arg_index].visit([&](const auto &value) {
+                    return details::format_value(sink, context, option, value);
+                });
+                if (STRINGFLOW_LIKELY(formatted.is_ok())) {
+                    ++count;
+                    return true;
+                }
+                error = format_error_info(formatted.unwrap_err(), index, offset);
+                return false;
+            });
+        sink.flush();
+        if (STRINGFLOW_UNLIKELY(scanned.is_err())) return Err(scanned.unwrap_err());
+        if (STRINGFLOW_UNLIKELY(error.code() != format_error::success)) return Err(error);
+        return Ok(count);
+    }
+
+    STRINGFLOW_FUNC Result<std::string, format_error_info> vformat(const char *format, format_args args) {
+        std::string text;
+        details::string_sink<std::string> sink{text};
+        auto written = vformat_to(format_sink(sink), format, args);
+        if (STRINGFLOW_UNLIKELY(written.is_err())) return Err(written.unwrap_err());
+        return Ok(std::move(text));
+    }
+}
+#endif //VFORMAT_INL_HPP
@@ -1,14 +1,43 @@
 #ifndef RESULT_H_1de851ad_b9f8_434d_b73d_f06a6b5daa9a
 #define RESULT_H_1de851ad_b9f8_434d_b73d_f06a6b5daa9a
 
+#include <cerrno>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
-#include <iostream>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <utility>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Ok 为预期的分支; panic 等出错才执行的函数不内联并放入冷代码段, 成功路径保持紧凑.
+// 定义 STRINGFLOW_NO_COLD 时关闭, 与 include/utils.hpp 中的 STRINGFLOW_COLD 一致
+#if defined(__GNUC__) || defined(__clang__)
+#define RESULT_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define RESULT_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define RESULT_LIKELY(condition) (condition)
+#define RESULT_UNLIKELY(condition) (condition)
+#endif
+#if defined(STRINGFLOW_NO_COLD)
+#define RESULT_COLD
+#elif defined(__GNUC__) || defined(__clang__)
+#define RESULT_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define RESULT_COLD __declspec(noinline)
+#else
+#define RESULT_COLD
+#endif
 
 namespace result {
 
@@ -17,11 +46,6 @@ using optional = std::optional<T>;
 using nullopt_t = std::nullopt_t;
 inline constexpr nullopt_t nullopt = std::nullopt;
 
-
-template <typename T>
-inline std::ostream& operator<<(
-        std::ostream& stream, const std::reference_wrapper<T>& obj);
-
 enum class ResultKind : uint8_t {
     Ok = 0,
     Err = 1,
@@ -100,13 +124,158 @@ public:
 Ok()->Ok<unit_t>;
 
 
+/**
+ * @brief 调用位置, 作为 unwrap/expect 等函数的默认参数在调用处求值
+ */
+struct source_location {
+    const char* file = "";
+    unsigned line = 0;
+    const char* function = "";
+
+    static constexpr source_location current(
+            const char* file = __builtin_FILE(),
+            unsigned line = __builtin_LINE(),
+            const char* function = __builtin_FUNCTION()) noexcept {
+        return {file, line, function};
+    }
+};
+
 namespace details {
 
-inline void terminate(const std::string_view& msg) {
-    std::cerr << msg << std::endl;
-    std::terminate();
+// 直接写 stderr(fd 2), 不依赖 iostream 的静态初始化
+inline void write_stderr(const char* data, size_t size) {
+#ifdef _WIN32
+    _write(2, data, static_cast<unsigned>(size));
+#else
+    while(size > 0) {
+        const ssize_t written = ::write(2, data, size);
+        if(written < 0 && errno == EINTR) {
+            continue;
+        }
+        if(written <= 0) {
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+#endif
+}
+
+// panic 的输出端: 缓冲区写满或结束时调用一次 write(2)
+struct stderr_sink {
+    char buffer[256];
+    size_t size = 0;
+
+    void operator()(char ch) {
+        if(size == sizeof(buffer)) {
+            flush();
+        }
+        buffer[size++] = ch;
+    }
+    void operator()(const char* data, size_t length) {
+        while(length) {
+            if(size == sizeof(buffer)) {
+                flush();
+            }
+            const size_t chunk = length < sizeof(buffer) - size ? length : sizeof(buffer) - size;
+            std::memcpy(buffer + size, data, chunk);
+            size += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+    }
+    void operator()(std::string_view text) { (*this)(text.data(), text.size()); }
+    void flush() {
+        write_stderr(buffer, size);
+        size = 0;
+    }
+};
+
+template <typename I>
+void write_integer(stderr_sink& out, I value) {
+    char digits[24];
+    char* pos = digits + sizeof(digits);
+    const bool negative = value < 0;
+    unsigned long long magnitude = negative ? 0ull - static_cast<unsigned long long>(value)
+                                            : static_cast<unsigned long long>(value);
+    do {
+        *--pos = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude);
+    if(negative) {
+        *--pos = '-';
+    }
+    out(pos, static_cast<size_t>(digits + sizeof(digits) - pos));
 }
 
+// 错误值的类型可以提供一个由 ADL 找到的 panic_value(out, value), out 为 stderr_sink,
+// 写入 out(const char*, size_t); 内置的整数、浮点、字符串与枚举在这里直接输出
+template <typename V, typename = void>
+struct has_panic_value : std::false_type {};
+template <typename V>
+struct has_panic_value<V,
+        std::void_t<decltype(panic_value(std::declval<stderr_sink&>(), std::declval<const V&>()))>>
+    : std::true_type {};
+
+template <typename V>
+inline constexpr bool is_panic_printable = has_panic_value<V>::value || std::is_arithmetic<V>::value ||
+        std::is_enum<V>::value || std::is_convertible<const V&, std::string_view>::value;
+
+template <typename V>
+void write_panic_value(stderr_sink& out, const V& value) {
+    if constexpr(has_panic_value<V>::value) {
+        panic_value(out, value);
+    } else if constexpr(std::is_same<V, bool>::value) {
+        out(value ? std::string_view("true") : std::string_view("false"));
+    } else if constexpr(std::is_same<V, char>::value) {
+        out(value);
+    } else if constexpr(std::is_integral<V>::value) {
+        write_integer(out, value);
+    } else if constexpr(std::is_floating_point<V>::value) {
+        char text[32];
+        const int length = std::snprintf(text, sizeof(text), "%g", static_cast<double>(value));
+        out(text, length > 0 ? static_cast<size_t>(length) : 0);
+    } else if constexpr(std::is_enum<V>::value) {
+        write_integer(out, static_cast<std::underlying_type_t<V>>(value));
+    } else {
+        out(std::string_view(value));
+    }
+}
+
+// 输出 "panicked at file:line (function): message: value" 后终止; value 无法输出时省略 ": value"
+template <typename V>
+[[noreturn]] RESULT_COLD void panic(std::string_view message, const V& value,
+        const source_location& location) {
+    stderr_sink out;
+    out("panicked at ");
+    out(location.file);
+    out(':');
+    write_integer(out, location.line);
+    out(" (");
+    out(location.function);
+    out("): ");
+    out(message);
+    if constexpr(is_panic_printable<V>) {
+        out(": ");
+        write_panic_value(out, value);
+    }
+    out('\n');
+    out.flush();
+    std::abort();
+}
+
+} // namespace details
+
+inline void panic_value(details::stderr_sink& out, unit_t) { out("()"); }
+
+namespace details {
+
+// 组合子的 noexcept 条件: fn(arg) 不抛异常, 其结果构造 Out 不抛异常, 另一侧的载荷 Other 转移时不抛异常
+template <typename F, typename Arg, typename Out, typename Other>
+inline constexpr bool nothrow_step = std::is_nothrow_invocable<F, Arg>::value &&
+        std::is_nothrow_constructible<Out, std::invoke_result_t<F, Arg>>::value &&
+        std::is_nothrow_constructible<std::decay_t<Other>, Other>::value;
+
 template <typename T, typename E>
 class ResultStorage {
     using DecayT = std::decay_t<T>;
@@ -168,32 +337,33 @@ public:
         }
     }
     constexpr ResultStorage& operator=(const ResultStorage<T, E>& rhs) noexcept(
-            std::is_nothrow_copy_assignable<T>::value&&
-                    std::is_nothrow_copy_assignable<E>::value) {
-        destroy();
-        m_tag = rhs.m_tag;
-
-        if(kind() == ResultKind::Ok) {
-            T& val = get<T>();
-            val = rhs.get<T>();
-        } else {
-            E& val = get<E>();
-            val = rhs.get<E>();
+            std::is_nothrow_copy_constructible<T>::value&&
+                    std::is_nothrow_copy_constructible<E>::value) {
+        if(this != &rhs) {
+            // 原对象析构后在原地重新构造, 不能对已析构的对象赋值
+            destroy();
+            m_tag = rhs.m_tag;
+            if(kind() == ResultKind::Ok) {
+                new(&m_data) DecayT(rhs.template get<T>());
+            } else {
+                new(&m_data) DecayE(rhs.template get<E>());
+            }
         }
+        return *this;
     }
     constexpr ResultStorage& operator=(ResultStorage<T, E>&& rhs) noexcept(
-            std::is_nothrow_move_assignable<T>::value&&
-                    std::is_nothrow_move_assignable<E>::value) {
-        destroy();
-        m_tag = rhs.m_tag;
-
-        if(kind() == ResultKind::Ok) {
-            T& val = get<T>();
-            val = std::move(rhs).template get<T>();
-        } else {
-            E& val = get<E>();
-            val = std::move(rhs).template get<E>();
+            std::is_nothrow_move_constructible<T>::value&&
+                    std::is_nothrow_move_constructible<E>::value) {
+        if(this != &rhs) {
+            destroy();
+            m_tag = rhs.m_tag;
+            if(kind() == ResultKind::Ok) {
+                new(&m_data) DecayT(std::move(rhs).template get<T>());
+            } else {
+                new(&m_data) DecayE(std::move(rhs).template get<E>());
+            }
         }
+        return *this;
     }
 
     template <typename U>
@@ -255,11 +425,10 @@ public:
             "Cannot create a Result<T, E> object with E=void. You want an "
             "optional<T>.");
 
-    constexpr Result() {
+    constexpr Result() : m_storage(ok_tag) {
         static_assert(std::is_default_constructible<T>::value,
                 "Result<T, E> may only be default constructed if T is default "
                 "constructible.");
-        m_storage = Ok(T());
     }
     constexpr Result(Ok<T> value) : m_storage(std::move(value)) {}
     constexpr Result(Err<E> value) : m_storage(std::move(value)) {}
@@ -380,27 +549,31 @@ public:
         }
     }
 
-    constexpr const E& try_err() const {
-        if(!is_err()) {
-            details::terminate("Called `try_err` on an Ok value");
+    constexpr const E& try_err(
+            const source_location& location = source_location::current()) const {
+        if(RESULT_UNLIKELY(!is_err())) {
+            details::panic("Called `try_err` on an Ok value", ok_unchecked(), location);
         }
         return err_unchecked();
     }
-    constexpr E& try_err() {
-        if(!is_err()) {
-            details::terminate("Called `try_err` on an Ok value");
+    constexpr E& try_err(
+            const source_location& location = source_location::current()) {
+        if(RESULT_UNLIKELY(!is_err())) {
+            details::panic("Called `try_err` on an Ok value", ok_unchecked(), location);
         }
         return err_unchecked();
     }
-    constexpr const T& try_ok() const {
-        if(!is_ok()) {
-            details::terminate("Called `try_ok` on an Err value");
+    constexpr const T& try_ok(
+            const source_location& location = source_location::current()) const {
+        if(RESULT_UNLIKELY(!is_ok())) {
+            details::panic("Called `try_ok` on an Err value", err_unchecked(), location);
         }
         return ok_unchecked();
     }
-    constexpr T& try_ok() {
-        if(!is_ok()) {
-            details::terminate("Called `try_ok` on an Err value");
+    constexpr T& try_ok(
+            const source_location& location = source_location::current()) {
+        if(RESULT_UNLIKELY(!is_ok())) {
+            details::panic("Called `try_ok` on an Err value", err_unchecked(), location);
         }
         return ok_unchecked();
     }
@@ -413,9 +586,10 @@ public:
     }
 
 
-    constexpr T&& unwrap() {
-        if(!is_ok()) {
-            details::terminate("Called `unwrap` on an Err value");
+    constexpr T&& unwrap(
+            const source_location& location = source_location::current()) {
+        if(RESULT_UNLIKELY(!is_ok())) {
+            details::panic("Called `unwrap` on an Err value", err_unchecked(), location);
         }
         return std::move(*this).ok_unchecked();
     }
@@ -433,9 +607,10 @@ public:
         }
         return std::move(*this).ok_unchecked();
     }
-    constexpr E&& unwrap_err() {
-        if(!is_err()) {
-            details::terminate("Called `unwrap_err` on an Err value");
+    constexpr E&& unwrap_err(
+            const source_location& location = source_location::current()) {
+        if(RESULT_UNLIKELY(!is_err())) {
+            details::panic("Called `unwrap_err` on an Ok value", ok_unchecked(), location);
         }
         return std::move(*this).err_unchecked();
     }
@@ -455,16 +630,18 @@ public:
         return std::move(*this).err_unchecked();
     }
 
-    constexpr T&& expect(const std::string_view& message) {
-        if(!is_ok()) {
-            details::terminate(message);
+    constexpr T&& expect(const std::string_view& message,
+            const source_location& location = source_location::current()) {
+        if(RESULT_UNLIKELY(!is_ok())) {
+            details::panic(message, err_unchecked(), location);
         }
         return std::move(*this).ok_unchecked();
         ;
     }
-    constexpr E&& expect_err(const std::string_view& message) {
-        if(!is_err()) {
-            details::terminate(message);
+    constexpr E&& expect_err(const std::string_view& message,
+            const source_location& location = source_location::current()) {
+        if(RESULT_UNLIKELY(!is_err())) {
+            details::panic(message, ok_unchecked(), location);
         }
         return std::move(*this).err_unchecked();
         ;
@@ -494,31 +671,53 @@ public:
 
     // }}}
     // ===== Combinators and adapters ===== {{{
+    // 左值版本复制载荷, 右值版本(链式调用的临时对象)移动载荷; 结果直接在返回值中构造,
+    // 不经过 Ok/Err 包装的临时对象. 函数不抛异常且载荷可以不抛异常地构造时为 noexcept
     template <typename F,
-            typename T2 = std::invoke_result_t<F, T>,
-            std::enable_if_t<std::is_invocable_r<T2, F, T>::value, int> = 0>
-    Result<T2, E> map(F && map_fn) const {
-        if(is_ok()) {
-            return Result<T2, E>(Ok(map_fn(std::move(*this).ok_unchecked())));
+            typename T2 = std::decay_t<std::invoke_result_t<F, const T&>>>
+    [[nodiscard]] constexpr Result<T2, E> map(F && map_fn) const& noexcept(
+            details::nothrow_step<F, const T&, T2, const E&>) {
+        if(RESULT_LIKELY(is_ok())) {
+            return Result<T2, E>(ok_tag, map_fn(ok_unchecked()));
         } else {
-            return Result<T2, E>(Err(std::move(*this).err_unchecked()));
+            return Result<T2, E>(err_tag, err_unchecked());
+        }
+    }
+    template <typename F,
+            typename T2 = std::decay_t<std::invoke_result_t<F, T&&>>>
+    [[nodiscard]] constexpr Result<T2, E> map(F && map_fn) && noexcept(
+            details::nothrow_step<F, T&&, T2, E&&>) {
+        if(RESULT_LIKELY(is_ok())) {
+            return Result<T2, E>(ok_tag, map_fn(std::move(*this).ok_unchecked()));
+        } else {
+            return Result<T2, E>(err_tag, std::move(*this).err_unchecked());
         }
     }
 
     template <typename F,
-            typename E2 = std::invoke_result_t<F, E>,
-            std::enable_if_t<std::is_invocable_r<E2, F, E>::value, int> = 0>
-    Result<T, E2> map_err(F && map_fn) {
-        if(is_ok()) {
-            return Result<T, E2>(Ok(std::move(*this).ok_unchecked()));
+            typename E2 = std::decay_t<std::invoke_result_t<F, const E&>>>
+    [[nodiscard]] constexpr Result<T, E2> map_err(F && map_fn) const& noexcept(
+            details::nothrow_step<F, const E&, E2, const T&>) {
+        if(RESULT_LIKELY(is_ok())) {
+            return Result<T, E2>(ok_tag, ok_unchecked());
+        } else {
+            return Result<T, E2>(err_tag, map_fn(err_unchecked()));
+        }
+    }
+    template <typename F,
+            typename E2 = std::decay_t<std::invoke_result_t<F, E&&>>>
+    [[nodiscard]] constexpr Result<T, E2> map_err(F && map_fn) && noexcept(
+            details::nothrow_step<F, E&&, E2, T&&>) {
+        if(RESULT_LIKELY(is_ok())) {
+            return Result<T, E2>(ok_tag, std::move(*this).ok_unchecked());
         } else {
-            return Result<T, E2>(Err(map_fn(std::move(*this).err_unchecked())));
+            return Result<T, E2>(err_tag, map_fn(std::move(*this).err_unchecked()));
         }
     }
 
     template <typename T2>
     Result<T2, E> and_(Result<T2, E> other) {
-        if(is_ok()) {
+        if(RESULT_LIKELY(is_ok())) {
             return other;
         } else {
             return Result<T2, E>(Err(std::move(*this).err_unchecked()));
@@ -526,14 +725,25 @@ public:
     }
 
     template <typename F,
-            typename T2 = typename std::invoke_result_t<F, T>::value_type,
-            std::enable_if_t<std::is_invocable_r<Result<T2, E>, F, T>::value,
-                    int> = 0>
-    Result<T2, E> and_then(F && fn) {
-        if(is_ok()) {
+            typename R = std::decay_t<std::invoke_result_t<F, const T&>>,
+            typename T2 = typename R::value_type>
+    [[nodiscard]] constexpr Result<T2, E> and_then(F && fn) const& noexcept(
+            details::nothrow_step<F, const T&, Result<T2, E>, const E&>) {
+        if(RESULT_LIKELY(is_ok())) {
+            return fn(ok_unchecked());
+        } else {
+            return Result<T2, E>(err_tag, err_unchecked());
+        }
+    }
+    template <typename F,
+            typename R = std::decay_t<std::invoke_result_t<F, T&&>>,
+            typename T2 = typename R::value_type>
+    [[nodiscard]] constexpr Result<T2, E> and_then(F && fn) && noexcept(
+            details::nothrow_step<F, T&&, Result<T2, E>, E&&>) {
+        if(RESULT_LIKELY(is_ok())) {
             return fn(std::move(*this).ok_unchecked());
         } else {
-            return Result<T2, E>(Err(std::move(*this).err_unchecked()));
+            return Result<T2, E>(err_tag, std::move(*this).err_unchecked());
         }
     }
 
@@ -547,14 +757,25 @@ public:
     }
 
     template <typename F,
-            typename E2 = typename std::invoke_result_t<F, E>::error_type,
-            std::enable_if_t<std::is_invocable_r<Result<T, E2>, F, E>::value,
-                    int> = 0>
-    Result<T, E2> or_else(F && fn) {
-        if(is_err()) {
+            typename R = std::decay_t<std::invoke_result_t<F, const E&>>,
+            typename E2 = typename R::error_type>
+    [[nodiscard]] constexpr Result<T, E2> or_else(F && fn) const& noexcept(
+            details::nothrow_step<F, const E&, Result<T, E2>, const T&>) {
+        if(RESULT_UNLIKELY(is_err())) {
+            return fn(err_unchecked());
+        } else {
+            return Result<T, E2>(ok_tag, ok_unchecked());
+        }
+    }
+    template <typename F,
+            typename R = std::decay_t<std::invoke_result_t<F, E&&>>,
+            typename E2 = typename R::error_type>
+    [[nodiscard]] constexpr Result<T, E2> or_else(F && fn) && noexcept(
+            details::nothrow_step<F, E&&, Result<T, E2>, T&&>) {
+        if(RESULT_UNLIKELY(is_err())) {
             return fn(std::move(*this).err_unchecked());
         } else {
-            return Result<T, E2>(Ok(std::move(*this).ok_unchecked()));
+            return Result<T, E2>(ok_tag, std::move(*this).ok_unchecked());
         }
     }
 
@@ -630,56 +851,234 @@ inline constexpr bool operator>=(const Result<T, E>& lhs, Err<E> rhs) {
     return lhs >= Result<T, E>(std::move(rhs));
 }
 
-template <typename T>
-inline std::ostream& operator<<(std::ostream& stream, unit_t) {
-    stream << "()";
-    return stream;
-}
+// ===== Lazy pipeline ===== {{{
+//
+// Result<int, std::string> r = parse(text) | lazy::then(check) | lazy::map(scale)
+//                                          | lazy::map_err(describe);
+//
+// 各步骤先收集起来, 转换为 Result(或调用 run())时才求值: 载荷沿 Ok 或 Err 一侧直接传给下一步,
+// 中间不构造 Result, 只有 then/or_else 返回的 Result 需要检查一次. 进入 Err 一侧后, 之后的
+// then/map 在编译期就被跳过, 整条链展开后与手写的 if 相同.
+namespace lazy {
+
+template <typename F>
+struct then_step {
+    F fn;
+};
+template <typename F>
+struct map_step {
+    F fn;
+};
+template <typename F>
+struct map_err_step {
+    F fn;
+};
+template <typename F>
+struct or_else_step {
+    F fn;
+};
 
-template <typename T>
-inline std::ostream& operator<<(std::ostream& stream, const Ok<T>& ok) {
-    if constexpr(std::is_same<T, unit_t>::value) {
-        stream << "Ok()" << std::endl;
-    } else {
-        stream << "Ok(" << ok.value() << ")";
-    }
-    return stream;
+/**
+ * @brief 尚未绑定 Result 的一串步骤, 可以单独保存后复用: auto steps = lazy::then(f) | lazy::map_err(g);
+ */
+template <typename... Steps>
+class [[nodiscard]] pipeline {
+public:
+    constexpr explicit pipeline(std::tuple<Steps...> steps) : m_steps(std::move(steps)) {}
+
+    constexpr const std::tuple<Steps...>& steps() const& noexcept { return m_steps; }
+    constexpr std::tuple<Steps...>&& steps() && noexcept { return std::move(m_steps); }
+
+private:
+    std::tuple<Steps...> m_steps;
+};
+
+// Ok 时调用 fn(value), fn 返回 Result(或 Ok/Err)
+template <typename F>
+[[nodiscard]] constexpr pipeline<then_step<std::decay_t<F>>> then(F&& fn) {
+    using step = then_step<std::decay_t<F>>;
+    return pipeline<step>(std::tuple<step>(step{std::forward<F>(fn)}));
 }
-template <typename T>
-inline std::ostream& operator<<(std::ostream& stream, const Err<T>& err) {
-    stream << "Err(" << err.value() << ")";
-    return stream;
+// Ok 时把值替换为 fn(value)
+template <typename F>
+[[nodiscard]] constexpr pipeline<map_step<std::decay_t<F>>> map(F&& fn) {
+    using step = map_step<std::decay_t<F>>;
+    return pipeline<step>(std::tuple<step>(step{std::forward<F>(fn)}));
+}
+// Err 时把错误替换为 fn(error)
+template <typename F>
+[[nodiscard]] constexpr pipeline<map_err_step<std::decay_t<F>>> map_err(F&& fn) {
+    using step = map_err_step<std::decay_t<F>>;
+    return pipeline<step>(std::tuple<step>(step{std::forward<F>(fn)}));
+}
+// Err 时调用 fn(error) 尝试恢复, fn 返回 Result(或 Ok/Err)
+template <typename F>
+[[nodiscard]] constexpr pipeline<or_else_step<std::decay_t<F>>> or_else(F&& fn) {
+    using step = or_else_step<std::decay_t<F>>;
+    return pipeline<step>(std::tuple<step>(step{std::forward<F>(fn)}));
 }
 
-template <typename T, typename E>
-inline std::ostream& operator<<(
-        std::ostream& stream, const Result<T, E>& result) {
-    switch(result.kind()) {
-    case ResultKind::Ok: {
-        if constexpr(std::is_same<T, unit_t>::value) {
-            stream << "Ok()";
+template <typename... A, typename... B>
+[[nodiscard]] constexpr pipeline<A..., B...> operator|(pipeline<A...> lhs, pipeline<B...> rhs) {
+    return pipeline<A..., B...>(std::tuple_cat(std::move(lhs).steps(), std::move(rhs).steps()));
+}
+
+} // namespace lazy
+
+namespace details {
+
+// fn 的返回值归到 Ok 或 Err 一侧时的载荷类型, 返回 Ok/Err 时另一侧保持 T/E 不变
+template <typename R, typename T, typename E>
+struct step_types {
+    using value_type = typename R::value_type;
+    using error_type = typename R::error_type;
+};
+template <typename U, typename T, typename E>
+struct step_types<Ok<U>, T, E> {
+    using value_type = U;
+    using error_type = E;
+};
+template <typename U, typename T, typename E>
+struct step_types<Err<U>, T, E> {
+    using value_type = T;
+    using error_type = U;
+};
+
+// 依次应用各步骤后的 Result 类型
+template <typename T, typename E, typename... Steps>
+struct pipeline_result {
+    using type = Result<T, E>;
+};
+template <typename T, typename E, typename F, typename... Rest>
+struct pipeline_result<T, E, lazy::then_step<F>, Rest...>
+    : pipeline_result<typename step_types<std::decay_t<std::invoke_result_t<F&, T&&>>, T, E>::value_type, E, Rest...> {};
+template <typename T, typename E, typename F, typename... Rest>
+struct pipeline_result<T, E, lazy::map_step<F>, Rest...>
+    : pipeline_result<std::decay_t<std::invoke_result_t<F&, T&&>>, E, Rest...> {};
+template <typename T, typename E, typename F, typename... Rest>
+struct pipeline_result<T, E, lazy::map_err_step<F>, Rest...>
+    : pipeline_result<T, std::decay_t<std::invoke_result_t<F&, E&&>>, Rest...> {};
+template <typename T, typename E, typename F, typename... Rest>
+struct pipeline_result<T, E, lazy::or_else_step<F>, Rest...>
+    : pipeline_result<T, typename step_types<std::decay_t<std::invoke_result_t<F&, E&&>>, T, E>::error_type, Rest...> {};
+
+template <typename U>
+struct is_ok_wrapper : std::false_type {};
+template <typename U>
+struct is_ok_wrapper<Ok<U>> : std::true_type {};
+
+template <typename Step>
+struct step_kind;
+template <typename F>
+struct step_kind<lazy::then_step<F>> {
+    static constexpr bool on_ok = true, fallible = true;
+};
+template <typename F>
+struct step_kind<lazy::map_step<F>> {
+    static constexpr bool on_ok = true, fallible = false;
+};
+template <typename F>
+struct step_kind<lazy::map_err_step<F>> {
+    static constexpr bool on_ok = false, fallible = false;
+};
+template <typename F>
+struct step_kind<lazy::or_else_step<F>> {
+    static constexpr bool on_ok = false, fallible = true;
+};
+
+/**
+ * @brief 绑定了源 Result 的流水线, 转换为 Result 时求值; 源为右值时移入, 为左值时复制
+ */
+template <typename T, typename E, typename... Steps>
+class [[nodiscard]] pending_pipeline {
+public:
+    using result_type = typename pipeline_result<T, E, Steps...>::type;
+
+    constexpr pending_pipeline(Result<T, E> source, std::tuple<Steps...> steps)
+        : m_source(std::move(source)), m_steps(std::move(steps)) {}
+
+    [[nodiscard]] constexpr result_type run() && {
+        if(RESULT_LIKELY(m_source.is_ok())) {
+            return on_ok<0>(std::move(m_source).ok_unchecked());
+        }
+        return on_err<0>(std::move(m_source).err_unchecked());
+    }
+    constexpr operator result_type() && { return std::move(*this).run(); }
+
+    template <typename... More>
+    [[nodiscard]] constexpr pending_pipeline<T, E, Steps..., More...> operator|(lazy::pipeline<More...> more) && {
+        return {std::move(m_source), std::tuple_cat(std::move(m_steps), std::move(more).steps())};
+    }
+
+private:
+    template <size_t I, typename V>
+    constexpr result_type on_ok(V&& value) {
+        if constexpr(I == sizeof...(Steps)) {
+            return result_type(ok_tag, std::forward<V>(value));
         } else {
-            stream << "Ok(" << result.ok().value() << ")";
+            using step = std::tuple_element_t<I, std::tuple<Steps...>>;
+            auto& fn = std::get<I>(m_steps).fn;
+            if constexpr(!step_kind<step>::on_ok) {
+                return on_ok<I + 1>(std::forward<V>(value));
+            } else if constexpr(!step_kind<step>::fallible) {
+                return on_ok<I + 1>(fn(std::forward<V>(value)));
+            } else {
+                return branch<I + 1>(fn(std::forward<V>(value)));
+            }
         }
-        break;
     }
-    case ResultKind::Err: {
-        stream << "Err( " << result.err().value() << ")";
-        break;
+
+    template <size_t I, typename V>
+    constexpr result_type on_err(V&& error) {
+        if constexpr(I == sizeof...(Steps)) {
+            return result_type(err_tag, std::forward<V>(error));
+        } else {
+            using step = std::tuple_element_t<I, std::tuple<Steps...>>;
+            auto& fn = std::get<I>(m_steps).fn;
+            if constexpr(step_kind<step>::on_ok) {
+                return on_err<I + 1>(std::forward<V>(error));
+            } else if constexpr(!step_kind<step>::fallible) {
+                return on_err<I + 1>(fn(std::forward<V>(error)));
+            } else {
+                return branch<I + 1>(fn(std::forward<V>(error)));
+            }
+        }
     }
-    default:
-        stream << "INVALID RESULT";
-        break;
+
+    // then/or_else 的返回值: 整条链中唯一需要检查的地方
+    template <size_t I, typename R>
+    constexpr result_type branch(R&& step) {
+        using U = std::decay_t<R>;
+        if constexpr(is_result<U>::value) {
+            if(RESULT_LIKELY(step.is_ok())) {
+                return on_ok<I>(std::move(step).ok_unchecked());
+            }
+            return on_err<I>(std::move(step).err_unchecked());
+        } else if constexpr(is_ok_wrapper<U>::value) {
+            return on_ok<I>(std::move(step).value());
+        } else {
+            return on_err<I>(std::move(step).value());
+        }
     }
-    return stream;
-}
 
-template <typename T>
-inline std::ostream& operator<<(
-        std::ostream& stream, const std::reference_wrapper<T>& obj) {
-    stream << obj.get();
-    return stream;
+    Result<T, E> m_source;
+    std::tuple<Steps...> m_steps;
+};
+
+} // namespace details
+
+template <typename T, typename E, typename... Steps>
+[[nodiscard]] constexpr details::pending_pipeline<T, E, Steps...> operator|(
+        Result<T, E>&& source, lazy::pipeline<Steps...> steps) {
+    return {std::move(source), std::move(steps).steps()};
 }
+template <typename T, typename E, typename... Steps>
+[[nodiscard]] constexpr details::pending_pipeline<T, E, Steps...> operator|(
+        const Result<T, E>& source, lazy::pipeline<Steps...> steps) {
+    return {source, std::move(steps).steps()};
+}
+
+// }}}
 
 } // namespace result
 
@@ -709,7 +1108,7 @@ struct hash<result::Result<T, E>> {
 #define TRY_IMPL(var, tmp, expr, error_mapper) \
 auto&& tmp = (expr); \
 if (tmp.is_err()) { \
-return tmp.map_err(error_mapper); \
+return std::move(tmp).map_err(error_mapper); \
 } \
 auto var = std::move(tmp).unwrap();
 
@@ -0,0 +1,139 @@
+#ifndef RESULT_ALGORITHM_H_3c9d1a47_6e2b_4f80_b5d3_8a1f0e7c2b64
+#define RESULT_ALGORITHM_H_3c9d1a47_6e2b_4f80_b5d3_8a1f0e7c2b64
+
+// 批量处理 Result 的算法, 按需包含:
+//   collect(results)           全部成功时得到 std::vector<T>, 否则返回第一个错误
+//   partition_results(results) 成功值与错误分别放入两个 vector
+//   try_transform(range, f)    f 返回 Result, 遇到第一个错误即停止, 不生成中间的 Result 数组
+// 源为右值时移动载荷, 否则复制; 能预先得到元素个数时一次预留好容量.
+// 多线程版本见 include/parallel.hpp 的 parallel_try_transform.
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "result.h"
+
+namespace result {
+
+template <typename T, typename E>
+struct partitioned {
+    std::vector<T> values;
+    std::vector<E> errors;
+};
+
+namespace details {
+
+template <typename Range, typename = void>
+struct has_size : std::false_type {};
+template <typename Range>
+struct has_size<Range, std::void_t<decltype(std::size(std::declval<const Range&>()))>>
+    : std::true_type {};
+
+template <typename Vector, typename Range>
+void reserve_for(Vector& vector, const Range& range) {
+    if constexpr(has_size<Range>::value) {
+        vector.reserve(static_cast<size_t>(std::size(range)));
+    }
+}
+
+// 元素类型(去掉引用与 cv)
+template <typename Range>
+using range_value_t = std::decay_t<decltype(*std::begin(std::declval<Range&>()))>;
+
+// Range 为右值时移出元素, 否则原样传递
+template <typename Range, typename Element>
+constexpr decltype(auto) forward_element(Element& element) noexcept {
+    if constexpr(std::is_lvalue_reference<Range>::value) {
+        return static_cast<const Element&>(element);
+    } else {
+        return std::move(element);
+    }
+}
+
+} // namespace details
+
+/**
+ * @brief 依次取出各 Result 的值; 遇到第一个 Err 时停止并返回该错误
+ */
+template <typename Range,
+        typename R = details::range_value_t<Range>,
+        std::enable_if_t<is_result<R>::value, int> = 0>
+Result<std::vector<typename R::value_type>, typename R::error_type> collect(Range&& results) {
+    using T = typename R::value_type;
+    using E = typename R::error_type;
+    std::vector<T> values;
+    details::reserve_for(values, results);
+    for(auto& element : results) {
+        if(element.is_err()) {
+            return Result<std::vector<T>, E>(err_tag,
+                    details::forward_element<Range>(element).err_unchecked());
+        }
+        values.push_back(details::forward_element<Range>(element).ok_unchecked());
+    }
+    return Result<std::vector<T>, E>(ok_tag, std::move(values));
+}
+
+/**
+ * @brief 不短路: 所有成功值与所有错误分别按原顺序收集
+ */
+template <typename Range,
+        typename R = details::range_value_t<Range>,
+        std::enable_if_t<is_result<R>::value, int> = 0>
+partitioned<typename R::value_type, typename R::error_type> partition_results(Range&& results) {
+    partitioned<typename R::value_type, typename R::error_type> parts;
+    details::reserve_for(parts.values, results);
+    for(auto& element : results) {
+        if(element.is_ok()) {
+            parts.values.push_back(details::forward_element<Range>(element).ok_unchecked());
+        } else {
+            parts.errors.push_back(details::forward_element<Range>(element).err_unchecked());
+        }
+    }
+    return parts;
+}
+
+/**
+ * @brief 对每个元素调用 fn, 结果直接写入 out; 遇到第一个 Err 时停止, out 中保留之前的结果
+ *
+ * @return 写入结束后的 out
+ */
+template <typename Range, typename OutputIt, typename F,
+        typename R = std::decay_t<std::invoke_result_t<F&, decltype(*std::begin(std::declval<Range&>()))>>>
+Result<OutputIt, typename R::error_type> try_transform(Range&& range, OutputIt out, F fn) {
+    using E = typename R::error_type;
+    for(auto&& element : range) {
+        auto converted = fn(element);
+        if(converted.is_err()) {
+            return Result<OutputIt, E>(err_tag, std::move(converted).err_unchecked());
+        }
+        *out = std::move(converted).ok_unchecked();
+        ++out;
+    }
+    return Result<OutputIt, E>(ok_tag, std::move(out));
+}
+
+/**
+ * @brief 对每个元素调用 fn 并收集成功值; 遇到第一个 Err 时停止并返回该错误
+ */
+template <typename Range, typename F,
+        typename R = std::decay_t<std::invoke_result_t<F&, decltype(*std::begin(std::declval<Range&>()))>>,
+        std::enable_if_t<is_result<R>::value, int> = 0>
+Result<std::vector<typename R::value_type>, typename R::error_type> try_transform(Range&& range, F fn) {
+    using T = typename R::value_type;
+    using E = typename R::error_type;
+    std::vector<T> values;
+    details::reserve_for(values, range);
+    for(auto&& element : range) {
+        auto converted = fn(element);
+        if(converted.is_err()) {
+            return Result<std::vector<T>, E>(err_tag, std::move(converted).err_unchecked());
+        }
+        values.push_back(std::move(converted).ok_unchecked());
+    }
+    return Result<std::vector<T>, E>(ok_tag, std::move(values));
+}
+
+} // namespace result
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef RESULT_OSTREAM_H_5b0e7c2e_8f3a_4d61_9c1e_2a7d4f6b8e10
+#define RESULT_OSTREAM_H_5b0e7c2e_8f3a_4d61_9c1e_2a7d4f6b8e10
+
+// Result 的 std::ostream 输出, 按需包含; result.h 本身不依赖 iostream
+
+#include <ostream>
+#include "result.h"
+
+namespace result {
+
+template <typename T>
+inline std::ostream& operator<<(
+        std::ostream& stream, const std::reference_wrapper<T>& obj);
+
+inline std::ostream& operator<<(std::ostream& stream, unit_t) {
+    stream << "()";
+    return stream;
+}
+
+template <typename T>
+inline std::ostream& operator<<(std::ostream& stream, const Ok<T>& ok) {
+    if constexpr(std::is_same<T, unit_t>::value) {
+        stream << "Ok()";
+    } else {
+        stream << "Ok(" << ok.value() << ")";
+    }
+    return stream;
+}
+template <typename T>
+inline std::ostream& operator<<(std::ostream& stream, const Err<T>& err) {
+    stream << "Err(" << err.value() << ")";
+    return stream;
+}
+
+template <typename T, typename E>
+inline std::ostream& operator<<(
+        std::ostream& stream, const Result<T, E>& result) {
+    switch(result.kind()) {
+    case ResultKind::Ok: {
+        if constexpr(std::is_same<T, unit_t>::value) {
+            stream << "Ok()";
+        } else {
+            stream << "Ok(" << result.ok().value() << ")";
+        }
+        break;
+    }
+    case ResultKind::Err: {
+        stream << "Err(" << result.err().value() << ")";
+        break;
+    }
+    default:
+        stream << "INVALID RESULT";
+        break;
+    }
+    return stream;
+}
+
+template <typename T>
+inline std::ostream& operator<<(
+        std::ostream& stream, const std::reference_wrapper<T>& obj) {
+    stream << obj.get();
+    return stream;
+}
+
+} // namespace result
+
+#endif
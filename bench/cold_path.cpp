@@ -0,0 +1,68 @@
+//
+// Created by ruixuezhao on 25-3-28.
+//
+
+// 冷热分离对调用方代码体积与指令缓存的影响. 每个调用点使用自己的输出函数类型(与传入 lambda 相同),
+// format_to 对每个调用点单独实例化; 调用点轮流执行, 热代码总量超出 L1 指令缓存.
+// CMake 同时构建定义了 STRINGFLOW_NO_COLD 的对照程序, 比较两者的耗时与体积:
+//     ./bench_cold_path && ./bench_cold_path_nocold
+// 单次测量受频率调节与调度影响很大, 程序重复测量 repeats 次, 输出中位数与最小/最大值;
+// 对比两个版本时应交替运行多次, 只看中位数.
+//     size -A CMakeFiles/bench_cold_path*.dir/bench/cold_path.cpp.o | grep text
+// 链接后 .text.unlikely 并入 .text, 热代码与冷代码的体积要在目标文件中看.
+#include <include/format.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <utility>
+
+namespace {
+    constexpr size_t site_count = 128;
+
+    template <size_t I>
+    struct site_sink {
+        char *pos;
+        void operator()(char ch) { *pos++ = ch; }
+    };
+
+    template <size_t I>
+    [[gnu::noinline]] size_t site(char *buffer, int value, double ratio) {
+        site_sink<I> sink{buffer};
+        return StringFlow::format_to(sink, "{}|{:8.3f}|{:>6}", value + int(I), ratio, "ok").unwrap();
+    }
+
+    using site_fn = size_t (*)(char *, int, double);
+
+    template <size_t... I>
+    constexpr std::array<site_fn, sizeof...(I)> make_sites(std::index_sequence<I...>) {
+        return {&site<I>...};
+    }
+}
+
+int main() {
+    static constexpr auto sites = make_sites(std::make_index_sequence<site_count>());
+    constexpr size_t rounds = 4000;
+    constexpr size_t repeats = 15;
+    char buffer[64];
+    size_t total = 0;
+
+    using clock = std::chrono::steady_clock;
+    std::array<double, repeats> samples{};
+    for (double &ns : samples) {
+        const auto start = clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+            for (size_t i = 0; i < site_count; ++i)
+                total += sites[i](buffer, int(round), double(i) / 7);
+        ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (rounds * site_count);
+    }
+    std::sort(samples.begin(), samples.end());
+
+#if defined(STRINGFLOW_NO_COLD)
+    const char *variant = "inline error paths";
+#else
+    const char *variant = "cold error paths";
+#endif
+    StringFlow::println("{:<20} {} call sites  median {:>6.1f} ns/call  (min {:.1f}, max {:.1f}, {} runs, bytes {})",
+                        variant, site_count, samples[repeats / 2], samples.front(), samples.back(), repeats, total)
+        .unwrap();
+}
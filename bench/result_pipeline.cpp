@@ -0,0 +1,72 @@
+//
+// Created by ruixuezhao on 25-3-27.
+//
+
+// 同一条五步的处理链分别用手写 if、成员函数链式调用与 lazy 流水线实现, 比较耗时;
+// 三个函数都不内联, 可用 objdump -d --no-show-raw-insn 对照生成的代码:
+//     objdump -d bench_result_pipeline | c++filt | grep -A40 '<chain_'
+// 步骤用 lambda 而不是函数指针: 保存在流水线中的函数指针 GCC 在 -O2 下不会内联
+#include <include/format.hpp>
+#include <chrono>
+#include <vector>
+
+using namespace result;
+
+namespace {
+    Result<int, int> checked(int v) {
+        if (STRINGFLOW_UNLIKELY(v < 0)) return Err(v);
+        return Ok(v);
+    }
+    Result<int, int> halve_even(int v) {
+        if (STRINGFLOW_UNLIKELY(v & 1)) return Err(1);
+        return Ok(v / 2);
+    }
+}
+
+[[gnu::noinline]] Result<long, long> chain_if(int input) {
+    auto first = checked(input);
+    if (first.is_err()) return Err(long(first.unwrap_err()) - 100);
+    int value = first.unwrap() + 3;
+    auto second = halve_even(value);
+    if (second.is_err()) return Err(long(second.unwrap_err()) - 100);
+    return Ok(long(second.unwrap()) * 7);
+}
+
+[[gnu::noinline]] Result<long, long> chain_members(int input) {
+    return checked(input)
+        .map([](int v) { return v + 3; })
+        .and_then(halve_even)
+        .map([](int v) { return long(v) * 7; })
+        .map_err([](int e) { return long(e) - 100; });
+}
+
+[[gnu::noinline]] Result<long, long> chain_lazy(int input) {
+    return checked(input) | lazy::map([](int v) { return v + 3; }) | lazy::then([](int v) { return halve_even(v); }) |
+           lazy::map([](int v) { return long(v) * 7; }) | lazy::map_err([](int e) { return long(e) - 100; });
+}
+
+template <class Chain>
+static void run(const char *name, Chain chain, const std::vector<int> &inputs) {
+    using clock = std::chrono::steady_clock;
+    long sum = 0;
+    const auto start = clock::now();
+    for (int round = 0; round < 20; ++round)
+        for (int input : inputs) {
+            auto r = chain(input);
+            sum += r.is_ok() ? r.unwrap() : r.unwrap_err();
+        }
+    const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (20.0 * inputs.size());
+    StringFlow::println("{:<14} {:>6.2f} ns/op  (checksum {})", name, ns, sum).unwrap();
+}
+
+int main() {
+    std::vector<int> inputs(1 << 20);
+    unsigned seed = 12345;
+    for (int &input : inputs) {
+        seed = seed * 1103515245u + 12345u;
+        input = int(seed >> 8) % 1000 - 50;  // 约 5% 为负数, 一半为奇数
+    }
+    run("hand-written", chain_if, inputs);
+    run("member chain", chain_members, inputs);
+    run("lazy pipeline", chain_lazy, inputs);
+}
@@ -1,7 +1,30 @@
 #include "tests.h"
 #include "result/result.h"
+#include "result/result_ostream.h"
+#include "result/result_algorithm.h"
 #include <include/format.hpp>
-#include <iostream>
+#include <include/compiled_format.hpp>
+#include <include/ranges.hpp>
+#include <include/hexdump.hpp>
+#include <include/chrono.hpp>
+#include <include/json_writer.hpp>
+#include <include/logging.hpp>
+#include <include/instrument.hpp>
+#include <include/arena.hpp>
+#include <include/parallel.hpp>
+#include <include/vformat.hpp>
+#include <include/queue.hpp>
+#include <system_error>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 void test_result_handling() {
     // 测试Ok状态
@@ -29,4 +52,1082 @@ void test_string_formatting() {
     if (err_fmt.is_err()) {
         StringFlow::println("✅ Format error handling test passed").unwrap();
     }
-}
\ No newline at end of file
+}
+
+void test_static_formatting() {
+    // 编译期格式化, 结果大小恰好为格式化长度 + 1
+    constexpr auto banner = STRINGFLOW_STATIC_FORMAT("v{}.{}.{} [{:>6}] {:x} {:*^7}", 1, 2, 3, "beta", 255, true);
+    static_assert(sizeof(banner) == sizeof("v1.2.3 [  beta] ff *true**"));
+    static_assert(std::string_view(banner.data()) == "v1.2.3 [  beta] ff *true**");
+
+    constexpr auto column = StringFlow::static_format<16>("{1}|{0:.3}", "latency", -42);
+    if (std::string_view(column.data()) == "-42|lat") {
+        StringFlow::println("✅ Static format test passed").unwrap();
+    }
+}
+
+void test_named_arguments() {
+    char buffer[64] = {};
+    size_t size = 0;
+    auto out = [&](char ch) { if (size + 1 < sizeof(buffer)) buffer[size++] = ch; };
+
+    // 调用处绑定名字
+    StringFlow::format_to(out, "{user}@{host}:{0}", StringFlow::arg("user", "root"), StringFlow::arg("host", "db1")).unwrap();
+    const bool inline_ok = std::string_view(buffer, size) == "root@db1:root";
+
+    // 运行期模板 + 预建名字表, 参数按名字表顺序传入
+    static const StringFlow::name_table names{"level", "service", "count"};
+    const char *alert_template = "[{level}] {service} failed {count:x} times";
+    size = 0;
+    StringFlow::format_to(out, names, alert_template, "WARN", "billing", 31).unwrap();
+    bool table_ok = std::string_view(buffer, size) == "[WARN] billing failed 1f times";
+
+    // 预编译时传入名字表, 之后的格式化不再查找名字
+    auto alert = StringFlow::compiled_format::compile(alert_template, &names).unwrap();
+    size = 0;
+    StringFlow::format_to(out, alert, "ERROR", "auth", 255).unwrap();
+    table_ok = table_ok && std::string_view(buffer, size) == "[ERROR] auth failed ff times";
+
+    // 编译期解析名字
+    constexpr auto banner = STRINGFLOW_STATIC_FORMAT("{name} v{major}", StringFlow::arg("major", 2), StringFlow::arg("name", "sf"));
+    static_assert(std::string_view(banner.data()) == "sf v2");
+
+    if (inline_ok && table_ok && names.index_of("count") == 2 && names.index_of("missing") == StringFlow::npos_arg) {
+        StringFlow::println("✅ Named arguments test passed").unwrap();
+    }
+}
+
+void test_compiled_format() {
+    std::string output;
+    auto out = [&](char ch) { output.push_back(ch); };
+
+    // 运行期格式串只解析一次
+    const std::string config_line = "{{{0}}} {1:>5}|{name}";
+    auto tpl = StringFlow::compiled_format::compile(config_line.c_str()).unwrap();
+    StringFlow::format_to(out, tpl, 7, "ab", StringFlow::arg("name", "x")).unwrap();
+    const bool compiled_ok = output == "{7}    ab|x";
+
+    // 全局缓存: 以内容为键, 同样内容的另一份拷贝命中缓存
+    output.clear();
+    const std::string reloaded = config_line;
+    StringFlow::format_to(out, StringFlow::cached(config_line.c_str()), 8, "cd", StringFlow::arg("name", "y")).unwrap();
+    StringFlow::format_to(out, StringFlow::cached(reloaded.c_str()), 9, "ef", StringFlow::arg("name", "z")).unwrap();
+    bool cached_ok = output == "{8}    cd|y{9}    ef|z";
+
+    // 同一地址换了内容不会取到旧模板
+    char line[32] = "<{0}>";
+    output.clear();
+    StringFlow::format_to(out, StringFlow::cached(line), 1).unwrap();
+    memcpy(line, "[{0}]", 6);
+    StringFlow::format_to(out, StringFlow::cached(line), 2).unwrap();
+    cached_ok = cached_ok && output == "<1>[2]";
+
+    // 不匹配的花括号在编译时报告, 错误中带有其偏移
+    auto unmatched = StringFlow::compiled_format::compile("ok {0} {1");
+    const bool error_ok = unmatched.is_err() && unmatched.unwrap_err().code() == StringFlow::format_error::unmatched_brace &&
+                          unmatched.unwrap_err().offset() == 7;
+
+    if (compiled_ok && cached_ok && error_ok) {
+        StringFlow::println("✅ Compiled format test passed").unwrap();
+    }
+}
+
+void test_unicode_alignment() {
+    std::string output;
+    auto out = [&](char ch) { output.push_back(ch); };
+
+    // 中文每个字占两列, 按显示宽度补齐
+    StringFlow::format_to(out, "[{:<6}][{:>6}][{:^7}]", "中文", "ab", "表格").unwrap();
+    const bool cjk_ok = output == "[中文  ][    ab][ 表格  ]";
+
+    // 多字节填充字符与宽字符参数
+    output.clear();
+    StringFlow::format_to(out, "{:★^7}|{:＝>5}|{}{}", u"宽", "x", U'字', L"串").unwrap();
+    const bool wide_ok = output == "★★宽★★★|＝＝x|字串";
+
+    const bool width_ok = StringFlow::display_width("a中b", 5) == 4 &&
+                          StringFlow::display_width("e\u0301", 3) == 1;
+
+    if (cjk_ok && wide_ok && width_ok) {
+        StringFlow::println("✅ Unicode alignment test passed").unwrap();
+    }
+}
+
+// 支持整段写入的输出端, 记录整段写入的次数
+struct span_sink {
+    std::string output;
+    size_t spans = 0;
+    void operator()(char ch) { output.push_back(ch); }
+    void operator()(const char *data, size_t size) { output.append(data, size); ++spans; }
+};
+
+void test_string_arguments() {
+    span_sink sink;
+    const std::string name = "StringFlow";
+    const std::string_view view = std::string_view("formatting library").substr(0, 10);
+    StringFlow::format_to(sink, "{}|{:>12}|{:.6}|{:.3}", name, view, name, std::string("中文字符")).unwrap();
+
+    const bool string_ok = sink.output == "StringFlow|  formatting|String|中";
+    if (string_ok && sink.spans >= 4) {
+        StringFlow::println("✅ String argument test passed").unwrap();
+    }
+}
+
+struct price {
+    long cents;
+};
+
+struct order_id {
+    uint32_t desk;
+    uint32_t sequence;
+};
+
+// 包装类型委托给内置浮点 formatter, 复用其精度与对齐
+template <>
+struct StringFlow::formatter<price> : StringFlow::formatter<double> {
+    template <class Out>
+    result::Result<bool, StringFlow::format_error> format(const price &value, Out &&out) const {
+        return formatter<double>::format(value.cents / 100.0, out);
+    }
+};
+
+// 自定义说明符: {:s} 只输出序号
+template <>
+struct StringFlow::formatter<order_id> {
+    bool short_form = false;
+    StringFlow::formatter<uint32_t> number;
+
+    void parse(const StringFlow::Context &context, const StringFlow::FormatterOption &) {
+        short_form = context.colon && context.colon + 1 < context.end && context.colon[1] == 's';
+        number.parse(context, StringFlow::FormatterOption{'0', StringFlow::Align::Right});
+        number.option.width = 6;
+    }
+
+    template <class Out>
+    result::Result<bool, StringFlow::format_error> format(const order_id &value, Out &&out) const {
+        if (!short_form) {
+            auto desk = StringFlow::formatter<uint32_t>{};
+            desk.option.type = StringFlow::Type::Dec;
+            if (desk.format(value.desk, out).is_err()) return result::Err(StringFlow::format_error::unsupported_type);
+            out('-');
+        }
+        return number.format(value.sequence, out);
+    }
+};
+
+// 记录 parse 调用次数的格式化器
+struct ticket {
+    int number;
+};
+
+static int ticket_parses = 0;
+
+template <>
+struct StringFlow::formatter<ticket> {
+    StringFlow::formatter<int> number;
+
+    void parse(const StringFlow::Context &context, const StringFlow::FormatterOption &option) {
+        ++ticket_parses;
+        number.parse(context, option);
+    }
+
+    template <class Out>
+    result::Result<bool, StringFlow::format_error> format(const ticket &value, Out &&out) const {
+        out('#');
+        return number.format(value.number, out);
+    }
+};
+
+void test_custom_formatter() {
+    std::string output;
+    auto out = [&](char ch) { output.push_back(ch); };
+
+    StringFlow::format_to(out, "{:>8.2}|{}|{:s}", price{12345}, order_id{7, 42}, order_id{7, 43}).unwrap();
+    const bool custom_ok = output == "  123.45|7-000042|000043";
+
+    // 绑定类型的预编译模板: 每个字段的 formatter 只在绑定时 parse 一次
+    auto tpl = StringFlow::compiled_format::compile("{0:03}|{1}|{0:x}|{2:s}").unwrap();
+    auto bound = tpl.bind<ticket, int, order_id>().unwrap();
+    const int parses = ticket_parses;
+    output.clear();
+    for (int i = 0; i < 3; ++i) StringFlow::format_to(out, bound, ticket{26 + i}, i, order_id{1, 9}).unwrap();
+    const bool bound_ok = parses == 2 && ticket_parses == 2 && output == "#026|0|#1a|000009#027|1|#1b|000009#028|2|#1c|000009";
+
+    // 字段下标超出绑定的参数个数时在绑定时报告
+    auto missing = tpl.bind<ticket>();
+    const bool bind_error_ok = missing.is_err() && missing.unwrap_err().field() == 1 && missing.unwrap_err().offset() == 7;
+
+    if (custom_ok && bound_ok && bind_error_ok) {
+        StringFlow::println("✅ Custom formatter test passed").unwrap();
+    }
+}
+
+void test_container_formatting() {
+    std::string output;
+    auto out = [&](char ch) { output.push_back(ch); };
+
+    const std::vector<int> values{1, -2, 30};
+    const std::map<std::string, int> counts{{"a", 1}, {"b", 2}};
+    const std::set<char> letters{'x', 'y'};
+    const std::tuple<int, std::string_view, bool> row{7, "ok", true};
+    const std::optional<double> missing;
+    const result::Result<int, std::string> failed = result::Err(std::string("boom"));
+
+    StringFlow::format_to(out, "{} {::x} {:n} {} {} {} {} {} {}",
+                          values, std::vector<unsigned>{255, 16}, values, counts, letters, row,
+                          missing, failed, std::pair<int, int>{1, 2}).unwrap();
+    const bool basic_ok = output == "[1, -2, 30] [ff, 10] 1, -2, 30 {a: 1, b: 2} {x, y} (7, ok, true) none Err(boom) (1, 2)";
+
+    output.clear();
+    const std::vector<std::vector<int>> nested{{1, 2}, {3}};
+    StringFlow::format_to(out, "{::n:>3}|{:0>2x}|{}", nested, StringFlow::join(std::vector<int>{10, 11}, ":"),
+                          result::Result<std::optional<int>, int>(result::Ok(std::optional<int>(5)))).unwrap();
+    const bool nested_ok = output == "[  1,   2,   3]|0a:0b|Ok(optional(5))";
+
+    // 连续浮点序列走批量路径, 结果与 join 的逐个格式化一致(包括 inf/nan 与科学计数法)
+    const std::vector<double> samples{1.5, -0.25, 0.0, -0.0, 3.14159, 1e6, 1e-5, 2e19, NAN, -INFINITY};
+    const std::vector<float> floats{0.5f, -2.75f};
+    std::string joined;
+    auto join_out = [&](char ch) { joined.push_back(ch); };
+    bool float_ok = true;
+    for (const char *spec : {"{:n}", "{:n:.2}", "{:n:f}", "{:n:.0f}"}) {
+        output.clear();
+        joined.clear();
+        std::string element_spec = std::string("{:") + (spec[3] == ':' ? spec + 4 : "}");
+        StringFlow::format_to(out, spec, samples).unwrap();
+        StringFlow::format_to(join_out, element_spec.c_str(), StringFlow::join(samples, ", ")).unwrap();
+        float_ok = float_ok && output == joined;
+    }
+    output.clear();
+    StringFlow::format_to(out, "{}|{::>7.2f}", floats, floats).unwrap();
+    float_ok = float_ok && output == "[0.500000, -2.750000]|[   0.50,   -2.75]";
+
+    if (basic_ok && nested_ok && float_ok) {
+        StringFlow::println("✅ Container formatting test passed").unwrap();
+    }
+}
+void test_result_panic() {
+    // operator<< 需要显式包含 result_ostream.h
+    std::ostringstream stream;
+    stream << result::Result<int, std::string>(result::Ok(42)) << ' ' << result::Result<int, std::string>(result::Err(std::string("boom")));
+    const bool ostream_ok = stream.str() == "Ok(42) Err(boom)";
+
+#ifndef _WIN32
+    // 在子进程中触发 panic, 检查 stderr 上的错误值与调用位置
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    const unsigned line = __LINE__ + 5;
+    const pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], 2);
+        result::Result<int, StringFlow::format_error> failed = result::Err(StringFlow::format_error::buffer_full);
+        (void)failed.unwrap();
+        _exit(0);
+    }
+    close(fds[1]);
+    char buffer[512] = {};
+    size_t size = 0;
+    for (ssize_t n; size + 1 < sizeof(buffer) && (n = read(fds[0], buffer + size, sizeof(buffer) - 1 - size)) > 0;)
+        size += static_cast<size_t>(n);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    char location[32] = {};
+    StringFlow::format_to_buffer(location, sizeof(location), "tests.cpp:{} ", line);
+    const std::string_view message(buffer, size);
+    const bool panic_ok = WIFSIGNALED(status) && message.find(location) != std::string_view::npos &&
+                          message.find("Called `unwrap` on an Err value: Output buffer full") != std::string_view::npos;
+#else
+    const bool panic_ok = true;
+#endif
+    if (ostream_ok && panic_ok) {
+        StringFlow::println("✅ Result panic test passed").unwrap();
+    }
+}
+
+void test_digit_grouping() {
+    char buffer[128] = {};
+
+    // 固定分隔符, 与 locale 无关
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:,}|{:_}|{:_x}|{:>12,}|{:-,.2f}",
+                                 1234567, -1234567, 0xdeadbeefu, 9876543, 1234567.891);
+    const bool fixed_ok = std::string_view(buffer) == "1,234,567|-1_234_567|dead_beef|   9,876,543|1,234,567.89";
+
+    // 'L' 使用当前线程缓存的 number_facet, 可以是非 3 位的分组规则
+    const StringFlow::number_facet saved = StringFlow::number_facet::thread();
+    StringFlow::digit_grouping indian('.', 3);
+    indian.sizes[1] = 2;
+    indian.count = 2;
+    StringFlow::number_facet::set_thread(StringFlow::number_facet(',', '.', indian));
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:L}|{:-.1Lf}", 12345678, 1234.5);
+    const bool localized_ok = std::string_view(buffer) == "1.23.45.678|1.234,5";
+
+    // count 为 0 时不分组, 超出 sizes 长度时按长度处理
+    StringFlow::digit_grouping none('.', 3);
+    none.count = 0;
+    indian.count = 200;
+    StringFlow::number_facet::set_thread(StringFlow::number_facet(',', '.', none));
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:L}|{:.1Lf}", 12345678, 1234.5);
+    bool count_ok = std::string_view(buffer) == "12345678|1234,5";
+    StringFlow::number_facet::set_thread(StringFlow::number_facet(',', '.', indian));
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:L}", 12345678);
+    count_ok = count_ok && std::string_view(buffer) == "123.45.678";
+    StringFlow::number_facet::set_thread(saved);
+
+    if (fixed_ok && localized_ok && count_ok) {
+        StringFlow::println("✅ Digit grouping test passed").unwrap();
+    }
+}
+
+void test_numeric_format() {
+    char buffer[160] = {};
+
+    // 符号: '-' 只给负数加符号, '+' 总是加符号, ' ' 给非负数留空格
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:-}|{:+}|{: }|{:-}", 42, 42, 42, -42);
+    const bool sign_ok = std::string_view(buffer) == "42|+42| 42|-42";
+
+    // '#' 进制前缀, '0' 补零写在符号与前缀之后, '=' 自定义填充的数值对齐
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:#x}|{:#X}|{:#010b}|{:#o}|{:08}|{:*=+8}|{:#06x}",
+                                 255, 255, 5, 8, -42, 42, 255);
+    const bool integer_ok = std::string_view(buffer) == "0xff|0XFF|0b00000101|0o10|-0000042|+*****42|0x00ff";
+
+    // 浮点数: 补零、g、% 与科学计数法
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:08.2f}|{:g}|{:g}|{:.3g}|{:#g}|{:.1%}|{:e}|{:.0f}|{:#.0f}",
+                                 -3.14159, 0.0001234, 1234567.0, 2.5, 2.5, 0.256, 123.0, 2.5, 2.5);
+    const bool float_ok = std::string_view(buffer) ==
+                          "-0003.14|0.0001234|1.23457e+06|2.5|2.50000|25.6%|1.230000e+02|3|3.";
+
+    // inf/nan: 符号规则与有限值相同, '0'/'=' 不补零
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{}|{:+}|{:>5}|{:08.2f}",
+                                 std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN(),
+                                 -std::numeric_limits<double>::infinity(), std::numeric_limits<float>::infinity());
+    bool special_ok = std::string_view(buffer) == "inf|+nan| -inf|     inf";
+
+    // % 格式的 inf/nan 同样带百分号
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:%}|{:+.1%}|{:>6%}", std::numeric_limits<double>::infinity(),
+                                 std::numeric_limits<double>::quiet_NaN(), -std::numeric_limits<double>::infinity());
+    special_ok = special_ok && std::string_view(buffer) == "inf%|+nan%| -inf%";
+
+    // g 格式的大精度截断到定点格式的 40 位小数, 不会因收窄为 uint8_t 而回绕
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:.255g}", 0.0001234);
+    const std::string widest(buffer);
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:.44g}", 0.0001234);
+    const bool general_ok = widest == buffer && widest.size() == 2 + 40 && widest.compare(0, 8, "0.000123") == 0;
+
+    constexpr auto fixed = STRINGFLOW_STATIC_FORMAT("{:#06x}|{:+05}", 255, 7);
+    static_assert(std::string_view(fixed.data()) == "0x00ff|+0007");
+
+    if (sign_ok && integer_ok && float_ok && special_ok && general_ok) {
+        StringFlow::println("✅ Numeric format test passed").unwrap();
+    }
+}
+
+void test_hexdump() {
+    const char payload[] = "Hello, StringFlow!\x01\xff";
+    std::string dump;
+    auto out = [&](char ch) { dump.push_back(ch); };
+
+    StringFlow::hexdump(out, payload, sizeof(payload) - 1).unwrap();
+    const bool dump_ok = dump ==
+        "00000000  48 65 6c 6c 6f 2c 20 53  74 72 69 6e 67 46 6c 6f  |Hello, StringFlo|\n"
+        "00000010  77 21 01 ff                                       |w!..|\n";
+
+    // 字节序列参数: 连续十六进制、分组与 base64, 超过 16 字节时走整块转换
+    char buffer[160] = {};
+    const std::string blob(40, '\xab');
+    StringFlow::format_to_buffer(buffer, sizeof(buffer), "{:xs}|{:Xs2}|{:b64}|{:b64}|{:b64}|{}",
+                                 StringFlow::bytes("Hello", 5), StringFlow::bytes("Hello", 5),
+                                 StringFlow::bytes("Hello", 5), StringFlow::bytes("Hi", 2),
+                                 StringFlow::bytes("abc", 3), StringFlow::bytes(blob));
+    std::string expected = "48656c6c6f|4865 6C6C 6F|SGVsbG8=|SGk=|YWJj|";
+    for (int i = 0; i < 40; ++i) expected += "ab";
+    const bool span_ok = std::string_view(buffer) == expected;
+
+    if (dump_ok && span_ok) {
+        StringFlow::println("✅ Hexdump test passed").unwrap();
+    }
+}
+
+void test_pointer_format() {
+    constexpr size_t nibbles = sizeof(uintptr_t) * 2;
+    char actual[96] = {};
+
+    // 指针固定输出完整宽度并带 0x 前缀, 与按整数补零格式化地址的结果一致
+    int value = 0;
+    int *pointer = &value;
+    int array[4] = {};
+    const char *text = "text";
+    void (*function)() = &test_pointer_format;
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{}|{}|{:p}|{}", pointer, array, text, function);
+
+    const std::string address_format = "{:#0" + std::to_string(nibbles + 2) + "x}";
+    std::string manual;
+    for (uintptr_t address : {reinterpret_cast<uintptr_t>(pointer), reinterpret_cast<uintptr_t>(&array[0]),
+                              reinterpret_cast<uintptr_t>(text), reinterpret_cast<uintptr_t>(function)}) {
+        char field[32] = {};
+        StringFlow::format_to_buffer(field, sizeof(field), address_format.c_str(), address);
+        manual += manual.empty() ? field : std::string("|") + field;
+    }
+    const bool address_ok = std::string_view(actual) == manual;
+
+    // nullptr、大写与不带前缀的形式
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{}|{:X}", nullptr, static_cast<void *>(nullptr));
+    const bool null_ok = std::string_view(actual) == "0x" + std::string(nibbles, '0') + "|" + std::string(nibbles, '0');
+
+    // 64 位整数的完整二进制输出
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:b}", UINT64_MAX);
+    const bool binary_ok = std::string_view(actual) == std::string(64, '1');
+
+    if (address_ok && null_ok && binary_ok) {
+        StringFlow::println("✅ Pointer format test passed").unwrap();
+    }
+}
+
+void test_chrono_format() {
+    using namespace std::chrono;
+    char actual[96] = {};
+
+    // 2024-02-29 23:59:58.123456789 UTC, 闰日与跨年边界
+    const time_point<system_clock, nanoseconds> stamp{seconds{1709251198} + nanoseconds{123456789}};
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:%Y-%m-%dT%H:%M:%S.%f}|{}", stamp,
+                                 time_point_cast<milliseconds>(stamp));
+    const bool point_ok = std::string_view(actual) == "2024-02-29T23:59:58.123456|2024-02-29 23:59:58.123";
+
+    // 同一分钟内命中缓存, 只改写秒与小数秒
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:%F %T.%3f}", stamp + milliseconds{1500});
+    bool cache_ok = std::string_view(actual) == "2024-02-29 23:59:59.623";
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:%F %T.%3f}", stamp + seconds{2});
+    cache_ok = cache_ok && std::string_view(actual) == "2024-03-01 00:00:00.123";
+
+    // 1970 年以前与公历的整数换算
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:%F %T %Z}", system_clock::time_point{seconds{-1}});
+    bool civil_ok = std::string_view(actual) == "1969-12-31 23:59:59 UTC";
+    for (int64_t days : {-719468, -1, 0, 11016, 2932896}) {
+        const auto date = StringFlow::details::civil_from_days(days);
+        const int64_t y = date.year - (date.month <= 2);
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const int64_t yoe = y - era * 400;
+        const int64_t doy = (153 * (date.month + (date.month > 2 ? -3 : 9)) + 2) / 5 + date.day - 1;
+        civil_ok = civil_ok && era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468 == days;
+    }
+
+    // duration: 数值加单位, 或按 %H:%M:%S 输出经过的时间
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{}|{:>6}|{}|{:%H:%M:%S.%3f}", milliseconds{15}, seconds{3},
+                                 duration<int, std::ratio<1, 30>>{2}, -(hours{26} + milliseconds{61500}));
+    const bool duration_ok = std::string_view(actual) == "15ms|    3s|2[1/30]s|-26:01:01.500";
+
+    // 不含 '%' 的说明只控制对齐与宽度
+    StringFlow::format_to_buffer(actual, sizeof(actual), "[{:>25}][{:*<21}]", time_point_cast<milliseconds>(stamp),
+                                 time_point_cast<seconds>(stamp));
+    const bool align_ok = std::string_view(actual) == "[  2024-02-29 23:59:58.123][2024-02-29 23:59:58**]";
+
+    // 可缓存的格式中补丁数量不受限: 缓存命中后每个 %S 都被改写
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:%S%S%S%S%S%S%S%S%S%S}", stamp);
+    StringFlow::format_to_buffer(actual, sizeof(actual), "{:%S%S%S%S%S%S%S%S%S%S}", stamp + seconds{1});
+    const bool patch_ok = std::string_view(actual) == "59595959595959595959";
+
+    if (point_ok && cache_ok && civil_ok && duration_ok && align_ok && patch_ok) {
+        StringFlow::println("✅ Chrono format test passed").unwrap();
+    }
+}
+
+void test_escape_format() {
+    std::string actual;
+    auto append = [&](char ch) { actual.push_back(ch); };
+
+    // {:j}: 引号、反斜杠与控制字符转义, 超过 16 字节的干净片段整段拷贝, 多字节字符原样保留
+    const std::string text = std::string("say \"hi\"\\ 你好\n\t") + '\x01' + " and a long clean tail of text";
+    StringFlow::format_to(append, "{:j}|{:>8j}|{:.3j}", text, "a\"b", std::string_view("abcdef")).unwrap();
+    const bool json_ok = actual == "\"say \\\"hi\\\"\\\\ 你好\\n\\t\\u0001 and a long clean tail of text\"|  \"a\\\"b\"|\"abc\"";
+
+    // {:q}: 只有含 ',' '"' 或换行的字段加引号
+    actual.clear();
+    StringFlow::format_to(append, "{:q},{:q},{:q}", "plain", "a,b", "the \"quoted\" word, again and again").unwrap();
+    const bool csv_ok = actual == "plain,\"a,b\",\"the \"\"quoted\"\" word, again and again\"";
+
+    // json_writer 自动插入逗号与冒号
+    actual.clear();
+    StringFlow::json_writer json(append);
+    json.begin_object().key("name").value("String\"Flow").key("n").value(-3).key("pi").value(3.25)
+        .key("list").begin_array().value(true).value(nullptr).begin_object().end_object().value(NAN).end_array()
+        .end_object();
+    const bool writer_ok = json.finish().is_ok() &&
+                           actual == "{\"name\":\"String\\\"Flow\",\"n\":-3,\"pi\":3.25,\"list\":[true,null,{},null]}";
+
+    // 结构错误
+    StringFlow::json_writer broken(append);
+    broken.begin_array().key("oops");
+    const bool error_ok = broken.finish().is_err();
+
+    if (json_ok && csv_ok && writer_ok && error_ok) {
+        StringFlow::println("✅ Escape format test passed").unwrap();
+    }
+}
+
+void test_structured_logging() {
+    enum class region { north = 1, south = 2 };
+    static const StringFlow::log_event<std::string_view, int, double, bool, region> request{
+        StringFlow::log_level::warn, "user {user} got {status} in {elapsed:.2f}ms", "user", "status", "elapsed", "cached",
+        "region"};
+
+    std::string actual;
+    auto append = [&](char ch) { actual.push_back(ch); };
+
+    request.text(append, "ali\"ce", -404, 12.345, true, region::south).unwrap();
+    const bool text_ok = actual == "WARN user ali\"ce got -404 in 12.35ms\n";
+
+    actual.clear();
+    request.json(append, "ali\"ce", -404, 12.345, true, region::south).unwrap();
+    const bool json_ok = actual == "{\"level\":\"WARN\",\"msg\":\"user {user} got {status} in {elapsed:.2f}ms\","
+                                   "\"user\":\"ali\\\"ce\",\"status\":-404,\"elapsed\":12.345,\"cached\":true,\"region\":2}\n";
+
+    // 二进制记录只含编号与字段值, 解码时按编号取回字段名与类型
+    std::string records;
+    auto record_sink = [&](char ch) { records.push_back(ch); };
+    const size_t first = request.binary(record_sink, "bob", 200, 0.5, false, region::north).unwrap();
+    request.binary(record_sink, "ali\"ce", -404, 12.345, true, region::south).unwrap();
+    const bool size_ok = first == 4 + 4 + (1 + 3) + 2 + 8 + 1 + 1 && records.size() == first + 27;
+
+    std::string fields;
+    const size_t consumed = StringFlow::decode_log_record(records.data(), records.size(),
+        [&](const StringFlow::log_site &site, size_t index, const StringFlow::log_value &value) {
+            fields += site.field_name(index) + "=";
+            if (value.type == StringFlow::log_field_type::string) fields += std::string(value.string);
+            if (value.type == StringFlow::log_field_type::signed_) fields += std::to_string(value.signed_);
+            fields += ";";
+        }).unwrap();
+    const bool decode_ok = consumed == first && fields == "user=bob;status=200;elapsed=;cached=;region=1;";
+
+    actual.clear();
+    StringFlow::render_log_record(append, records.data() + first, records.size() - first).unwrap();
+    const bool render_ok = actual == "WARN user ali\"ce got -404 in 12.35ms\n" &&
+                           StringFlow::decode_log_record(records.data(), 6, [](auto &&...) {}).is_err();
+
+    // 每种支持的字段类型: 二进制记录还原出的文本与 text 逐字节相同; 没有字段的事件同样可以还原
+    auto round_trip = [](const auto &event, const auto &...fields) {
+        std::string text, binary, rendered;
+        auto text_sink = [&](char ch) { text.push_back(ch); };
+        auto binary_sink = [&](char ch) { binary.push_back(ch); };
+        auto render_sink = [&](char ch) { rendered.push_back(ch); };
+        event.text(text_sink, fields...).unwrap();
+        event.binary(binary_sink, fields...).unwrap();
+        return StringFlow::render_log_record(render_sink, binary.data(), binary.size()).is_ok() && text == rendered;
+    };
+    enum class flag : uint8_t { on = 'Y' };
+    static const StringFlow::log_event<> started{StringFlow::log_level::info, "server started"};
+    static const StringFlow::log_event<bool, char, signed char, uint8_t, int8_t, flag, region> chars{
+        StringFlow::log_level::debug, "{b} {c} {s} {u} {i} {f} {r} {u:d} {i:d} {c:x} {s:#x}",
+        "b", "c", "s", "u", "i", "f", "r"};
+    static const StringFlow::log_event<int16_t, uint16_t, int, unsigned, int64_t, uint64_t> integers{
+        StringFlow::log_level::trace, "{0} {1} {2:+} {3:#x} {4} {5:,} {2:b} {0:x}", "a", "b", "c", "d", "e", "f"};
+    static const StringFlow::log_event<float, double, float> floats{
+        StringFlow::log_level::error, "{0} {1:.3e} {2:g} {0:.10f} {1:%}", "f", "d", "g"};
+    static const StringFlow::log_event<const char *, std::string, std::string_view, wchar_t, char16_t, char32_t> texts{
+        StringFlow::log_level::fatal, "{0} {1:>6} {2:j} {3} {4} {5} {5:x}", "p", "s", "v", "w", "h", "u"};
+    const bool round_trip_ok =
+        round_trip(started) &&
+        round_trip(chars, true, 'x', static_cast<signed char>(-3), uint8_t(200), int8_t(-1), flag::on, region::north) &&
+        round_trip(chars, false, '\0', static_cast<signed char>('A'), uint8_t(65), int8_t(127), flag::on, region::south) &&
+        round_trip(integers, int16_t(-32768), uint16_t(65535), -7, 255u, INT64_MIN, UINT64_MAX) &&
+        round_trip(floats, 0.1f, -2.5e10, 1e-7f) &&
+        round_trip(texts, "ptr", std::string("str"), std::string_view("a\"b"), L'\u00e9', u'\u4e2d', U'\U0001F600');
+    if (text_ok && json_ok && size_ok && decode_ok && render_ok && round_trip_ok) {
+        StringFlow::println("✅ Structured logging test passed").unwrap();
+    }
+}
+
+void test_format_error_reporting() {
+    using StringFlow::error_policy;
+    using StringFlow::format_error;
+    std::string actual;
+    auto append = [&](char ch) { actual.push_back(ch); };
+
+    // 缺省在第一个出错的字段处停止, 错误带有字段序号与字节偏移
+    auto stopped = StringFlow::format_to(append, "a={} b={:x} c={}", 1, 2.5, 3);
+    const auto error = stopped.unwrap_err();
+    const bool stop_ok = actual == "a=1 b=" && error == format_error::type_mismatch && error.field() == 1 &&
+                         error.offset() == 7 && sizeof(error) == sizeof(uint64_t);
+
+    // report 继续输出, 返回第一个错误; ignore 只统计成功的字段
+    actual.clear();
+    auto reported = StringFlow::format_to(append, error_policy::report, "{:x}|{}|{}", 2.5, 7, "x");
+    const bool report_ok = actual == "|7|x" && reported.unwrap_err().field() == 0 &&
+                           reported.unwrap_err().offset() == 0;
+    actual.clear();
+    const bool ignore_ok = StringFlow::format_to(append, error_policy::ignore, "{:x}|{}", 2.5, 7).unwrap() == 1;
+
+    // 参数不足、花括号不匹配与预编译模板
+    actual.clear();
+    auto missing = StringFlow::format_to(append, "{} {}", 1);
+    auto unmatched = StringFlow::format_to(append, "ok {} {", 1);
+    auto tpl = StringFlow::compiled_format::compile("[{}] {:p}").unwrap();
+    auto compiled = StringFlow::format_to(append, tpl, 1, 2.0);
+    const bool position_ok = missing.unwrap_err() == format_error::argument_index_out_of_range &&
+                             missing.unwrap_err().offset() == 3 && unmatched.unwrap_err().offset() == 6 &&
+                             unmatched.unwrap_err().field() == 1 && compiled.unwrap_err().offset() == 5;
+
+    // 错误说明包含位置
+    char text[128] = {};
+    StringFlow::format_to_buffer(text, sizeof(text), "{}", error);
+    const bool text_ok = std::string_view(text) == "Type mismatch between format specifier and argument (field 1, offset 7)";
+
+    if (stop_ok && report_ok && ignore_ok && position_ok && text_ok) {
+        StringFlow::println("✅ Format error reporting test passed").unwrap();
+    }
+}
+
+void test_instrumentation() {
+    // 直方图: 桶的上界覆盖桶内所有值, 分位数误差不超过 12.5%
+    using histogram = StringFlow::latency_histogram;
+    bool histogram_ok = histogram::bucket_of(7) == 7 && histogram::bucket_of(8) == 8 && histogram::bucket_of(17) == 16;
+    for (uint64_t value : {0ull, 9ull, 100ull, 12345ull, 999999ull, 123456789ull})
+        histogram_ok = histogram_ok && histogram::bucket_upper(histogram::bucket_of(value)) >= value &&
+                       histogram::bucket_upper(histogram::bucket_of(value)) <= value + value / 8;
+    histogram samples;
+    for (uint64_t i = 1; i <= 1000; ++i) samples.record(i * 1000);
+    const uint64_t p50 = samples.percentile(0.5);
+    histogram_ok = histogram_ok && p50 >= 500000 && p50 <= 562500 && samples.max() == 1000000;
+
+    // 两个线程经过同一个调用处, 快照汇总各线程的分片
+    static StringFlow::call_site site(__FILE__, __LINE__);
+    auto run = [] {
+        std::string sink;
+        auto append = [&](char ch) { sink.push_back(ch); };
+        for (int i = 0; i < 100; ++i) StringFlow::instrumented_format_to(site, append, "id={:04}", i).unwrap();
+        const bool failed = StringFlow::instrumented_format_to(site, append, "id={:04}").is_err();
+        (void)failed;
+    };
+    std::thread worker(run);
+    run();
+    worker.join();
+
+    StringFlow::call_site_stats stats;
+    for (const auto &row : StringFlow::instrument_registry::global().snapshot())
+        if (row.site == &site) stats = row;
+    const bool stats_ok = stats.calls == 202 && stats.bytes == 2 * (100 * 7 + 3) && stats.errors == 2 &&
+                          stats.latency.count() == 202 && std::string_view(site.format()) == "id={:04}";
+
+    // 已退出线程的分片由之后的线程接管: 先让一个线程退出, 保证至少有一个空闲分片, 之后的线程不再分配
+    std::thread(run).join();
+    const size_t shards = site.shard_count();
+    std::thread(run).join();
+    std::thread(run).join();
+    bool lifetime_ok = site.shard_count() == shards;
+
+    // 析构的调用处从登记表注销; 调用处可以先于或晚于写入它的线程析构
+    unsigned scoped_line = 0, inner_line = 0;
+    {
+        StringFlow::call_site scoped(__FILE__, scoped_line = __LINE__);
+        std::thread([&scoped] { scoped.record(10, 1, false); }).join();
+    }
+    std::thread([&inner_line] {
+        {
+            StringFlow::call_site inner(__FILE__, inner_line = __LINE__);
+            inner.record(10, 1, false);
+        }
+        // 线程退出时分片表不再访问 inner 已释放的分片
+    }).join();
+    for (const auto &row : StringFlow::instrument_registry::global().snapshot())
+        lifetime_ok = lifetime_ok && !((row.line == scoped_line || row.line == inner_line) &&
+                                       row.file == std::string_view(__FILE__));
+
+    // 通过 StringFlow 输出表格
+    std::string table;
+    auto append = [&](char ch) { table.push_back(ch); };
+    StringFlow::instrument_registry::global().dump(append).unwrap();
+    const bool dump_ok = table.find("\"id={:04}\"") != std::string::npos && table.find("p99(ns)") != std::string::npos;
+
+    // 宏在未定义 STRINGFLOW_INSTRUMENT 时就是 format_to
+    std::string plain;
+    auto plain_sink = [&](char ch) { plain.push_back(ch); };
+    STRINGFLOW_FORMAT_TO(plain_sink, "{}-{}", 1, 2).unwrap();
+
+    if (histogram_ok && stats_ok && lifetime_ok && dump_ok && plain == "1-2") {
+        StringFlow::println("✅ Instrumentation test passed").unwrap();
+    }
+}
+
+void test_arena_format() {
+    // 错误说明为静态字符串
+    constexpr std::string_view message = StringFlow::format_error_to_string(StringFlow::format_error::buffer_full);
+    const bool message_ok = message == "Output buffer full";
+
+    // 默认分配器与 arena: 第一块为栈上缓冲区, 不够时申请新块, reset 后从头复用
+    const bool plain_ok = StringFlow::format("{}-{:x}", "id", 255).unwrap() == "id-ff";
+    alignas(std::max_align_t) char stack[256];
+    StringFlow::bump_arena arena(stack, sizeof(stack), 256);
+    const StringFlow::arena_allocator<char> allocator(arena);
+    auto first = StringFlow::format(allocator, "user={} code={}", "alice", 404).unwrap();
+    const char *first_data = first.data();
+    const bool in_stack = first_data >= stack && first_data < stack + sizeof(stack);
+    auto large = StringFlow::format(allocator, "{:->200}", "x").unwrap();
+    const bool arena_ok = in_stack && first == "user=alice code=404" && large.size() == 200 &&
+                          arena.capacity() > sizeof(stack) && arena.used() >= 200;
+
+    arena.reset();
+    auto again = StringFlow::format(allocator, "user={} code={}", "bob", 200).unwrap();
+    bool reset_ok = again.data() == first_data && again == "user=bob code=200";
+
+    // 只有最近一次分配在释放时收回
+    void *older = arena.allocate(16);
+    void *latest = arena.allocate(16);
+    arena.deallocate(older, 16);
+    arena.deallocate(latest, 16);
+    reset_ok = reset_ok && arena.allocate(16) == latest;
+
+    bool pmr_ok = true;
+#if defined(STRINGFLOW_HAS_PMR)
+    StringFlow::arena_resource resource(arena);
+    auto pmr_text = StringFlow::format(&resource, "{:.2f}", 3.14159).unwrap();
+    pmr_ok = pmr_text == "3.14" && StringFlow::format(&resource, "{} {}", 1).is_err();
+#endif
+
+    if (message_ok && plain_ok && arena_ok && reset_ok && pmr_ok) {
+        StringFlow::println("✅ Arena format test passed").unwrap();
+    }
+}
+
+void test_parallel_format() {
+    std::vector<std::tuple<int, std::string>> rows;
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        rows.emplace_back(i, "row" + std::to_string(i % 7));
+        expected += std::to_string(i) + ",row" + std::to_string(i % 7) + "\n";
+    }
+
+    // 小块 + 小窗口, 让多个线程交错完成, 输出仍需按顺序
+    StringFlow::parallel_options options;
+    options.threads = 4;
+    options.chunk_records = 16;
+    options.window = 3;
+    std::string streamed;
+    auto append = [&](const char *data, size_t size) { streamed.append(data, size); };
+    auto lines = StringFlow::parallel_format_lines(rows, "{},{}", append, options);
+    const bool stream_ok = lines.is_ok() && lines.unwrap() == rows.size() && streamed == expected;
+
+    // 两遍写入一块连续内存
+    std::vector<char> region;
+    auto written = StringFlow::parallel_format_lines_into(rows, "{},{}", [&](size_t total) {
+        region.resize(total);
+        return region.data();
+    }, options);
+    const bool into_ok = written.is_ok() && written.unwrap() == expected.size() &&
+                         std::string(region.begin(), region.end()) == expected;
+
+    // 单个参数的记录; 参数不足时返回错误
+    std::vector<int> numbers{1, 2, 3};
+    std::string single;
+    auto append_single = [&](char ch) { single.push_back(ch); };
+    StringFlow::parallel_format_lines(numbers, "{:02}", append_single).unwrap();
+    std::string ignored;
+    auto append_ignored = [&](char ch) { ignored.push_back(ch); };
+    auto failed = StringFlow::parallel_format_lines(numbers, "{}{}", append_ignored, options);
+    const bool error_ok = single == "01\n02\n03\n" && failed.is_err() &&
+                          failed.unwrap_err().code() == StringFlow::format_error::argument_index_out_of_range;
+
+    // {:L} 使用调用线程的 number_facet, 工作线程的输出与两遍的长度都与之一致
+    const StringFlow::number_facet saved = StringFlow::number_facet::thread();
+    StringFlow::number_facet::set_thread(StringFlow::number_facet(',', '.', StringFlow::digit_grouping('.', 3)));
+    std::vector<int> amounts(20000);
+    std::string grouped;
+    for (size_t i = 0; i < amounts.size(); ++i) {
+        amounts[i] = static_cast<int>(i * 7919);
+        grouped += StringFlow::format("{:L}\n", amounts[i]).unwrap();
+    }
+    std::string localized;
+    auto append_localized = [&](const char *data, size_t size) { localized.append(data, size); };
+    StringFlow::parallel_format_lines(amounts, "{:L}", append_localized, options).unwrap();
+    std::vector<char> localized_region;
+    auto localized_written = StringFlow::parallel_format_lines_into(amounts, "{:L}", [&](size_t total) {
+        localized_region.resize(total);
+        return localized_region.data();
+    }, options);
+    StringFlow::number_facet::set_thread(saved);
+    const bool facet_ok = localized == grouped && localized_written.is_ok() &&
+                          std::string(localized_region.begin(), localized_region.end()) == grouped;
+
+    if (stream_ok && into_ok && error_ok && facet_ok) {
+        StringFlow::println("✅ Parallel format test passed").unwrap();
+    }
+}
+
+static std::string vformat_function_output;
+
+static int vformat_function_sink(int ch) {
+    vformat_function_output.push_back(static_cast<char>(ch));
+    return ch;
+}
+
+void test_vformat() {
+    // 与 format_to 的输出一致
+    const std::string name = "alice";
+    auto text = StringFlow::vformat("{}:{:>5}|{:.2f}|{:#x}|{}|{:^5}|",
+                                    StringFlow::make_format_args(name, 42, 3.14159, 255u, true, 'c'));
+    const bool text_ok = text.is_ok() && text.unwrap() == "alice:   42|3.14|0xff|true|  c  |";
+
+    // 具名参数与自定义输出函数, 超过内部缓冲区的长文本
+    std::string out;
+    auto append = [&](char ch) { out.push_back(ch); };
+    const std::string long_text(600, 'x');
+    auto written = StringFlow::vformat_to(append, "{user}@{host} {2}",
+                                          StringFlow::make_format_args(StringFlow::arg("user", "bob"),
+                                                                       StringFlow::arg("host", std::string_view("db1")),
+                                                                       long_text));
+    const bool sink_ok = written.is_ok() && written.unwrap() == 3 && out == "bob@db1 " + long_text;
+
+    // 错误位置与 format_to 相同
+    auto missing = StringFlow::vformat("a{}b{}", StringFlow::make_format_args(1));
+    const bool error_ok = missing.is_err() &&
+                          missing.unwrap_err().code() == StringFlow::format_error::argument_index_out_of_range &&
+                          missing.unwrap_err().field() == 1 && missing.unwrap_err().offset() == 4;
+
+    // 字符类参数的输出与 format_to 逐字节相同: 单字节整数按字符输出, 宽字符编码为 UTF-8, d/x 输出原值
+    const char *char_format = "{}|{}|{}|{}|{}|{}|{:d}|{:d}|{:x}|{:d}|{:x}";
+    std::string expected;
+    auto expected_sink = [&](char ch) { expected.push_back(ch); };
+    StringFlow::format_to(expected_sink, char_format, uint8_t(65), int8_t(66), static_cast<signed char>(-3), L'\u00e9',
+                          u'\u4e2d', U'\U0001F600', uint8_t(200), static_cast<signed char>(-3), uint8_t(255), u'\u4e2d',
+                          L'\u00e9').unwrap();
+    auto chars = StringFlow::vformat(char_format, StringFlow::make_format_args(
+        uint8_t(65), int8_t(66), static_cast<signed char>(-3), L'\u00e9', u'\u4e2d', U'\U0001F600', uint8_t(200),
+        static_cast<signed char>(-3), uint8_t(255), u'\u4e2d', L'\u00e9'));
+    const bool chars_ok = chars.is_ok() && chars.unwrap() == expected && expected.compare(0, 4, "A|B|") == 0;
+
+    // 普通函数作为输出函数
+    vformat_function_output.clear();
+    auto by_function = StringFlow::vformat_to(vformat_function_sink, "{}-{}", StringFlow::make_format_args(7, "x"));
+    const bool function_ok = by_function.is_ok() && vformat_function_output == "7-x";
+
+    if (text_ok && sink_ok && error_ok && chars_ok && function_ok) {
+        StringFlow::println("✅ Vformat test passed").unwrap();
+    }
+}
+
+void test_record_queue() {
+    // 单生产者: 直接格式化进预留的空间, 绕回、满、超长与丢弃
+    StringFlow::spsc_queue spsc(128);
+    bool spsc_ok = spsc.capacity() == 128 && spsc.max_record_size() == 56;
+    for (int round = 0; round < 20 && spsc_ok; ++round) {
+        auto slot = spsc.try_reserve(40).unwrap();
+        StringFlow::format_to(slot, "round {:02}", round).unwrap();
+        spsc_ok = slot.commit().unwrap() == 8;
+        auto record = spsc.try_pop().unwrap();
+        spsc_ok = spsc_ok && record.view() == StringFlow::format("round {:02}", round).unwrap();
+    }
+    int pushed = 0;
+    while (spsc.try_push("12345678", 8).is_ok()) ++pushed;
+    spsc_ok = spsc_ok && pushed == 8 && spsc.try_push("x", 1).unwrap_err() == StringFlow::queue_error::full &&
+              spsc.try_reserve(57).unwrap_err() == StringFlow::queue_error::too_large;
+    for (int i = 0; i < pushed; ++i) spsc_ok = spsc_ok && spsc.try_pop().unwrap().view() == "12345678";
+
+    spsc_ok = spsc_ok && spsc.try_push("abc", 3).is_ok();
+    {
+        auto dropped = spsc.try_reserve(8).unwrap();  // 未提交, 析构时丢弃
+        dropped("xyz", 3);
+    }
+    auto overflow = spsc.try_reserve(8).unwrap();
+    StringFlow::format_to(overflow, "{}", 1234567890).unwrap();
+    spsc_ok = spsc_ok && overflow.commit().unwrap_err() == StringFlow::queue_error::too_large &&
+              spsc.try_push("def", 3).is_ok();
+    // 记录在析构时才归还, 同一时刻只取一条
+    spsc_ok = spsc_ok && spsc.try_pop().unwrap().view() == "abc";
+    spsc_ok = spsc_ok && spsc.try_pop().unwrap().view() == "def";
+    spsc_ok = spsc_ok && spsc.try_pop().unwrap_err() == StringFlow::queue_error::empty;
+
+    // 多生产者: 每个生产者的记录按提交顺序到达, 总数不丢
+    StringFlow::mpsc_queue mpsc(4096);
+    constexpr int producers = 4, per_producer = 5000;
+    std::vector<std::thread> threads;
+    for (int id = 0; id < producers; ++id) {
+        threads.emplace_back([&mpsc, id] {
+            for (int i = 0; i < per_producer;) {
+                auto slot = mpsc.try_reserve(32);
+                if (slot.is_err()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                auto reserved = std::move(slot).unwrap();
+                StringFlow::format_to(reserved, "{} {}", id, i).unwrap();
+                reserved.commit().unwrap();
+                ++i;
+            }
+        });
+    }
+    int next[producers] = {};
+    int received = 0;
+    bool mpsc_ok = true;
+    while (received < producers * per_producer && mpsc_ok) {
+        auto record = mpsc.try_pop();
+        if (record.is_err()) {
+            std::this_thread::yield();
+            continue;
+        }
+        int id = 0, value = 0;
+        std::istringstream(std::string(record.unwrap().view())) >> id >> value;
+        mpsc_ok = id >= 0 && id < producers && value == next[id]++;
+        ++received;
+    }
+    for (auto &thread : threads) thread.join();
+    mpsc_ok = mpsc_ok && mpsc.try_pop().is_err();
+
+    if (spsc_ok && mpsc_ok) {
+        StringFlow::println("✅ Record queue test passed").unwrap();
+    }
+}
+
+namespace {
+    enum class storage_error { ok, timeout, corrupted };
+    constexpr std::string_view storage_messages[] = {"Success", "Operation timed out", "Data corrupted"};
+    const StringFlow::error_category storage_category("storage", storage_messages);
+    const StringFlow::error_category &error_category_of(storage_error) { return storage_category; }
+}
+
+void test_error_code() {
+    // 说明表在编译期可用, 错误码只有 8 字节, Result 仍为两个字
+    static_assert(StringFlow::format_error_to_string(StringFlow::format_error::buffer_full) == "Output buffer full");
+    static_assert(StringFlow::queue_error_to_string(StringFlow::queue_error::empty) == "Queue empty");
+    static_assert(sizeof(StringFlow::error_code) == 8);
+    static_assert(sizeof(result::Result<uint64_t, StringFlow::error_code>) == 16);
+
+    // 不同子系统的错误码汇总到同一类型
+    std::vector<StringFlow::error_code> codes{StringFlow::format_error::unmatched_brace, StringFlow::queue_error::full,
+                                              storage_error::corrupted};
+    const bool category_ok = codes[0].category().name() == "format" && codes[1].message() == "Queue full" &&
+                             codes[2].message() == "Data corrupted" && codes[2] == storage_error::corrupted &&
+                             codes[2] != storage_error::timeout && !StringFlow::error_code() &&
+                             StringFlow::error_code(1, storage_category) == storage_error::timeout &&
+                             StringFlow::error_code(7, storage_category).message() == "Unknown error code";
+    const bool text_ok = StringFlow::format("{}|{}", codes[1], StringFlow::error_code()).unwrap() ==
+                         "queue: Queue full|generic: Success";
+
+    // 与 std::error_code 互通
+    std::error_code std_code = codes[2].to_std();
+    std::error_code direct = StringFlow::format_error::buffer_full;
+    const bool std_ok = std_code.message() == "Data corrupted" && std::string_view(std_code.category().name()) == "storage" &&
+                        StringFlow::error_code::from_std(std_code) == storage_error::corrupted &&
+                        direct.message() == "Output buffer full" &&
+                        StringFlow::error_code::from_std(std::make_error_code(std::errc::timed_out)).category().name() == "generic";
+
+#ifndef _WIN32
+    // 类别超过 max_categories 时在子进程中 panic, 而不是退回 generic
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    const pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], 2);
+        for (uint32_t i = 0; i <= StringFlow::error_category::max_categories; ++i)
+            (void)StringFlow::error_code(1, *new StringFlow::error_category("overflow", storage_messages));
+        _exit(0);
+    }
+    close(fds[1]);
+    char buffer[512] = {};
+    size_t size = 0;
+    for (ssize_t n; size + 1 < sizeof(buffer) && (n = read(fds[0], buffer + size, sizeof(buffer) - 1 - size)) > 0;)
+        size += static_cast<size_t>(n);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    const bool limit_ok = WIFSIGNALED(status) &&
+                          std::string_view(buffer, size).find("too many error categories: overflow") != std::string_view::npos;
+#else
+    const bool limit_ok = true;
+#endif
+
+    if (category_ok && text_ok && std_ok && limit_ok) {
+        StringFlow::println("✅ Error code test passed").unwrap();
+    }
+}
+
+namespace {
+    Result<int, std::string> parse_digit(char ch) {
+        if (ch < '0' || ch > '9') return Err(std::string("not a digit: ") + ch);
+        return Ok(ch - '0');
+    }
+}
+
+void test_result_pipeline() {
+    using namespace result;
+
+    // 右值链式调用移动载荷, 只能移动的类型也可以一路传下去
+    auto moved = Result<std::unique_ptr<int>, std::string>(ok_tag, std::make_unique<int>(21))
+        .map([](std::unique_ptr<int> p) { *p *= 2; return p; })
+        .and_then([](std::unique_ptr<int> p) -> Result<int, std::string> { return Ok(*p); })
+        .map_err([](std::string e) { return e.size(); });
+    // 左值调用复制载荷, 原对象不受影响
+    const Result<std::string, int> source(Ok(std::string("stringflow")));
+    auto copied = source.map([](const std::string &s) { return s.size(); });
+    const bool member_ok = moved.unwrap() == 42 && copied.unwrap() == 10 && source.try_ok() == "stringflow";
+
+    // 惰性流水线: 进入 Err 一侧后跳过之后的 then/map, 直到 map_err/or_else
+    auto scale = lazy::map([](int v) { return v * 10; });
+    auto steps = lazy::then([](int v) -> Result<int, std::string> {
+                     if (v == 0) return Err(std::string("zero"));
+                     return Ok(v);
+                 }) | scale | lazy::map_err([](const std::string &e) { return "digit: " + e; });
+    Result<int, std::string> good = parse_digit('7') | steps;
+    Result<int, std::string> zero = parse_digit('0') | steps;
+    Result<int, std::string> bad = parse_digit('x') | steps;
+    Result<int, size_t> recovered = parse_digit('x') | lazy::map_err([](std::string e) { return e.size(); }) |
+                                    lazy::or_else([](size_t n) { return Ok(int(n)); });
+    const bool pipeline_ok = good.unwrap() == 70 && zero.unwrap_err() == "digit: zero" &&
+                             bad.unwrap_err() == "digit: not a digit: x" && recovered.unwrap() == 14;
+
+    // 赋值在原地重新构造
+    Result<std::string, int> assigned(Err(1));
+    assigned = source;
+    const bool assign_ok = assigned.is_ok() && assigned.try_ok() == "stringflow";
+
+    if (member_ok && pipeline_ok && assign_ok) {
+        StringFlow::println("✅ Result pipeline test passed").unwrap();
+    }
+}
+
+void test_result_collect() {
+    using namespace result;
+    auto parse_field = [](const std::string &field) -> Result<int, std::string> {
+        if (field.empty() || field.find_first_not_of("0123456789") != std::string::npos) return Err("bad field: " + field);
+        return Ok(std::stoi(field));
+    };
+
+    // collect: 全部成功得到值, 否则短路返回第一个错误
+    std::vector<Result<int, std::string>> all_ok{Ok(1), Ok(2), Ok(3)};
+    std::vector<Result<int, std::string>> mixed{Ok(1), Err(std::string("first")), Ok(3), Err(std::string("second"))};
+    auto collected = collect(all_ok);
+    auto failed = collect(std::move(mixed));
+    const bool collect_ok = collected.unwrap() == std::vector<int>{1, 2, 3} && failed.unwrap_err() == "first";
+
+    // partition_results: 不短路, 成功值与错误分开
+    std::vector<Result<int, std::string>> rows{Ok(1), Err(std::string("a")), Ok(3), Err(std::string("b"))};
+    auto parts = partition_results(rows);
+    const bool partition_ok = parts.values == std::vector<int>{1, 3} && parts.errors == std::vector<std::string>{"a", "b"};
+
+    // try_transform: 转换的同时收集, 遇到错误即停止, 不会再调用 fn
+    const std::vector<std::string> fields{"10", "20", "x3", "40"};
+    size_t calls = 0;
+    auto transformed = try_transform(fields, [&](const std::string &field) {
+        ++calls;
+        return parse_field(field);
+    });
+    std::vector<int> head;
+    auto written = try_transform(std::vector<std::string>{"7", "8"}, std::back_inserter(head), parse_field);
+    const bool transform_ok = transformed.unwrap_err() == "bad field: x3" && calls == 3 && written.is_ok() &&
+                              head == std::vector<int>{7, 8};
+
+    // parallel_try_transform: 多线程, 结果保持原顺序, 出错时返回下标最小的错误
+    std::vector<std::string> many(100000);
+    for (size_t i = 0; i < many.size(); ++i) many[i] = std::to_string(i);
+    StringFlow::parallel_options options;
+    options.threads = 4;
+    options.chunk_records = 1000;
+    auto numbers = StringFlow::parallel_try_transform(many, parse_field, options).unwrap();
+    many[54321] = "bad";
+    many[98765] = "worse";
+    auto first_error = StringFlow::parallel_try_transform(many, parse_field, options);
+    const bool parallel_ok = numbers.size() == many.size() && numbers[0] == 0 && numbers[99999] == 99999 &&
+                             first_error.unwrap_err() == "bad field: bad";
+
+    if (collect_ok && partition_ok && transform_ok && parallel_ok) {
+        StringFlow::println("✅ Result collect test passed").unwrap();
+    }
+}
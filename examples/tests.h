@@ -1,4 +1,28 @@
 #pragma once
 
 void test_result_handling();
-void test_string_formatting();
\ No newline at end of file
+void test_string_formatting();
+void test_static_formatting();
+void test_named_arguments();
+void test_compiled_format();
+void test_unicode_alignment();
+void test_string_arguments();
+void test_custom_formatter();
+void test_container_formatting();
+void test_result_panic();
+void test_digit_grouping();
+void test_numeric_format();
+void test_hexdump();
+void test_pointer_format();
+void test_chrono_format();
+void test_escape_format();
+void test_structured_logging();
+void test_format_error_reporting();
+void test_instrumentation();
+void test_arena_format();
+void test_parallel_format();
+void test_vformat();
+void test_record_queue();
+void test_error_code();
+void test_result_pipeline();
+void test_result_collect();
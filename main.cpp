@@ -1,16 +1,58 @@
-#include <iostream>
+#include <cstring>
 #include "StringFlow/include/format.hpp"
 #include "examples/tests.h"
 
+// ctest 逐个运行: test_lib test_xxx
+static const struct {
+    const char *name;
+    void (*run)();
+} tests[] = {
+    {"test_result_handling", test_result_handling},
+    {"test_string_formatting", test_string_formatting},
+    {"test_static_formatting", test_static_formatting},
+    {"test_named_arguments", test_named_arguments},
+    {"test_compiled_format", test_compiled_format},
+    {"test_unicode_alignment", test_unicode_alignment},
+    {"test_string_arguments", test_string_arguments},
+    {"test_custom_formatter", test_custom_formatter},
+    {"test_container_formatting", test_container_formatting},
+    {"test_result_panic", test_result_panic},
+    {"test_digit_grouping", test_digit_grouping},
+    {"test_numeric_format", test_numeric_format},
+    {"test_hexdump", test_hexdump},
+    {"test_pointer_format", test_pointer_format},
+    {"test_chrono_format", test_chrono_format},
+    {"test_escape_format", test_escape_format},
+    {"test_structured_logging", test_structured_logging},
+    {"test_format_error_reporting", test_format_error_reporting},
+    {"test_instrumentation", test_instrumentation},
+    {"test_arena_format", test_arena_format},
+    {"test_parallel_format", test_parallel_format},
+    {"test_vformat", test_vformat},
+    {"test_record_queue", test_record_queue},
+    {"test_error_code", test_error_code},
+    {"test_result_pipeline", test_result_pipeline},
+    {"test_result_collect", test_result_collect},
+};
 
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        for (const auto &test : tests) {
+            if (std::strcmp(test.name, argv[1]) == 0) {
+                test.run();
+                return 0;
+            }
+        }
+        StringFlow::println("unknown test: {}", argv[1]).unwrap();
+        return 1;
+    }
     // test_result_handling();
     // test_string_formatting();
     auto string_rec = StringFlow::println("hello {1} {0}","world","shangfan is a dog").unwrap();
     auto string_rec1 =StringFlow::println("{1:.2} {0} {2:x} {2:b} {2:o}","hello",242.232,42);
     auto string_rec2 =StringFlow::println(nullptr);
     if (string_rec2.is_err()) {
-        StringFlow::println("{}",StringFlow::format_error_to_string(string_rec2.unwrap_err()).c_str()).unwrap();
+        StringFlow::println("{}",StringFlow::format_error_to_string(string_rec2.unwrap_err())).unwrap();
     }
     StringFlow::println("{:^^30}","hello").unwrap();
     return 0;
@@ -0,0 +1,58 @@
+//
+// Created by ruixuezhao on 25-3-25.
+//
+
+// import stringflow; 导出格式化接口, 全局模块片段中的头文件只解析一次
+module;
+#include <include/format.hpp>
+#include <include/compiled_format.hpp>
+#include <include/vformat.hpp>
+#include <include/parallel.hpp>
+#include <result/result_algorithm.h>
+
+export module stringflow;
+
+export namespace result {
+    using result::Result;
+    using result::Ok;
+    using result::Err;
+    using result::operator|;
+    using result::partitioned;
+    using result::collect;
+    using result::partition_results;
+    using result::try_transform;
+    namespace lazy {
+        using result::lazy::then;
+        using result::lazy::map;
+        using result::lazy::map_err;
+        using result::lazy::or_else;
+    }
+}
+
+export namespace StringFlow {
+    using StringFlow::format_error;
+    using StringFlow::format_error_info;
+    using StringFlow::format_error_to_string;
+    using StringFlow::error_policy;
+    using StringFlow::Context;
+    using StringFlow::FormatterOption;
+    using StringFlow::formatter;
+    using StringFlow::format_to;
+    using StringFlow::format;
+    using StringFlow::print;
+    using StringFlow::println;
+    using StringFlow::arg;
+    using StringFlow::name_table;
+    using StringFlow::compiled_format;
+    using StringFlow::cached;
+    using StringFlow::format_arg;
+    using StringFlow::format_args;
+    using StringFlow::make_format_args;
+    using StringFlow::format_sink;
+    using StringFlow::vformat_to;
+    using StringFlow::vformat;
+    using StringFlow::parallel_options;
+    using StringFlow::parallel_format_lines;
+    using StringFlow::parallel_format_lines_into;
+    using StringFlow::parallel_try_transform;
+}
@@ -0,0 +1,6 @@
+//
+// Created by ruixuezhao on 25-3-25.
+//
+
+// stringflow 库中唯一一份格式化引擎: 内置类型的整数、浮点、字符串输出在这里实例化一次
+#include <include/vformat_inl.hpp>